@@ -10,43 +10,97 @@
 #include "atf_precompile.h"
 
 #include "atf_catv5_producer_impl.h"
+#include "atf_catv5_object_handle.h"
+#include "atf_catv5_pmi_annotation_cache.h"
+#include "atf_catv5_pmi_dense_ids.h"
+#include "atf_catv5_pmi_draw_standard.h"
+#include "atf_catv5_pmi_part_context.h"
+#include "atf_catv5_pmi_roughness.h"
+#include "atf_catv5_pmi_session.h"
+#include "atf_catv5_pmi_simd.h"
+#include "atf_catv5_pmi_stats.h"
+#include "atf_catv5_pmi_topology_snapshot.h"
+#include "atf_catv5_pmi_trace.h"
+#include "atf_catv5_pmi_translation.h"
 #include "atf_catv5_pmi_util.h"
 #include "atf_catv5_util.h"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace ATF;
 using namespace std;
 
-PMIStandardTypeEnum CATV5PMIUtil::GetPMIStandardType(CC5TPSSet* pTPS)
+namespace
 {
-    if (!pTPS)
-        return kPMIStandardTypeEnum_Unknown;
-
-    char* standardName = nullptr;
-    pTPS->GetTPSDrawStandard(standardName);
-    if (standardName == nullptr)
-        return kPMIStandardTypeEnum_Unknown;
-
-    PMIStandardTypeEnum standardType = kPMIStandardTypeEnum_Unknown;
-    AString standardTypeName(standardName);
-    // According to CCE, "CER" and "CEG1" are custom standards 
-    // which are created from ISO (parent standard)
-    // #4100 will provide the APIs on Dec 29, 2017
-    size_t pos = 0;
-    if (standardTypeName.Find("ISO", 0, pos) == kIsValueSpecified_Yes
-        || standardTypeName.Find("CER", 0, pos)  == kIsValueSpecified_Yes
-        || standardTypeName.Find("CEG1", 0, pos)  == kIsValueSpecified_Yes )
-        standardType = kPMIStandardTypeEnum_ISO;
-    else if (standardTypeName.Find("ANSI", 0, pos)  == kIsValueSpecified_Yes)
-        standardType = kPMIStandardTypeEnum_ANSI;
-    else if (standardTypeName.Find("ASME", 0, pos)  == kIsValueSpecified_Yes)
-        standardType = kPMIStandardTypeEnum_ASME;
-    else if (standardTypeName.Find("JIS", 0, pos)  == kIsValueSpecified_Yes)
-        standardType = kPMIStandardTypeEnum_JIS;
-    else
-        ATF_WARNING_ASSERT(0 && "Unknown standard type is found!");
+    // Arena of the ProcessAssociatedGeomEntity call running on this thread. The faces and edges the part
+    // index fetches for the resolution are left there, next to the ones fetched from the associated entity.
+    thread_local CC5ReleaseArena* t_pFetched = nullptr;
+
+    class FetchedScope
+    {
+    public:
+        explicit FetchedScope(CC5ReleaseArena& fetched)
+            : m_pPrevious(t_pFetched)
+        {
+            t_pFetched = &fetched;
+        }
+
+        ~FetchedScope()
+        {
+            t_pFetched = m_pPrevious;
+        }
+
+    private:
+        FetchedScope(const FetchedScope&) = delete;
+        FetchedScope& operator=(const FetchedScope&) = delete;
+
+        CC5ReleaseArena* m_pPrevious;
+    };
+
+    // The arena of the running resolution, or a per-thread one freed at the next call outside of any
+    CC5ReleaseArena& Fetched()
+    {
+        if (t_pFetched)
+            return *t_pFetched;
 
-    CC5MemoryDelete_ThreadSafe((void**)&standardName);
-    return standardType;
+        thread_local CC5ReleaseArena t_unscoped;
+        t_unscoped.Clear();
+        return t_unscoped;
+    }
+
+    // Distance within which a point reference is on a vertex: the model resolution of CATIA V5, in mm
+    const double kVertexSnapTolerance = 1.0e-3;
+
+    bool ReadPointCoordinates(CC5Entity* pEnt, int nType, double coord[3])
+    {
+        bool bRead = false;
+        if (nType == CC5_POINT_TYPE)
+        {
+            CC5Point* pPnt = dynamic_cast<CC5Point*>(pEnt);
+            if (pPnt)
+                bRead = pPnt->GetCoordinates(coord) == CC5_QUERY_SUCCESS;
+        }
+        else if (nType == CC5_POINTONCURVE_TYPE)
+        {
+            CC5PointOnCurve* pPoc = dynamic_cast<CC5PointOnCurve*>(pEnt);
+            if (pPoc)
+                bRead = pPoc->GetCoordinates(coord) == CC5_QUERY_SUCCESS;
+        }
+        else if (nType == CC5_POINTONSURFACE_TYPE)
+        {
+            CC5PointOnSurface* pPos = dynamic_cast<CC5PointOnSurface*>(pEnt);
+            if (pPos)
+                bRead = pPos->GetCoordinates(coord) == CC5_QUERY_SUCCESS;
+        }
+        return bRead;
+    }
+}
+
+// Read once per TPS set, see CATV5PMIDrawStandard
+PMIStandardTypeEnum CATV5PMIUtil::GetPMIStandardType(CC5TPSSet* pTPS)
+{
+    return CATV5PMIDrawStandard::StandardType(pTPS);
 }
 
 // For ISO representation, leader end point will point to center of text
@@ -72,218 +126,38 @@ bool CATV5PMIUtil::IsSameAsISORepresentation(PMIStandardTypeEnum standardType)
     return true;
 }
 
+// The type of the annotation is read once, see CATV5PMIAnnotationCache; the id depends on the parent
 ATF::ObjectId CATV5PMIUtil::AnnotationObjectId(CC5TPSShape* pShape, const ATF::ObjectId& parentId)
 {
-    ObjectId annotationObjId;
-    if (!pShape)
-        return annotationObjId;
+    shared_ptr<const CATV5PMIAnnotationDescriptor> pDescriptor = CATV5PMIAnnotationCache::Lookup(pShape);
+    if (!pDescriptor)
+        return ObjectId();
 
-    CC5_TPS_TYPE type = CC5_TPS_UNKNOWN;
-    CC5_ERROR err = pShape->GetTPSType(type);
-    if (err != CC5_QUERY_SUCCESS || type == CC5_TPS_UNKNOWN)
-        return annotationObjId;
-
-    switch (type)
+    if (!pDescriptor->bSupported)
     {
-        case CC5_TPS_TEXT:
-        {
-            CC5TPSText* pAnnotationObj = dynamic_cast<CC5TPSText*>(pShape);
-            if (!pAnnotationObj)
-                return annotationObjId;
-
-            CATV5Util::CATV5ObjectId<CC5TPSText>(pAnnotationObj, parentId, annotationObjId);
-            break;
-        }
-        case CC5_TPS_FLAG_NOTE:
-        {
-            CC5TPSFlagNote* pAnnotationObj = dynamic_cast<CC5TPSFlagNote*>(pShape);
-            if (!pAnnotationObj)
-                return annotationObjId;
-
-            CATV5Util::CATV5ObjectId<CC5TPSFlagNote>(pAnnotationObj, parentId, annotationObjId);
-            break;
-        }
-        case CC5_TPS_LINEAR_DIMENSION:
-        {
-            CC5TPSLinearDimension* pAnnotationObj = dynamic_cast<CC5TPSLinearDimension*>(pShape);
-            if (!pAnnotationObj)
-                return annotationObjId;
-
-            CATV5Util::CATV5ObjectId<CC5TPSLinearDimension>(pAnnotationObj, parentId, annotationObjId);
-            break;
-        }
-        case CC5_TPS_COORDINATE_DIMENSION:
-        {
-            CC5TPSCoordDimension* pAnnotationObj = dynamic_cast<CC5TPSCoordDimension*>(pShape);
-            if (!pAnnotationObj)
-                return annotationObjId;
-
-            CATV5Util::CATV5ObjectId<CC5TPSCoordDimension>(pAnnotationObj, parentId, annotationObjId);
-            break;
-        }
-        case CC5_TPS_GEOMETRIC_TOLERANCE:
-        {
-            CC5TPSGeometricTolerance* pAnnotationObj = dynamic_cast<CC5TPSGeometricTolerance*>(pShape);
-            if (!pAnnotationObj)
-                return annotationObjId;
-
-            CATV5Util::CATV5ObjectId<CC5TPSGeometricTolerance>(pAnnotationObj, parentId, annotationObjId);
-            break;
-        }
-        case CC5_TPS_SIMPLE_DATUM:
-        {
-            CC5TPSSimpleDatum* pAnnotationObj = dynamic_cast<CC5TPSSimpleDatum*>(pShape);
-            if (!pAnnotationObj)
-                return annotationObjId;
-
-            CATV5Util::CATV5ObjectId<CC5TPSSimpleDatum>(pAnnotationObj, parentId, annotationObjId);
-            break;
-        }
-        case CC5_TPS_DATUM_TARGET:
-        {
-            CC5TPSDatumTarget* pAnnotationObj = dynamic_cast<CC5TPSDatumTarget*>(pShape);
-            if (!pAnnotationObj)
-                return annotationObjId;
-
-            CATV5Util::CATV5ObjectId<CC5TPSDatumTarget>(pAnnotationObj, parentId, annotationObjId);
-            break;
-        }
-        case CC5_TPS_ROUGHNESS:
-        {
-            CC5TPSRoughness* pAnnotationObj = dynamic_cast<CC5TPSRoughness*>(pShape);
-            if (!pAnnotationObj)
-                return annotationObjId;
-
-            CATV5Util::CATV5ObjectId<CC5TPSRoughness>(pAnnotationObj, parentId, annotationObjId);
-            break;
-        }
-        case CC5_TPS_ANNOT_SET:
-        case CC5_TPS_PROJECTED_VIEW:
-        case CC5_TPS_REFERENCE_FRAME:
-        case CC5_TPS_LEADER:
-        case CC5_TPS_WELD_SYMBOL:
-        case CC5_TPS_CAPTURE:
-        case CC5_TPS_UNKNOWN:
-        default:
-        {
-            ATF_WARNING_ASSERT(0 && "Unsupported pmi type!");
-            return annotationObjId;
-        }
+        ATF_WARNING_ASSERT(0 && "Unsupported pmi type!");
+        return ObjectId();
     }
 
-    annotationObjId.Append("_callout");
-    return annotationObjId;
+    return CATV5PMIAnnotationCache::AnnotationObjectId(pShape, *pDescriptor, parentId);
 }
 
 bool CATV5PMIUtil::IsAnnotationVisible(CC5TPSShape* pShape)
 {
-    if (!pShape)
+    shared_ptr<const CATV5PMIAnnotationDescriptor> pDescriptor = CATV5PMIAnnotationCache::Lookup(pShape);
+    if (!pDescriptor)
         return false;
 
-    CC5_TPS_TYPE type = CC5_TPS_UNKNOWN;
-    CC5_ERROR err = pShape->GetTPSType(type);
-    if (err != CC5_QUERY_SUCCESS || type == CC5_TPS_UNKNOWN)
-        return false;
-
-    int bVisible = 1;
-    switch (type)
-    {
-    case CC5_TPS_TEXT:
-    {
-        CC5TPSText* pAnnotationObj = dynamic_cast<CC5TPSText*>(pShape);
-        if (!pAnnotationObj)
-            return false;
-
-        pAnnotationObj->IsVisible(bVisible);
-        break;
-    }
-    case CC5_TPS_FLAG_NOTE:
-    {
-        CC5TPSFlagNote* pAnnotationObj = dynamic_cast<CC5TPSFlagNote*>(pShape);
-        if (!pAnnotationObj)
-            return false;
-
-        pAnnotationObj->IsVisible(bVisible);
-
-        break;
-    }
-    case CC5_TPS_LINEAR_DIMENSION:
-    {
-        CC5TPSLinearDimension* pAnnotationObj = dynamic_cast<CC5TPSLinearDimension*>(pShape);
-        if (!pAnnotationObj)
-            return false;
-
-        pAnnotationObj->IsVisible(bVisible);
-
-        break;
-    }
-    case CC5_TPS_COORDINATE_DIMENSION:
-    {
-        CC5TPSCoordDimension* pAnnotationObj = dynamic_cast<CC5TPSCoordDimension*>(pShape);
-        if (!pAnnotationObj)
-            return false;
-
-        pAnnotationObj->IsVisible(bVisible);
-
-        break;
-    }
-    case CC5_TPS_GEOMETRIC_TOLERANCE:
-    {
-        CC5TPSGeometricTolerance* pAnnotationObj = dynamic_cast<CC5TPSGeometricTolerance*>(pShape);
-        if (!pAnnotationObj)
-            return false;
-
-        pAnnotationObj->IsVisible(bVisible);
-
-        break;
-    }
-    case CC5_TPS_SIMPLE_DATUM:
-    {
-        CC5TPSSimpleDatum* pAnnotationObj = dynamic_cast<CC5TPSSimpleDatum*>(pShape);
-        if (!pAnnotationObj)
-            return false;
-
-        pAnnotationObj->IsVisible(bVisible);
-
-        break;
-    }
-    case CC5_TPS_DATUM_TARGET:
-    {
-        CC5TPSDatumTarget* pAnnotationObj = dynamic_cast<CC5TPSDatumTarget*>(pShape);
-        if (!pAnnotationObj)
-            return false;
-
-        pAnnotationObj->IsVisible(bVisible);
-
-        break;
-    }
-    case CC5_TPS_ROUGHNESS:
-    {
-        CC5TPSRoughness* pAnnotationObj = dynamic_cast<CC5TPSRoughness*>(pShape);
-        if (!pAnnotationObj)
-            return false;
-
-        pAnnotationObj->IsVisible(bVisible);
-
-        break;
-    }
-    case CC5_TPS_ANNOT_SET:
-    case CC5_TPS_PROJECTED_VIEW:
-    case CC5_TPS_REFERENCE_FRAME:
-    case CC5_TPS_LEADER:
-    case CC5_TPS_WELD_SYMBOL:
-    case CC5_TPS_CAPTURE:
-    case CC5_TPS_UNKNOWN:
-    default:
+    if (!pDescriptor->bSupported)
     {
         ATF_WARNING_ASSERT(0 && "Unsupported pmi type!");
         return false;
     }
-    }
 
-    return bVisible == 1 ? true : false;
+    return pDescriptor->bVisible;
 }
 
+// Single leader version of CATV5PMIRoughnessLeaders::NearestPoints
 void CATV5PMIUtil::GetNearestPoint(CC5TPSShape* pCC5Shape
     , const RoughnessUtilData& roughnessUtilData
     , bool bSymbolMode
@@ -291,134 +165,32 @@ void CATV5PMIUtil::GetNearestPoint(CC5TPSShape* pCC5Shape
     , Point3d& nearestPt
     , int& nIndexOfNearestPt)
 {
-    if (!pCC5Shape)
+    Point3d leaderStartPt;
+    if (!CATV5PMIRoughnessLeaders::ReadLeaderStart(pCC5Shape, roughnessUtilData, leaderStartPt))
         return;
 
-    CC5TPSLeader* pCC5Leader = dynamic_cast<CC5TPSLeader*>(pCC5Shape);
-    if (!pCC5Leader)
-        return;
+    Point3d points[3];
+    CATV5PMIRoughnessLeaders::ConnectionPoints(roughnessUtilData, bSymbolMode, points);
 
-    double leaderPos[6];
-    CC5_ERROR err = pCC5Leader->GetTPSLeaderPosition(leaderPos);
-    if (err != CC5_QUERY_SUCCESS)
-        return;
-
-    Point3d leftPt = roughnessUtilData.leftBottomPosition;
-    Point3d rightPt = roughnessUtilData.rightBottomPosition;
-    Position leaderStartPt(leaderPos[0], leaderPos[1], leftPt.z);
-    Position atfLeftPt(leftPt.x, leftPt.y, leftPt.z);
-    Position atfRightPt(rightPt.x, rightPt.y, rightPt.z);
-
-    // break points
-    int nBreakPts = 0;
-    err = pCC5Leader->GetNumberOfBreakPoints(nBreakPts);
-    if (err == CC5_QUERY_SUCCESS  && nBreakPts > 0)
+    double dDis[3];
+    for (int k = 0; k < 3; k++)
     {
-        double breakPts[2] = { 0.0 };
-
-        err = pCC5Leader->GetBreakPointAt(breakPts, nBreakPts - 1);
-        if (err == CC5_QUERY_SUCCESS)
-        {
-            leaderStartPt.SetX(breakPts[0]);
-            leaderStartPt.SetY(breakPts[1]);
-            leaderStartPt.SetZ(leftPt.z);
-        }
+        double dx = points[k].x - leaderStartPt.x;
+        double dy = points[k].y - leaderStartPt.y;
+        double dz = points[k].z - leaderStartPt.z;
+        dDis[k] = sqrt(dx * dx + dy * dy + dz * dz);
     }
 
-    //In lower version of CATIA(upto V5R18), for ANSI and ASME standards, there are only two
-    //possible connection points, positioned in middle - left and middle - right of the roughness frame
-    if (bVersionHigherThanV5R18)
-    {
-        Position atfPtBetweenLR; // the point between left bottom point and right bottom point
-        if (bSymbolMode)
-        {
-            atfPtBetweenLR.SetX(roughnessUtilData.framePt2.x);
-            atfPtBetweenLR.SetY(roughnessUtilData.framePt2.y);
-            atfPtBetweenLR.SetZ(roughnessUtilData.framePt2.z);
-        }
-        else
-        {
-            atfPtBetweenLR.SetX(roughnessUtilData.middleBottomPosition.x);
-            atfPtBetweenLR.SetY(roughnessUtilData.middleBottomPosition.y);
-            atfPtBetweenLR.SetZ(roughnessUtilData.middleBottomPosition.z);
-        }
-
-        double dDis1 = (atfLeftPt - leaderStartPt).Len();
-        double dDis2 = (atfPtBetweenLR - leaderStartPt).Len();
-        double dDis3 = (atfRightPt - leaderStartPt).Len();
-        if (MathUtil::IsLessThan(dDis1, dDis2))
-        {
-            if (MathUtil::IsLessThan(dDis1, dDis3))
-            {
-                nearestPt = Point3d(atfLeftPt.X(), atfLeftPt.Y(), atfLeftPt.Z());
-                nIndexOfNearestPt = 0;
-            }
-            else
-            {
-                if (MathUtil::IsLessThan(dDis2, dDis3))
-                {
-                    nearestPt = Point3d(atfPtBetweenLR.X(), atfPtBetweenLR.Y(), atfPtBetweenLR.Z());
-                    nIndexOfNearestPt = 1;
-                }
-                else
-                {
-                    nearestPt = Point3d(atfRightPt.X(), atfRightPt.Y(), atfRightPt.Z());
-                    nIndexOfNearestPt = 2;
-                }
-            }
-        }
-        else
-        {
-            if (MathUtil::IsLessThan(dDis2, dDis3))
-            {
-                nearestPt = Point3d(atfPtBetweenLR.X(), atfPtBetweenLR.Y(), atfPtBetweenLR.Z());
-                nIndexOfNearestPt = 1;
-            }
-            else
-            {
-                if (MathUtil::IsLessThan(dDis1, dDis3))
-                {
-                    nearestPt = Point3d(atfLeftPt.X(), atfLeftPt.Y(), atfLeftPt.Z());
-                    nIndexOfNearestPt = 0;
-                }
-                else
-                {
-                    nearestPt = Point3d(atfRightPt.X(), atfRightPt.Y(), atfRightPt.Z());
-                    nIndexOfNearestPt = 2;
-                }
-            }
-        }
-    }
-    else
-    {
-        double dDis1 = (atfLeftPt - leaderStartPt).Len();
-        double dDis2 = (atfRightPt - leaderStartPt).Len();
-        if (MathUtil::IsLessThan(dDis1, dDis2))
-        {
-            nearestPt = Point3d(atfLeftPt.X(), atfLeftPt.Y(), atfLeftPt.Z());
-            nIndexOfNearestPt = 0;
-        }
-        else
-        {
-            nearestPt = Point3d(atfRightPt.X(), atfRightPt.Y(), atfRightPt.Z());
-            nIndexOfNearestPt = 2;
-        }
-    }
+    nIndexOfNearestPt = CATV5PMIRoughnessLeaders::SelectNearest(dDis[0], dDis[1], dDis[2], bVersionHigherThanV5R18);
+    nearestPt = points[nIndexOfNearestPt];
 }
 
 // GeometryReferenceBuilder
+// The translatable groups of the part are split once, in the CATV5PMIPartContext shared by all builders of the part.
 GeometryReferenceBuilder::GeometryReferenceBuilder(CC5Entity* cc5AssoEnt, CC5Part* cc5Part)
     : m_cc5AssoEnt(cc5AssoEnt)
     , m_cc5Part(cc5Part)
-{
-    for (auto e : CATV5ProducerImpl::Get()->TranslatableGroups())
-    {
-        if (e && e->GetType() == CC5_SOLIDGROUP_TYPE)
-            m_finalBodyList.push_back(e);
-        else
-            m_othertranslatablegrps.push_back(e);
-    }
-}
+{}
 
 GeometryReferenceBuilder::~GeometryReferenceBuilder()
 {}
@@ -428,6 +200,11 @@ bool GeometryReferenceBuilder::ReferencedGeometryIds(vector<int>& ids)
     if (nullptr == m_cc5AssoEnt || nullptr == m_cc5Part)
         return false;
 
+    // Outside of a translation of the producer, the builders of the part share the session kept for it
+    CATV5PMIPartSessionScope partSessionScope(m_cc5Part);
+
+    ATF_PMI_STATS_PART(m_cc5Part);
+    ATF_PMI_TIME(kTimer_ReferencedGeometryIds);
     ProcessAssociatedGeomEntity(m_cc5AssoEnt, m_cc5Part, ids);
     return true;
 }
@@ -474,8 +251,17 @@ void GeometryReferenceBuilder::ProcessAssociatedGeomEntity(CC5Entity* Ent, CC5Pa
     if (nullptr == Ent || nullptr == Part)
         return;
 
+    ATF_PMI_TRACE_SPAN_ID("ProcessAssociatedGeomEntity", Ent->GetID());
+
+    // The faces and edges fetched below, or by the part index, can end up in entitiesinfinalsolid,
+    // so they are freed only once their IDs are read.
+    CC5ReleaseArena fetched;
+    FetchedScope fetchedScope(fetched);
+
     // Vector to hold all the entities found in the final translatable solid
     ENTITIESINFINALSOLID entitiesinfinalsolid; 
+    // IDs of the final edges meeting at the vertex a point reference is on
+    std::vector<int> vertexEdgeIds;
     auto* groupEnt = dynamic_cast<CC5Group*>(Ent->GetParent());
     if (groupEnt && groupEnt->NeedTranslate() == 1) // Is group a translatable entity?
     {
@@ -495,7 +281,7 @@ void GeometryReferenceBuilder::ProcessAssociatedGeomEntity(CC5Entity* Ent, CC5Pa
             // Faces
             if (pSkin->GetNumberOfFaces() == 1)
             {
-                CC5Face* face = pSkin->GetFaceAt(0);
+                CC5Face* face = fetched.Track(pSkin->GetFaceAt(0));
                 CheckFacesInFinalBody(face, Part, 2, entitiesinfinalsolid);
             }
             else
@@ -505,7 +291,7 @@ void GeometryReferenceBuilder::ProcessAssociatedGeomEntity(CC5Entity* Ent, CC5Pa
                 int iNumFace = pSkin->GetNumberOfFaces();
                 for (int iFaceItr = 0; iFaceItr < iNumFace; iFaceItr++)
                 {
-                    CC5Face* face = pSkin->GetFaceAt(iFaceItr);
+                    CC5Face* face = fetched.Track(pSkin->GetFaceAt(iFaceItr));
                     CheckFacesInFinalBody(face, Part, 2, entitiesinfinalsolid);
                 }
             }
@@ -520,7 +306,7 @@ void GeometryReferenceBuilder::ProcessAssociatedGeomEntity(CC5Entity* Ent, CC5Pa
             // Edges
             if (pCompositeCur->GetNumberOfCurveSegments() == 1)
             {
-                CC5CurveSegment* crvSeg = pCompositeCur->GetCurveSegmentAt(0);
+                CC5CurveSegment* crvSeg = fetched.Track(pCompositeCur->GetCurveSegmentAt(0));
                 CheckEdgesInFinalBody(crvSeg, Part, entitiesinfinalsolid);
             }
             else
@@ -530,7 +316,7 @@ void GeometryReferenceBuilder::ProcessAssociatedGeomEntity(CC5Entity* Ent, CC5Pa
                 int iNumSeg = pCompositeCur->GetNumberOfCurveSegments();
                 for (int iSegItr = 0; iSegItr < iNumSeg; iSegItr++)
                 {
-                    CC5CurveSegment* crvSeg = pCompositeCur->GetCurveSegmentAt(iSegItr);
+                    CC5CurveSegment* crvSeg = fetched.Track(pCompositeCur->GetCurveSegmentAt(iSegItr));
                     CheckEdgesInFinalBody(crvSeg, Part, entitiesinfinalsolid);
                 }
             }
@@ -548,19 +334,19 @@ void GeometryReferenceBuilder::ProcessAssociatedGeomEntity(CC5Entity* Ent, CC5Pa
             int iNumBody = pSolid->GetNumberOfBodies();
             for (int iBodyItr = 0; iBodyItr < iNumBody; iBodyItr++)
             {
-                CC5Body* pBody = pSolid->GetBodyAt(iBodyItr);
+                CC5Body* pBody = fetched.Track(pSolid->GetBodyAt(iBodyItr));
                 if (pBody && pBody->GetType() == CC5_BODY_TYPE)
                 {
                     int iNumSkin = pBody->GetNumberOfSkins();
                     for (int iSkinItr = 0; iSkinItr < iNumSkin; iSkinItr++)
                     {
-                        CC5Skin* pSkin = pBody->GetSkinAt(iSkinItr);
+                        CC5Skin* pSkin = fetched.Track(pBody->GetSkinAt(iSkinItr));
                         if (pSkin)
                         {
                             int iNumFace = pSkin->GetNumberOfFaces();
                             for (int iFaceItr = 0; iFaceItr < iNumFace; iFaceItr++)
                             {
-                                CC5Face* pFace = pSkin->GetFaceAt(iFaceItr);
+                                CC5Face* pFace = fetched.Track(pSkin->GetFaceAt(iFaceItr));
                                 CheckFacesInFinalBody(pFace, Part, 1, entitiesinfinalsolid);
                             }
                         }
@@ -573,36 +359,24 @@ void GeometryReferenceBuilder::ProcessAssociatedGeomEntity(CC5Entity* Ent, CC5Pa
         case CC5_POINTONCURVE_TYPE:
         case CC5_POINTONSURFACE_TYPE:
         {
-            // For points and vertex
-            //if (Ent->GetType() == CC5_POINT_TYPE)
-            //{
-            //    CC5Point* pPnt = (CC5Point*)Ent;
-            //    entitiesinfinalsolid.push_back(Ent);
-            //}
-            //// Annotation associated to vertex / point on curve will have this entity type. 
-            //else if (Ent->GetType() == CC5_POINTONCURVE_TYPE)
-            //{
-            //    CC5PointOnCurve* pPoc = (CC5PointOnCurve*)Ent;
-            //    // When the associated geom entity is a point on curve, it could be found in the translatable entity list
-            //    entitiesinfinalsolid.push_back(Ent);
-            //
-            //    // For annotation on vertex, the associated entity will not point to an entity in geometry translation.
-            //    // In such a case, the 3D coordinates at the vertex could be used.
-            //    double coord[3];
-            //    pPoc->GetCoordinates(coord);
-            //
-            //}
-            //else if (Ent->GetType() == CC5_POINTONSURFACE_TYPE)
-            //{
-            //    CC5PointOnSurface* pPos = (CC5PointOnSurface*)Ent;
-            //    entitiesinfinalsolid.push_back(Ent);
-            //}
-
-            const EventManager* pEventManager = CATV5ProducerImpl::Get()->GetEventManager();
+            // Vertices have no entity in the final bodies: a point on a vertex (usually a point on curve)
+            // is mapped to the final edges meeting at the vertex, found by position.
+            double coord[3];
+            if (ReadPointCoordinates(Ent, nType, coord))
+            {
+                ATF_PMI_TRACE_SPAN_ID("FindVertexEdges", Ent->GetID());
+                shared_ptr<const CATV5PMIPartContext> pContext = CATV5PMIPartContext::ForPart(Part);
+                if (pContext && pContext->Index().FindVertexEdges(coord, kVertexSnapTolerance, vertexEdgeIds))
+                    break;
+            }
+
+            CATV5PMISession* pSession = CATV5PMISession::Current();
+            const EventManager* pEventManager = pSession ? pSession->GetEventManager() : nullptr;
             if (pEventManager)
             {
-                GeneralException ex("Point reference is not supported in PMI association.");
+                GeneralException ex("Point reference is not on a vertex of the translatable bodies in PMI association.");
                 EventPtr<ExceptionEvent> event(new ExceptionEvent(ExceptionEvent::kEventType_NoExceptionThrow, ex));
+                ATF_PMI_TRACE_SPAN("EventManager::FireEvent");
                 pEventManager->FireEvent(event.get());
             }
         }
@@ -613,18 +387,51 @@ void GeometryReferenceBuilder::ProcessAssociatedGeomEntity(CC5Entity* Ent, CC5Pa
     }
 
     // Map the entities in the vector "entitiesinfinalsolid" with the corresponding annotation shape (pShape).
-    if (entitiesinfinalsolid.empty())
+    if (!vertexEdgeIds.empty())
+    {
+        ids.insert(ids.end(), vertexEdgeIds.begin(), vertexEdgeIds.end());
+    }
+    else if (entitiesinfinalsolid.empty())
+    {
+        ATF_PMI_COUNT(kCounter_EntityIdFallbacks, 1);
         ids.push_back(Ent->GetID());
+    }
+    else if (entitiesinfinalsolid.size() == 1)
+    {
+        ids.push_back(entitiesinfinalsolid.front()->GetID());
+    }
     else
     {
-        std::set<int> usefulSet;
+        // Duplicates are dropped with a per-thread bitset over the dense slots of the part's final
+        // faces and edges; an ID without a slot is searched in the IDs added so far.
+        const CATV5PMIPartIndex* pIndex = nullptr;
+        shared_ptr<const CATV5PMIPartContext> pContext = CATV5PMIPartContext::ForPart(Part);
+        if (pContext)
+            pIndex = &pContext->Index();
+
+        thread_local CATV5PMIDenseBitset t_usedSlots;
+        if (pIndex)
+            t_usedSlots.Reserve(pIndex->DenseEntityCount());
+
+        size_t iFirstId = ids.size();
         for (auto e : entitiesinfinalsolid)
         {
             int id = e->GetID();
-            if (usefulSet.find(id) == usefulSet.end())
-            {
+            uint32_t slot = pIndex ? pIndex->DenseEntitySlot(id) : CATV5PMIDenseIds::kNotFound;
+            bool bUsed = slot != CATV5PMIDenseIds::kNotFound
+                ? t_usedSlots.TestAndSet(slot)
+                : find(ids.begin() + iFirstId, ids.end(), id) != ids.end();
+            if (!bUsed)
                 ids.push_back(id);
-                usefulSet.insert(id);
+        }
+
+        if (pIndex)
+        {
+            for (size_t i = iFirstId; i < ids.size(); i++)
+            {
+                uint32_t slot = pIndex->DenseEntitySlot(ids[i]);
+                if (slot != CATV5PMIDenseIds::kNotFound)
+                    t_usedSlots.Reset(slot);
             }
         }
     }
@@ -638,156 +445,23 @@ int GeometryReferenceBuilder::CheckForEntityInFinalBody(CC5Entity* AsscEnt, int
     if (!AsscEnt)
         return 0;
 
-    for (CC5Group* pGrp : m_othertranslatablegrps)
-    {
-        if (!pGrp) continue;
-        switch (pGrp->GetType())
-        {
-        case CC5_SURFACEGROUP_TYPE:
-        {
-            int nEntity = pGrp->GetNumberOfEntities();
-            for (int entityIdx = 0; entityIdx < nEntity; entityIdx++)
-            {
-                CC5Entity* entity = pGrp->GetEntityAt(entityIdx);
-                if (!entity)
-                    continue;
-                if (entity->GetType() == CC5_SKIN_TYPE)
-                {
-                    CC5Skin* skin = dynamic_cast<CC5Skin*>(entity);
-                    if (!skin) continue;
-                    int no_of_faces = skin->GetNumberOfFaces();
-                    for (int ii = 0; ii < no_of_faces; ii++)
-                    {
-                        CC5Face* face = skin->GetFaceAt(ii);
-                        if (!face)continue;
-                        if (iType == 2) {
-                            if (face->GetID() == AsscEnt->GetID()) {
-                                return pGrp->GetID();
-                            }
-                        }
-                        if (iType == 1) {
-                            int nLoops = face->GetNumberOfLoops();
-                            for (int iLoop = 0; iLoop < nLoops; iLoop++)
-                            {
-                                CC5Loop* pLoop = face->GetLoopAt(iLoop);
-                                int nEdges = pLoop->GetNumberOfEdges();
-                                for (int iEdge = 0; iEdge < nEdges; iEdge++) {
-                                    CC5CurveSegment* pCrvSeg = pLoop->GetEdgeAt(iEdge);
-                                    if (pCrvSeg->GetID() == AsscEnt->GetID()) {
-                                        return pGrp->GetID();
-                                    }
-                                    CC5ObjectDelete_ThreadSafe((CC5Object**)&pCrvSeg);
-                                }
-                                CC5ObjectDelete_ThreadSafe((CC5Object**)&pLoop);
-                            }
-                        }
-                        CC5ObjectDelete_ThreadSafe((CC5Object**)&face);
-                    }
-                }
-                CC5ObjectDelete_ThreadSafe((CC5Object**)&entity);
-            }
-        }
-        break;
-        case CC5_CURVEGROUP_TYPE:
-        {
-            int nentity = pGrp->GetNumberOfEntities();
-            for (int entitycount = 0; entitycount < nentity; entitycount++)
-            {
-                CC5Entity *entity = pGrp->GetEntityAt(entitycount);
-                if (!entity)
-                    continue;
-                if (entity->GetType() == CC5_COMPOSITECURVE_TYPE)
-                {
-                    CC5CompositeCurve *compCurve = dynamic_cast<CC5CompositeCurve*>(entity);
-                    int edge_count = compCurve->GetNumberOfCurveSegments();
-                    for (int l = 0; l < edge_count; l++)
-                    {
-                        CC5CurveSegment* edge = compCurve->GetCurveSegmentAt(l);
-                        if (!edge) continue;
-                        if (edge->GetID() == AsscEnt->GetID()) {
-                            return pGrp->GetID();
-                        }
-                        CC5ObjectDelete_ThreadSafe((CC5Object**)&edge);
-                    }
-                }
-                CC5ObjectDelete_ThreadSafe((CC5Object**)&entity);
-            }
-        }
-        break;
-        default:
-            break;
-        }
-    }
+    ATF_PMI_TRACE_SPAN_ID("CheckForEntityInFinalBody", AsscEnt->GetID());
+    // The face/edge ownership of the final bodies is indexed once per part.
+    shared_ptr<const CATV5PMIPartContext> pContext = CATV5PMIPartContext::ForPart(m_cc5Part);
+    if (!pContext)
+        return 0;
 
-    FINALBODYLIST::iterator FinalBodyItr = m_finalBodyList.begin();
-    while (FinalBodyItr != m_finalBodyList.end())
-    {
-        CC5Group* pGrp = *FinalBodyItr;
-        if (!pGrp) continue;
-        if (pGrp->GetType() == CC5_SOLIDGROUP_TYPE)
-        {
-            int iNumEnt = pGrp->GetNumberOfEntities();
-            for (int iEntItr = 0; iEntItr < iNumEnt; iEntItr++)
-            {
-                CC5Entity* pEnt = pGrp->GetEntityAt(iEntItr);
-                if (!pEnt) continue;
-                if (pEnt->GetType() == CC5_SOLID_TYPE)
-                {
-                    int iNumBody = (dynamic_cast<CC5Solid*>(pEnt))->GetNumberOfBodies();
-                    for (int iBodyItr = 0; iBodyItr < iNumBody; iBodyItr++)
-                    {
-                        CC5Body* pBody = (dynamic_cast<CC5Solid*>(pEnt))->GetBodyAt(iBodyItr);
-                        if (!pBody) continue;
-                        if (pBody && pBody->GetType() == CC5_BODY_TYPE)
-                        {
-                            int iNumSkin = pBody->GetNumberOfSkins();
-                            for (int iSkinItr = 0; iSkinItr < iNumSkin; iSkinItr++)
-                            {
-                                CC5Skin* pSkin = pBody->GetSkinAt(iSkinItr);
-                                if (!pSkin) continue;
-                                int iNumFace = pSkin->GetNumberOfFaces();
-                                for (int iFaceItr = 0; iFaceItr < iNumFace; iFaceItr++)
-                                {
-                                    CC5Face* pFace = pSkin->GetFaceAt(iFaceItr);
-                                    if (!pFace) continue;
-                                    if (iType == 2) {
-                                        if (pFace->GetID() == AsscEnt->GetID()) {
-                                            return pGrp->GetID();
-                                        }
-                                    }
-                                    if (iType == 1) {
-                                        int loop_count = pFace->GetNumberOfLoops();
-                                        for (int k = 0; k < loop_count; k++)
-                                        {
-                                            CC5Loop* loop = pFace->GetLoopAt(k);
-                                            if (!loop) continue;
-                                            int edge_count = loop->GetNumberOfEdges();
-                                            for (int l = 0; l < edge_count; l++)
-                                            {
-                                                CC5CurveSegment* edge = loop->GetEdgeAt(l);
-                                                if (!edge) continue;
-                                                if (edge->GetID() == AsscEnt->GetID()) {
-                                                    return pGrp->GetID();
-                                                }
-                                                CC5ObjectDelete_ThreadSafe((CC5Object**)&edge);
-                                            }
-                                            CC5ObjectDelete_ThreadSafe((CC5Object**)&loop);
-                                        }
-                                    }
-                                    CC5ObjectDelete_ThreadSafe((CC5Object **)&pFace);
-                                }
-                                CC5ObjectDelete_ThreadSafe((CC5Object **)&pSkin);
-                            }
-                        }
-                        CC5ObjectDelete_ThreadSafe((CC5Object **)&pBody);
-                    }
-                }
-                CC5ObjectDelete_ThreadSafe((CC5Object **)&pEnt);
-            }
-        }
-        ++FinalBodyItr;
-    }
-    return 0;
+    int finalBodyID = 0;
+    if (iType == 2)
+        finalBodyID = pContext->Index().FinalFaceOwner(AsscEnt->GetID());
+    else if (iType == 1)
+        finalBodyID = pContext->Index().FinalEdgeOwner(AsscEnt->GetID());
+
+    if (finalBodyID != 0)
+        ATF_PMI_COUNT(kCounter_FinalOwnerHits, 1);
+    else
+        ATF_PMI_COUNT(kCounter_FinalOwnerMisses, 1);
+    return finalBodyID;
 }
 
 // Method to get the final resolved face/faces in the translatable body
@@ -798,6 +472,8 @@ int GeometryReferenceBuilder::GetResolvedFaces(CC5Entity* asscEnt, ENTITIESINFIN
     if (!asscEnt || !Part)
         return 0;
 
+    ATF_PMI_TIME(kTimer_FaceSearch);
+    ATF_PMI_TRACE_SPAN_ID("GetResolvedFaces", asscEnt->GetID());
     int finalBodyID = 0;
     //int iIntermediateBodyID = 0;   //codacy reported Variable 'iIntermediateBodyID' is assigned a value that is never used.
     CC5Entity* pIntermdtEnt1 = nullptr;
@@ -831,6 +507,8 @@ int GeometryReferenceBuilder::GetResolvedEdges(CC5Entity* asscEnt, ENTITIESINFIN
     if (!asscEnt || !Part)
         return 0;
 
+    ATF_PMI_TIME(kTimer_EdgeSearch);
+    ATF_PMI_TRACE_SPAN_ID("GetResolvedEdges", asscEnt->GetID());
     int finalBodyID = 0;
     CC5Entity* pIntermdtEnt1 = nullptr;
     CC5Entity* pIntermdtEnt2 = nullptr;
@@ -851,96 +529,17 @@ int GeometryReferenceBuilder::FindAsscEntityInIntermediateSolid(CC5Entity* asscE
     if (!asscEnt || !Part)
         return 0;
 
-    bool bEntFound = false;
-    int nGrps = Part->GetNumberOfGroups();
-    //bool intermediateface_found = false;
-    for (int i = 0; i < nGrps; i++)
-    {
-        CC5Group* pGrp = Part->GetGroupAt(i);
-        //if (!pGrp) 
-        //    continue;
-        if (pGrp->GetType() == CC5_SOLIDGROUP_TYPE)
-        {
-            int iNumEnt = pGrp->GetNumberOfEntities();
-            for (int iEntItr = 0; iEntItr < iNumEnt; iEntItr++)
-            {
-                CC5Entity* pEnt = pGrp->GetEntityAt(iEntItr);
-                if (!pEnt) continue;
-                if (pEnt->GetType() == CC5_SOLID_TYPE)
-                {
-					CC5Solid * pCC5SolidBody = dynamic_cast<CC5Solid*>(pEnt);
-					if (!pCC5SolidBody)
-						continue;
+    ATF_PMI_TRACE_SPAN_ID("FindAsscEntityInIntermediateSolid", asscEnt->GetID());
+    // The faces and co-edges of the part's solids are indexed on first use, and shared by all builders of the part.
+    shared_ptr<const CATV5PMIPartContext> pContext = CATV5PMIPartContext::ForPart(Part);
+    if (!pContext)
+        return 0;
+
+    if (iType == 2)
+        return pContext->Index().FindIntermediateFace(asscEnt->GetID(), pIntermdtEnt1, Fetched());
+    if (iType == 1)
+        return pContext->Index().FindIntermediateCoEdgeFaces(asscEnt->GetID(), pIntermdtEnt1, pIntermdtEnt2, Fetched());
 
-                    int iNumBody = pCC5SolidBody->GetNumberOfBodies();
-                    for (int iBodyItr = 0; iBodyItr < iNumBody; iBodyItr++)
-                    {
-                        CC5Body* pBody = pCC5SolidBody->GetBodyAt(iBodyItr);
-                        if (!pBody) continue;
-                        if (pBody && pBody->GetType() == CC5_BODY_TYPE)
-                        {
-                            int iNumSkin = pBody->GetNumberOfSkins();
-                            for (int iSkinItr = 0; iSkinItr < iNumSkin; iSkinItr++)
-                            {
-                                CC5Skin* pSkin = pBody->GetSkinAt(iSkinItr);
-                                if (!pSkin) continue;
-                                int iNumFace = pSkin->GetNumberOfFaces();
-                                for (int iFaceItr = 0; iFaceItr < iNumFace; iFaceItr++)
-                                {
-                                    CC5Face* pFace = pSkin->GetFaceAt(iFaceItr);
-                                    if (!pFace) continue;
-                                    if (iType == 2 && pFace->GetID() == asscEnt->GetID()) {
-                                        if (pFace->GetID() == asscEnt->GetID()) {
-                                            pIntermdtEnt1 = pFace;
-                                            return pGrp->GetID();
-                                        }
-                                    }
-                                    else if (iType == 1) {
-                                        int loop_count = pFace->GetNumberOfLoops();
-                                        for (int k = 0; k < loop_count; k++)
-                                        {
-                                            CC5Loop* loop = pFace->GetLoopAt(k);
-                                            if (!loop) continue;
-                                            int edge_count = loop->GetNumberOfEdges();
-                                            for (int l = 0; l < edge_count; l++)
-                                            {
-                                                CC5CurveSegment* edge = loop->GetEdgeAt(l);
-                                                if (!edge) continue;
-                                                if (edge->GetID() != asscEnt->GetID())
-                                                    continue;
-                                                if (edge->CoEdgeExisted() == CC5_TRUE) {
-                                                    if (pIntermdtEnt1 == nullptr)
-                                                        pIntermdtEnt1 = pFace;
-                                                    else
-                                                        pIntermdtEnt2 = pFace;
-                                                    if (pIntermdtEnt1 && pIntermdtEnt2)
-                                                        return pGrp->GetID();
-                                                    bEntFound = true;
-                                                    continue;
-                                                }
-                                                if (bEntFound == true) continue;
-                                                CC5ObjectDelete_ThreadSafe((CC5Object**)&edge);
-                                            }
-                                            if (bEntFound == true) continue;
-                                            CC5ObjectDelete_ThreadSafe((CC5Object**)&loop);
-                                        }
-                                    }
-                                    if (bEntFound == true) continue;
-                                    CC5ObjectDelete_ThreadSafe((CC5Object**)&pFace);
-                                }
-                                if (bEntFound == true) continue;
-                                CC5ObjectDelete_ThreadSafe((CC5Object**)&pSkin);
-                            }
-                        }
-                        if (bEntFound == true) continue;
-                        CC5ObjectDelete_ThreadSafe((CC5Object**)&pBody);
-                    }
-                }
-                if (bEntFound == true) continue;
-                CC5ObjectDelete_ThreadSafe((CC5Object**)&pEnt);
-            }
-        }
-    }
     return 0;
 }
 
@@ -950,129 +549,18 @@ int GeometryReferenceBuilder::FindAsscEntityInIntermediateSolid(CC5Entity* asscE
 //      In case of an edge, the PersistentIdentifier of the sharing faces of edge could be used.
 int GeometryReferenceBuilder::FindEntityUsingGeomIDs(CC5Entity* pIntermdtEnt1, CC5Entity* pIntermdtEnt2, int iType, ENTITIESINFINALSOLID& entitiesinfinalsolid)
 {
-    size_t iSize = entitiesinfinalsolid.size();
-    EDGE_FACE edge_face;
-    CC5Face* asscFace = nullptr;
-    if (iType == 2)
-        asscFace = dynamic_cast<CC5Face*>(pIntermdtEnt1);
+    ATF_PMI_TRACE_SPAN("FindEntityUsingGeomIDs");
+    // Faces are looked up through the persistent-ID groups, and edges through the faces sharing them,
+    // both indexed once per part.
+    shared_ptr<const CATV5PMIPartContext> pContext = CATV5PMIPartContext::ForPart(m_cc5Part);
+    if (!pContext)
+        return 0;
 
-    bool bFaceMatched = true;
-    FINALBODYLIST::iterator finalBodyItr;
-    finalBodyItr = m_finalBodyList.begin();
-    while (finalBodyItr != m_finalBodyList.end())
-    {
-        CC5Group* pGrp = *finalBodyItr;
-        if (!pGrp) continue;
-        if (pGrp->GetType() == CC5_SOLIDGROUP_TYPE)
-        {
-            int iNumEnt = pGrp->GetNumberOfEntities();
-            for (int iEntItr = 0; iEntItr < iNumEnt; iEntItr++)
-            {
-                CC5Entity* pEnt = pGrp->GetEntityAt(iEntItr);
-                if (!pEnt) continue;
-                if (pEnt->GetType() == CC5_SOLID_TYPE)
-                {
-					CC5Solid * pCC5SolidBody = dynamic_cast<CC5Solid*>(pEnt);
-					if (!pCC5SolidBody)
-						continue;
+    if (iType == 2)
+        return pContext->Index().FindFacesByPersistentID(dynamic_cast<CC5Face*>(pIntermdtEnt1), entitiesinfinalsolid, Fetched());
+    if (iType == 1)
+        return pContext->Index().FindEdgesByAdjacentFaces(dynamic_cast<CC5Face*>(pIntermdtEnt1), dynamic_cast<CC5Face*>(pIntermdtEnt2), entitiesinfinalsolid, Fetched());
 
-                    int iNumBody = pCC5SolidBody->GetNumberOfBodies();
-                    for (int iBodyItr = 0; iBodyItr < iNumBody; iBodyItr++)
-                    {
-                        CC5Body* pBody = pCC5SolidBody->GetBodyAt(iBodyItr);
-                        if (!pBody) continue;
-                        if (pBody && pBody->GetType() == CC5_BODY_TYPE)
-                        {
-                            int iNumSkin = pBody->GetNumberOfSkins();
-                            for (int iSkinItr = 0; iSkinItr < iNumSkin; iSkinItr++)
-                            {
-                                CC5Skin* pSkin = pBody->GetSkinAt(iSkinItr);
-                                if (!pSkin) continue;
-                                int iNumFace = pSkin->GetNumberOfFaces();
-                                for (int iFaceItr = 0; iFaceItr < iNumFace; iFaceItr++)
-                                {
-                                    bFaceMatched = true;
-                                    CC5Face* pFace = pSkin->GetFaceAt(iFaceItr);
-                                    if (!pFace) continue;
-                                    if (iType == 2) {
-                                        CheckFaceInFaceGroups(pFace, asscFace, bFaceMatched);
-                                        if (bFaceMatched == true) {
-                                            entitiesinfinalsolid.push_back(pFace);
-                                            continue;
-                                        }
-                                    }
-                                    if (iType == 1) {
-                                        int loop_count = pFace->GetNumberOfLoops();
-                                        for (int k = 0; k < loop_count; k++)
-                                        {
-                                            CC5Loop* loop = pFace->GetLoopAt(k);
-                                            if (!loop) continue;
-                                            int edge_count = loop->GetNumberOfEdges();
-                                            for (int l = 0; l < edge_count; l++)
-                                            {
-                                                CC5CurveSegment* edge = loop->GetEdgeAt(l);
-                                                if (!edge) continue;
-                                                if (edge->CoEdgeExisted() != CC5_TRUE)
-                                                    continue;
-
-                                                EDGE_FACE::iterator edge_face_itr = edge_face.find(edge->GetID());
-                                                if (edge_face_itr == edge_face.end()) {
-                                                    edge_face.insert(pair<int, CC5Face*>(edge->GetID(), pFace));
-                                                }
-                                                else {
-                                                    edge_face.insert(pair<int, CC5Face*>(edge->GetID(), pFace));
-
-                                                    //EDGE_FACE::iterator edge_face_itr;
-                                                    int counter = 0;
-                                                    for (int i = 0; i < 2; i++)
-                                                    {
-                                                        // bool bFaceMatched = true;
-                                                        CC5Face* pIntrmdtFace = nullptr;
-                                                        if (i == 0)
-                                                            pIntrmdtFace = dynamic_cast<CC5Face*>(pIntermdtEnt1);
-                                                        else
-                                                            pIntrmdtFace = dynamic_cast<CC5Face*>(pIntermdtEnt2);
-
-                                                        edge_face_itr = edge_face.lower_bound(edge->GetID());
-                                                        CC5Face* pFinalFace1 = edge_face_itr->second;
-                                                        CheckFaceInFaceGroups(pIntrmdtFace, pFinalFace1, bFaceMatched);
-
-                                                        if (bFaceMatched == false) {
-                                                            bFaceMatched = true;
-                                                            ++edge_face_itr;
-                                                            CC5Face* pFinalFace2 = edge_face_itr->second;
-                                                            CheckFaceInFaceGroups(pIntrmdtFace, pFinalFace2, bFaceMatched);
-                                                        }
-                                                        if (bFaceMatched == true) {
-                                                            counter++;
-                                                            if (counter == 2) entitiesinfinalsolid.push_back(edge);
-                                                            continue;
-                                                        }
-                                                        break;
-                                                    }
-                                                }
-                                            }
-                                        }
-                                    }
-                                    if (bFaceMatched == true) continue;
-                                    CC5ObjectDelete_ThreadSafe((CC5Object**)&pFace);
-                                }
-                                if (bFaceMatched == true) continue;
-                                CC5ObjectDelete_ThreadSafe((CC5Object**)&pSkin);
-                            }
-                        }
-                        if (bFaceMatched == true) continue;
-                        CC5ObjectDelete_ThreadSafe((CC5Object**)&pBody);
-                    }
-                }
-                if (bFaceMatched == true) continue;
-                CC5ObjectDelete_ThreadSafe((CC5Object**)&pEnt);
-            }
-        }
-        if (entitiesinfinalsolid.size() > iSize)
-            return pGrp->GetID();
-        ++finalBodyItr;
-    }
     return 0;
 }
 
@@ -1086,41 +574,36 @@ void GeometryReferenceBuilder::CheckFaceInFaceGroups(CC5Face* pFace, CC5Face* as
     }
 
     CC5PersistentID* pfacePersisID = nullptr;
-    CC5PersistentID* pAsscfacePersisID = nullptr;
     pFace->GetPersistentIdentifier(pfacePersisID);
-    asscFace->GetPersistentIdentifier(pAsscfacePersisID);
     if (!pfacePersisID) {
         bFaceMatched = false;
         return;
     }
-    for (int i = 0; i < pfacePersisID->GetGroupCount(); i++)
+
+    // Without any group on either side, bFaceMatched is left as passed in
+    int nGroups = pfacePersisID->GetGroupCount();
+    if (nGroups == 0)
+        return;
+
+    // The groups of asscFace are flattened once, then each group of pFace is searched among all of them at once
+    CATV5PMIPersistentID asscFacePersisID(asscFace);
+    CATV5PMIPersistentIDView asscFaceGroups = asscFacePersisID.View();
+    if (!asscFaceGroups.bExists) {
+        bFaceMatched = false;
+        return;
+    }
+    if (asscFaceGroups.nGroups == 0)
+        return;
+
+    ATF_PMI_COUNT(kCounter_PersistentIDComparisons, 1);
+    bFaceMatched = false;
+    for (int i = 0; i < nGroups && !bFaceMatched; i++)
     {
         int iSize = 0;
         int* iIDList = nullptr;
         pfacePersisID->GetGroupAt(i, iSize, iIDList);
-        if (!pAsscfacePersisID) {
-            bFaceMatched = false;
-            continue;
-        }
-        for (int j = 0; j < pAsscfacePersisID->GetGroupCount(); j++)
-        {
-            bFaceMatched = true;
-            int jSize = 0;
-            int* jIDList = nullptr;
-            pAsscfacePersisID->GetGroupAt(j, jSize, jIDList);
-            if (iSize != jSize)
-                bFaceMatched = false;
-            if (iSize == jSize) {
-                for (int k = 0; k < jSize; k++) {
-                    if (iIDList[k] != jIDList[k]) {
-                        bFaceMatched = false;
-                        break;
-                    }
-                }
-                if (bFaceMatched == true) break;
-            }
-            if (bFaceMatched == true) break;
-        }
-        if (bFaceMatched == true) break;
+        uint32_t groupSize = iIDList && iSize > 0 ? static_cast<uint32_t>(iSize) : 0;
+        bFaceMatched = CATV5PMIPersistentIDKernel::FindGroup(iIDList, groupSize,
+            asscFaceGroups.ids, asscFaceGroups.groupOffsets, asscFaceGroups.nGroups);
     }
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include <vector>
+
+namespace ATF
+{
+    // Owns an object returned by the CATIA reader (GetEntityAt, GetFaceAt, GetEdgeAt...) and frees it
+    // with CC5ObjectDelete_ThreadSafe when going out of scope, whichever continue/return path is taken.
+    // Release() hands the object over to a longer-lived owner.
+    template <class T>
+    class CC5ObjectHandle
+    {
+    public:
+        explicit CC5ObjectHandle(T* pObject = nullptr)
+            : m_pObject(pObject)
+        {}
+
+        CC5ObjectHandle(CC5ObjectHandle&& other)
+            : m_pObject(other.Release())
+        {}
+
+        CC5ObjectHandle& operator=(CC5ObjectHandle&& other)
+        {
+            if (this != &other)
+                Reset(other.Release());
+            return *this;
+        }
+
+        ~CC5ObjectHandle()
+        {
+            Reset();
+        }
+
+        T* Get() const { return m_pObject; }
+        T* operator->() const { return m_pObject; }
+        explicit operator bool() const { return m_pObject != nullptr; }
+
+        T* Release()
+        {
+            T* pObject = m_pObject;
+            m_pObject = nullptr;
+            return pObject;
+        }
+
+        void Reset(T* pObject = nullptr)
+        {
+            if (m_pObject)
+            {
+                CC5Object* pDelete = m_pObject;
+                CC5ObjectDelete_ThreadSafe(&pDelete);
+            }
+            m_pObject = pObject;
+        }
+
+    private:
+        CC5ObjectHandle(const CC5ObjectHandle&) = delete;
+        CC5ObjectHandle& operator=(const CC5ObjectHandle&) = delete;
+
+        T* m_pObject;
+    };
+
+    // Collects the CC5 objects fetched while resolving one annotation, and frees them all at once
+    // when the resolution is done. Objects can then be handed around as resolved entities, compared
+    // and read without tracking which path still needs them.
+    class CC5ReleaseArena
+    {
+    public:
+        CC5ReleaseArena()
+        {}
+
+        ~CC5ReleaseArena()
+        {
+            Clear();
+        }
+
+        // Returns pObject, now owned by the arena
+        template <class T>
+        T* Track(T* pObject)
+        {
+            if (pObject)
+                m_objects.push_back(pObject);
+            return pObject;
+        }
+
+        // Frees the objects, children before the parents they were fetched from
+        void Clear()
+        {
+            for (auto itr = m_objects.rbegin(); itr != m_objects.rend(); ++itr)
+            {
+                CC5Object* pDelete = *itr;
+                CC5ObjectDelete_ThreadSafe(&pDelete);
+            }
+            m_objects.clear();
+        }
+
+        size_t Size() const { return m_objects.size(); }
+
+    private:
+        CC5ReleaseArena(const CC5ReleaseArena&) = delete;
+        CC5ReleaseArena& operator=(const CC5ReleaseArena&) = delete;
+
+        std::vector<CC5Object*> m_objects;
+    };
+}
@@ -0,0 +1,143 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_annotation_cache.h"
+#include "atf_catv5_pmi_session.h"
+#include "atf_catv5_pmi_stats.h"
+#include "atf_catv5_pmi_tps_dispatch.h"
+#include "atf_catv5_pmi_translation.h"
+#include "atf_catv5_util.h"
+
+#include <mutex>
+#include <unordered_map>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    typedef unordered_map<CC5TPSShape*, shared_ptr<const CATV5PMIAnnotationDescriptor>> DESCRIPTORMAP;
+
+    // Descriptors of the annotations of one session
+    struct DescriptorRegistry
+    {
+        mutex descriptorMutex;
+        DESCRIPTORMAP descriptors;
+    };
+
+    // Null outside of any session; the lookups enter the part's kept session first (see CATV5PMIPartSessionScope)
+    DescriptorRegistry* Registry()
+    {
+        CATV5PMISession* pSession = CATV5PMISession::Current();
+        return pSession ? &pSession->State<DescriptorRegistry>(CATV5PMISession::kSlot_AnnotationDescriptors) : nullptr;
+    }
+}
+
+shared_ptr<const CATV5PMIAnnotationDescriptor> CATV5PMIAnnotationCache::Lookup(CC5TPSShape* pShape)
+{
+    if (!pShape)
+        return nullptr;
+
+    // AnnotationObjectId and IsAnnotationVisible are called per annotation, outside of the producer's session
+    CATV5PMIPartSessionScope partSessionScope;
+    shared_ptr<const CATV5PMIAnnotationDescriptor> pDescriptor = Find(pShape);
+    if (pDescriptor)
+    {
+        ATF_PMI_COUNT(kCounter_AnnotationCacheHits, 1);
+        return pDescriptor;
+    }
+
+    ATF_PMI_COUNT(kCounter_AnnotationCacheMisses, 1);
+    // Described outside of the lock; if another thread got there first, its descriptor is kept
+    pDescriptor = Describe(pShape);
+    return pDescriptor ? Store(pShape, pDescriptor) : nullptr;
+}
+
+ObjectId CATV5PMIAnnotationCache::AnnotationObjectId(CC5TPSShape* pShape, const CATV5PMIAnnotationDescriptor& descriptor, const ObjectId& parentId)
+{
+    ObjectId annotationObjId;
+    bool bSupported = CATV5PMITPSDispatch::Visit(pShape, descriptor.type, [&](auto* pAnnotationObj)
+    {
+        CATV5Util::CATV5ObjectId(pAnnotationObj, parentId, annotationObjId);
+    });
+    if (bSupported)
+        annotationObjId.Append("_callout");
+    return annotationObjId;
+}
+
+void CATV5PMIAnnotationCache::Release(CC5TPSShape* pShape)
+{
+    CATV5PMIPartSessionScope partSessionScope;
+    DescriptorRegistry* pRegistry = Registry();
+    if (!pRegistry)
+        return;
+    lock_guard<mutex> lock(pRegistry->descriptorMutex);
+    pRegistry->descriptors.erase(pShape);
+}
+
+void CATV5PMIAnnotationCache::Clear()
+{
+    DescriptorRegistry* pRegistry = Registry();
+    if (!pRegistry)
+        return;
+
+    DESCRIPTORMAP descriptorMap;
+    {
+        lock_guard<mutex> lock(pRegistry->descriptorMutex);
+        descriptorMap.swap(pRegistry->descriptors);
+    }
+}
+
+shared_ptr<const CATV5PMIAnnotationDescriptor> CATV5PMIAnnotationCache::Find(CC5TPSShape* pShape)
+{
+    DescriptorRegistry* pRegistry = Registry();
+    if (!pRegistry)
+        return nullptr;
+    lock_guard<mutex> lock(pRegistry->descriptorMutex);
+    auto itr = pRegistry->descriptors.find(pShape);
+    return itr != pRegistry->descriptors.end() ? itr->second : nullptr;
+}
+
+// Keeps the stored descriptor, if another thread stored one first
+shared_ptr<const CATV5PMIAnnotationDescriptor> CATV5PMIAnnotationCache::Store(CC5TPSShape* pShape, shared_ptr<const CATV5PMIAnnotationDescriptor> pDescriptor)
+{
+    DescriptorRegistry* pRegistry = Registry();
+    if (!pRegistry)
+        return pDescriptor;
+    DescriptorRegistry& registry = *pRegistry;
+    lock_guard<mutex> lock(registry.descriptorMutex);
+    shared_ptr<const CATV5PMIAnnotationDescriptor>& pEntry = registry.descriptors[pShape];
+    if (!pEntry)
+        pEntry = pDescriptor;
+    return pEntry;
+}
+
+shared_ptr<CATV5PMIAnnotationDescriptor> CATV5PMIAnnotationCache::Describe(CC5TPSShape* pShape)
+{
+    CC5_TPS_TYPE type = CC5_TPS_UNKNOWN;
+    CC5_ERROR err = pShape->GetTPSType(type);
+    if (err != CC5_QUERY_SUCCESS || type == CC5_TPS_UNKNOWN)
+        return nullptr;
+
+    shared_ptr<CATV5PMIAnnotationDescriptor> pDescriptor(new CATV5PMIAnnotationDescriptor());
+    pDescriptor->type = type;
+    pDescriptor->bVisible = false;
+    pDescriptor->pAssociatedEntity = nullptr;
+    pDescriptor->bSupported = CATV5PMITPSDispatch::Visit(pShape, type, [&](auto* pAnnotationObj)
+    {
+        int bVisible = 1;
+        pAnnotationObj->IsVisible(bVisible);
+        pDescriptor->bVisible = bVisible == 1;
+
+        pAnnotationObj->GetAssociatedGeoEntity(pDescriptor->pAssociatedEntity);
+    });
+    return pDescriptor;
+}
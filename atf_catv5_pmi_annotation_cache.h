@@ -0,0 +1,55 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include "atf_catv5_pmi_util.h"
+
+#include <memory>
+
+namespace ATF
+{
+    // Properties of an annotation, read from the CATIA reader in one pass
+    struct CATV5PMIAnnotationDescriptor
+    {
+        CC5_TPS_TYPE type;
+        // False for the annotation types not translated as PMI, the other fields are then left empty
+        bool bSupported;
+        bool bVisible;
+        // As given by GetAssociatedGeoEntity, not owned
+        CC5Entity* pAssociatedEntity;
+    };
+
+    // Descriptors of the annotations met during the translation, keyed by shape.
+    // GetTPSType, IsVisible and the associated entity are queried together on the first lookup of a shape;
+    // AnnotationObjectId, IsAnnotationVisible and the association then share the result.
+    // The descriptors are kept per CATV5PMISession, the functions working on the thread's current session,
+    // or outside of any session on the session kept for the producer's part (see CATV5PMIPartSessionScope).
+    class CATV5PMIAnnotationCache
+    {
+    public:
+        // Returns the descriptor of pShape, null for a null shape or a shape whose type cannot be read.
+        static std::shared_ptr<const CATV5PMIAnnotationDescriptor> Lookup(CC5TPSShape* pShape);
+
+        // The "_callout" id of the annotation under parentId, as built by CATV5PMIUtil::AnnotationObjectId.
+        // Built on every call: a shape reached through several parents (instances of its part) has one id per parent.
+        static ObjectId AnnotationObjectId(CC5TPSShape* pShape, const CATV5PMIAnnotationDescriptor& descriptor, const ObjectId& parentId);
+
+        // Drops the descriptor of pShape, before the shape is deleted
+        static void Release(CC5TPSShape* pShape);
+
+        // Drops all descriptors, at the end of the translation (see CATV5PMITranslation)
+        static void Clear();
+
+    private:
+        static std::shared_ptr<const CATV5PMIAnnotationDescriptor> Find(CC5TPSShape* pShape);
+        static std::shared_ptr<const CATV5PMIAnnotationDescriptor> Store(CC5TPSShape* pShape, std::shared_ptr<const CATV5PMIAnnotationDescriptor> pDescriptor);
+        static std::shared_ptr<CATV5PMIAnnotationDescriptor> Describe(CC5TPSShape* pShape);
+    };
+}
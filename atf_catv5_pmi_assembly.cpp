@@ -0,0 +1,94 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_assembly.h"
+#include "atf_catv5_pmi_part_context.h"
+#include "atf_catv5_pmi_thread_pool.h"
+#include "atf_catv5_pmi_trace.h"
+#include "atf_catv5_pmi_translation.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    // Parts per pool thread in a window: enough for the threads to stay busy when the parts
+    // of the window have very different annotation counts
+    const size_t kPartsPerThread = 4;
+}
+
+void CATV5PMIAssemblyScheduler::ReferencedGeometryIds(const vector<CATV5PMIAssemblyPart>& parts
+    , vector<vector<vector<int>>>& ids
+    , CATV5PMIWorkStealingPool* pPool)
+{
+    ids.assign(parts.size(), vector<vector<int>>());
+
+    // The windows are resolved in one session, the contexts of each part being registered in it
+    unique_ptr<CATV5PMITranslation> pTranslation = CATV5PMITranslation::OpenIfNone();
+
+    size_t nThreads = pPool ? pPool->GetThreadCount() : 1;
+    size_t windowSize = max<size_t>(1, nThreads * kPartsPerThread);
+    size_t iFirst = 0;
+    while (iFirst < parts.size())
+    {
+        ATF_PMI_TRACE_SPAN_ID("CATV5PMIAssemblyScheduler window", static_cast<int64_t>(iFirst));
+
+        // A part has one context at a time: the window ends before a part already in it with other groups,
+        // which then goes to the next window. The same part with the same groups shares its context.
+        size_t iEnd = iFirst;
+        unordered_map<CC5Part*, size_t> windowParts;
+        for (; iEnd < parts.size() && iEnd - iFirst < windowSize; iEnd++)
+        {
+            if (!parts[iEnd].pPart)
+                continue;
+            auto inserted = windowParts.emplace(parts[iEnd].pPart, iEnd);
+            if (!inserted.second && parts[inserted.first->second].translatableGroups != parts[iEnd].translatableGroups)
+                break;
+        }
+
+        // The associations of the window are resolved as one batch
+        vector<GeometryAssociation> associations;
+        vector<size_t> partOf;
+        vector<shared_ptr<const CATV5PMIPartContext>> previousContexts(iEnd - iFirst);
+        for (size_t iPart = iFirst; iPart < iEnd; iPart++)
+        {
+            const CATV5PMIAssemblyPart& part = parts[iPart];
+            if (!part.pPart)
+                continue;
+            CATV5PMIPartContext::Register(part.pPart, part.translatableGroups, &previousContexts[iPart - iFirst]);
+            associations.insert(associations.end(), part.associations.begin(), part.associations.end());
+            partOf.insert(partOf.end(), part.associations.size(), iPart);
+        }
+
+        vector<vector<int>> windowIds;
+        GeometryReferenceBatch::ReferencedGeometryIds(associations, windowIds, pPool);
+
+        // Back to the parts, in the order of their associations
+        for (size_t i = 0; i < windowIds.size(); i++)
+            ids[partOf[i]].push_back(move(windowIds[i]));
+
+        // The registry is left as the window found it, a context the caller registered being put back;
+        // in reverse order, so that a part appearing twice gets its first previous context back
+        for (size_t iPart = iEnd; iPart-- > iFirst;)
+        {
+            if (parts[iPart].pPart)
+                CATV5PMIPartContext::Restore(parts[iPart].pPart, move(previousContexts[iPart - iFirst]));
+        }
+        iFirst = iEnd;
+    }
+
+    // A part without CC5Part still gets one empty result per association
+    for (size_t iPart = 0; iPart < parts.size(); iPart++)
+        ids[iPart].resize(parts[iPart].associations.size());
+}
@@ -0,0 +1,46 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include "atf_catv5_pmi_batch.h"
+#include "atf_catv5_pmi_util.h"
+
+#include <vector>
+
+namespace ATF
+{
+    class CATV5PMIWorkStealingPool;
+
+    // One part of an assembly: its translatable groups, as the producer would give them for the part,
+    // and the associations of its annotations.
+    struct CATV5PMIAssemblyPart
+    {
+        CC5Part* pPart;
+        FINALBODYLIST translatableGroups;
+        std::vector<GeometryAssociation> associations;
+    };
+
+    // Resolves the referenced geometry of the annotations of many parts at once.
+    // Each part gets its own CATV5PMIPartContext built from its translatable groups, so nothing is read
+    // from the producer's state of the part being translated. The annotations of several parts are
+    // resolved together on the pool, the part indexes being built by the first task needing them.
+    class CATV5PMIAssemblyScheduler
+    {
+    public:
+        // ids[p][i] receives the ids of parts[p].associations[i], whatever the scheduling.
+        // The parts are taken by windows of a few parts per pool thread, the contexts of a window being
+        // released once it is done, so that the indexes of a large assembly are not all alive at once.
+        // A context registered for a part before the call is put back afterwards. A part given twice with
+        // different groups is resolved in separate windows, each with its own groups.
+        static void ReferencedGeometryIds(const std::vector<CATV5PMIAssemblyPart>& parts
+            , std::vector<std::vector<std::vector<int>>>& ids
+            , CATV5PMIWorkStealingPool* pPool = nullptr);
+    };
+}
@@ -0,0 +1,201 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_annotation_cache.h"
+#include "atf_catv5_pmi_batch.h"
+#include "atf_catv5_pmi_geometry_cache.h"
+#include "atf_catv5_pmi_part_context.h"
+#include "atf_catv5_pmi_session.h"
+#include "atf_catv5_pmi_thread_pool.h"
+#include "atf_catv5_pmi_trace.h"
+#include "atf_catv5_pmi_translation.h"
+
+#include <map>
+#include <tuple>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    const size_t kNotResolved = static_cast<size_t>(-1);
+
+    // Cache keys of the associations having an annotation id, with the context of their part, kept alive until
+    // the results are stored. The index of the part is only built for a part without partKey, or once a lookup
+    // missed: the source hash is left to 0 until then.
+    struct CacheEntry
+    {
+        bool bCacheable;
+        CATV5PMIGeometryCacheKey key;
+        shared_ptr<const CATV5PMIPartContext> pContext;
+    };
+
+    vector<CacheEntry> CacheEntries(const vector<GeometryAssociation>& associations, map<CC5Part*, shared_ptr<const CATV5PMIPartContext>>& contexts)
+    {
+        vector<CacheEntry> entries(associations.size());
+        for (size_t i = 0; i < associations.size(); i++)
+        {
+            const GeometryAssociation& association = associations[i];
+            entries[i].bCacheable = false;
+            if (!association.pEntity || !association.pPart || association.annotationId.empty())
+                continue;
+
+            // Points are resolved by position, which neither the part key nor the fingerprints cover
+            int entityType = association.pEntity->GetType();
+            if (entityType == CC5_POINT_TYPE || entityType == CC5_POINTONCURVE_TYPE || entityType == CC5_POINTONSURFACE_TYPE)
+                continue;
+
+            shared_ptr<const CATV5PMIPartContext>& pContext = contexts[association.pPart];
+            if (!pContext)
+                pContext = CATV5PMIPartContext::ForPart(association.pPart);
+            if (!pContext)
+                continue;
+
+            entries[i].bCacheable = true;
+            entries[i].pContext = pContext;
+            entries[i].key.partHash = association.partKey != 0 ? association.partKey : pContext->Index().ContentHash();
+            entries[i].key.sourceHash = 0;
+            entries[i].key.annotationId = association.annotationId;
+            entries[i].key.entityId = association.pEntity->GetID();
+            entries[i].key.entityType = entityType;
+        }
+        return entries;
+    }
+
+    vector<uint64_t> FingerprintsOf(const CATV5PMIPartIndex& index, const vector<int>& ids)
+    {
+        vector<uint64_t> fingerprints(ids.size());
+        for (size_t k = 0; k < ids.size(); k++)
+            fingerprints[k] = index.Fingerprint(ids[k]);
+        return fingerprints;
+    }
+
+    // The previous revision's result is still valid when the associated entity still resolves through the
+    // same intermediate geometry (checked by LookupPrevious on the source hash), and every id it gave is
+    // still a final face or edge with the same fingerprint. Results holding anything else (an intermediate entity, a translatable
+    // group) are always resolved again. Gives the entry its source hash, for the result to be stored.
+    bool ReusePrevious(CacheEntry& entry, CC5Entity* pEntity, vector<int>& ids)
+    {
+        const CATV5PMIPartIndex& index = entry.pContext->Index();
+        entry.key.sourceHash = index.AssociationFingerprint(pEntity);
+
+        vector<int> previousIds;
+        vector<uint64_t> previousFingerprints;
+        if (!CATV5PMIGeometryCache::LookupPrevious(entry.key, previousIds, previousFingerprints) || previousIds.empty())
+            return false;
+
+        for (size_t k = 0; k < previousIds.size(); k++)
+        {
+            if (previousFingerprints[k] == 0 || index.Fingerprint(previousIds[k]) != previousFingerprints[k])
+                return false;
+        }
+        ids.swap(previousIds);
+        return true;
+    }
+}
+
+GeometryAssociation GeometryReferenceBatch::AssociationOf(CC5TPSShape* pShape, CC5Part* pPart)
+{
+    GeometryAssociation association = { nullptr, pPart, string(), 0 };
+    shared_ptr<const CATV5PMIAnnotationDescriptor> pDescriptor = CATV5PMIAnnotationCache::Lookup(pShape);
+    if (pDescriptor && pDescriptor->bSupported)
+        association.pEntity = pDescriptor->pAssociatedEntity;
+    return association;
+}
+
+void GeometryReferenceBatch::ReferencedGeometryIds(const vector<GeometryAssociation>& associations
+    , vector<vector<int>>& ids
+    , CATV5PMIWorkStealingPool* pPool)
+{
+    ids.assign(associations.size(), vector<int>());
+
+    // Outside of a translation of the producer, the part contexts are shared by the batch only
+    unique_ptr<CATV5PMITranslation> pTranslation = CATV5PMITranslation::OpenIfNone();
+
+    // The result only depends on the entity, so an entity referenced by several annotations
+    // (e.g. a datum and the tolerances pointing at it) is resolved once.
+    typedef tuple<CC5Part*, int, int> ENTITYKEY;
+    map<ENTITYKEY, size_t> resolved;
+    vector<size_t> resolvedFrom(associations.size(), kNotResolved);
+    for (size_t i = 0; i < associations.size(); i++)
+    {
+        const GeometryAssociation& association = associations[i];
+        if (!association.pEntity || !association.pPart)
+            continue;
+
+        ENTITYKEY key(association.pPart, association.pEntity->GetID(), association.pEntity->GetType());
+        resolvedFrom[i] = resolved.emplace(key, i).first->second;
+    }
+
+    // Cache hits get their ids directly, from the same part or from a previous revision whose referenced
+    // geometry did not change. An entity is resolved if any of its associations missed.
+    map<CC5Part*, shared_ptr<const CATV5PMIPartContext>> contexts;
+    vector<CacheEntry> cacheEntries;
+    vector<bool> cacheHit(associations.size(), false);
+    vector<bool> fromPrevious(associations.size(), false);
+    if (CATV5PMIGeometryCache::IsOpen())
+    {
+        cacheEntries = CacheEntries(associations, contexts);
+        for (size_t i = 0; i < associations.size(); i++)
+        {
+            if (!cacheEntries[i].bCacheable)
+                continue;
+            cacheHit[i] = CATV5PMIGeometryCache::Lookup(cacheEntries[i].key, ids[i]);
+            if (!cacheHit[i])
+                cacheHit[i] = fromPrevious[i] = ReusePrevious(cacheEntries[i], associations[i].pEntity, ids[i]);
+        }
+    }
+
+    vector<bool> needed(associations.size(), false);
+    for (size_t i = 0; i < associations.size(); i++)
+    {
+        if (resolvedFrom[i] != kNotResolved && !cacheHit[i])
+            needed[resolvedFrom[i]] = true;
+    }
+
+    vector<size_t> toResolve;
+    for (size_t i = 0; i < associations.size(); i++)
+    {
+        if (needed[i])
+            toResolve.push_back(i);
+    }
+
+    // Each task writes its own ids slot, so the output order does not depend on the scheduling.
+    // The pool threads work in the session of the calling thread.
+    CATV5PMISession* pSession = CATV5PMISession::Current();
+    auto resolve = [&](size_t iTask)
+    {
+        CATV5PMISessionScope sessionScope(pSession);
+        size_t i = toResolve[iTask];
+        ATF_PMI_TRACE_SPAN_ID("GeometryReferenceBuilder", associations[i].pEntity->GetID());
+        GeometryReferenceBuilder builder(associations[i].pEntity, associations[i].pPart);
+        ids[i].clear();
+        builder.ReferencedGeometryIds(ids[i]);
+    };
+
+    if (pPool)
+        pPool->ParallelFor(toResolve.size(), resolve);
+    else
+    {
+        for (size_t iTask = 0; iTask < toResolve.size(); iTask++)
+            resolve(iTask);
+    }
+
+    for (size_t i = 0; i < associations.size(); i++)
+    {
+        if (resolvedFrom[i] == kNotResolved || (cacheHit[i] && !fromPrevious[i]))
+            continue;
+        if (!cacheHit[i] && resolvedFrom[i] != i)
+            ids[i] = ids[resolvedFrom[i]];
+        if (!cacheEntries.empty() && cacheEntries[i].bCacheable)
+            CATV5PMIGeometryCache::Store(cacheEntries[i].key, ids[i], FingerprintsOf(cacheEntries[i].pContext->Index(), ids[i]));
+    }
+}
@@ -0,0 +1,53 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include "atf_catv5_pmi_util.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ATF
+{
+    class CATV5PMIWorkStealingPool;
+
+    // Geometry an annotation is associated to: the entity returned by GetAssociatedGeoEntity(...)
+    // of the CC5TPSShape, and the part holding it.
+    struct GeometryAssociation
+    {
+        CC5Entity* pEntity;
+        CC5Part* pPart;
+        // String form of the annotation's id (CATV5PMIUtil::AnnotationObjectId), keying the association
+        // in CATV5PMIGeometryCache. Left empty, the association is always resolved.
+        std::string annotationId;
+        // Revision of the part in CATV5PMIGeometryCache, e.g. CATV5PMIGeometryCache::FileKey of its source file,
+        // so that the part is only indexed when a lookup misses. 0 to key the part by the content of its index.
+        uint64_t partKey;
+    };
+
+    // Resolves the referenced geometry of all the annotations of a part in one call.
+    class GeometryReferenceBatch
+    {
+    public:
+        // Association of pShape, from the entity cached by CATV5PMIAnnotationCache.
+        // pEntity is null for an unsupported annotation or one without associated geometry.
+        static GeometryAssociation AssociationOf(CC5TPSShape* pShape, CC5Part* pPart);
+
+        // ids[i] receives what GeometryReferenceBuilder::ReferencedGeometryIds gives for associations[i].
+        // Associations to the same entity of the same part are resolved once.
+        // With a pool, the annotations are resolved in parallel; ids keeps the order of associations.
+        // When CATV5PMIGeometryCache is open, the associations having an annotationId are looked up there
+        // first, and those resolved are stored into it.
+        static void ReferencedGeometryIds(const std::vector<GeometryAssociation>& associations
+            , std::vector<std::vector<int>>& ids
+            , CATV5PMIWorkStealingPool* pPool = nullptr);
+    };
+}
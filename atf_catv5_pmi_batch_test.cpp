@@ -0,0 +1,126 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_batch.h"
+#include "atf_catv5_pmi_fake_reader.h"
+#include "atf_catv5_pmi_geometry_cache.h"
+#include "atf_catv5_pmi_stats.h"
+#include "atf_catv5_pmi_translation.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    // Calls of a timer of the part, from its stats summary
+    uint64_t TimerCalls(CC5Part* pPart, const string& timerName)
+    {
+        string json = CATV5PMIStats::SummaryJson(pPart);
+        string field = "\"" + timerName + "\":{\"calls\":";
+        size_t position = json.find(field);
+        return position != string::npos ? strtoull(json.c_str() + position + field.size(), nullptr, 10) : 0;
+    }
+
+    // The index is built in the part's stats scope, or outside of any when the batch keys the cache
+    uint64_t IndexBuilds(CC5Part* pPart)
+    {
+        return TimerCalls(pPart, "part_index_build") + TimerCalls(nullptr, "part_index_build");
+    }
+
+    class GeometryReferenceBatchTest : public testing::Test
+    {
+    protected:
+        GeometryReferenceBatchTest()
+            : m_strip(m_model, 2, 4)
+        {}
+
+        void SetUp() override
+        {
+            m_filePath = testing::TempDir() + "atf_catv5_pmi_batch_test.bin";
+            remove(m_filePath.c_str());
+            ASSERT_TRUE(CATV5PMIGeometryCache::Open(m_filePath));
+        }
+
+        void TearDown() override
+        {
+            CATV5PMIGeometryCache::Close();
+            remove(m_filePath.c_str());
+            CATV5PMIStats::Release(m_model.Part());
+        }
+
+        // The face and edge references of the part, each with its annotation id
+        vector<GeometryAssociation> Associations(uint64_t partKey) const
+        {
+            vector<GeometryAssociation> associations;
+            for (int b = 0; b < 2; b++)
+            {
+                for (CC5Entity* pEntity : m_strip.faceReferences[b])
+                    associations.push_back({ pEntity, m_model.Part(), "annotation_" + to_string(associations.size()), partKey });
+                for (CC5Entity* pEntity : m_strip.edgeReferences[b])
+                    associations.push_back({ pEntity, m_model.Part(), "annotation_" + to_string(associations.size()), partKey });
+            }
+            return associations;
+        }
+
+        // Resolves the associations in a translation of their own, as for one conversion of the part;
+        // returns the number of index builds it took
+        uint64_t Translate(const vector<GeometryAssociation>& associations, vector<vector<int>>& ids)
+        {
+            uint64_t nBuilds = IndexBuilds(m_model.Part());
+            CATV5PMITranslation translation(m_model.TranslatableGroups(), nullptr);
+            GeometryReferenceBatch::ReferencedGeometryIds(associations, ids);
+            return IndexBuilds(m_model.Part()) - nBuilds;
+        }
+
+        FakeCC5Model m_model;
+        FakeCC5StripPart m_strip;
+        string m_filePath;
+    };
+}
+
+TEST_F(GeometryReferenceBatchTest, HitByPartKeyBuildsNoIndex)
+{
+    vector<GeometryAssociation> associations = Associations(42);
+    vector<vector<int>> coldIds;
+    EXPECT_EQ(1u, Translate(associations, coldIds));
+    ASSERT_EQ(associations.size(), coldIds.size());
+    EXPECT_EQ(vector<int>({ m_strip.finalFaces[0][0]->GetID() }), coldIds.front());
+
+    vector<vector<int>> warmIds;
+    EXPECT_EQ(0u, Translate(associations, warmIds));
+    EXPECT_EQ(coldIds, warmIds);
+}
+
+TEST_F(GeometryReferenceBatchTest, HitByContentBuildsTheIndex)
+{
+    vector<GeometryAssociation> associations = Associations(0);
+    vector<vector<int>> coldIds;
+    EXPECT_EQ(1u, Translate(associations, coldIds));
+
+    vector<vector<int>> warmIds;
+    EXPECT_EQ(1u, Translate(associations, warmIds));
+    EXPECT_EQ(coldIds, warmIds);
+}
+
+TEST_F(GeometryReferenceBatchTest, AnotherPartKeyMisses)
+{
+    vector<vector<int>> coldIds;
+    EXPECT_EQ(1u, Translate(Associations(42), coldIds));
+
+    vector<vector<int>> ids;
+    EXPECT_EQ(1u, Translate(Associations(43), ids));
+    EXPECT_EQ(coldIds, ids);
+}
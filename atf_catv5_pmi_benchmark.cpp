@@ -0,0 +1,304 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_object_handle.h"
+#include "atf_catv5_pmi_batch.h"
+#include "atf_catv5_pmi_dense_ids.h"
+#include "atf_catv5_pmi_fake_reader.h"
+#include "atf_catv5_pmi_geometry_cache.h"
+#include "atf_catv5_pmi_part_index.h"
+#include "atf_catv5_pmi_simd.h"
+#include "atf_catv5_pmi_thread_pool.h"
+#include "atf_catv5_pmi_translation.h"
+#include "atf_catv5_producer_impl.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace ATF;
+using namespace std;
+
+// Scaling of the lookups the association runs per annotation, on parts of N final faces generated with
+// the fake reader of pmi_test (see FakeCC5StripPart). The per-lookup cost must stay flat while N grows.
+namespace
+{
+    const int kBodies = 4;
+
+    // Part of nFaces final faces in kBodies bodies, and its index
+    struct StripFixture
+    {
+        explicit StripFixture(int nFaces)
+            : strip(model, kBodies, nFaces / kBodies)
+            , index(model.Part(), model.TranslatableGroups(), FINALBODYLIST())
+        {}
+
+        FakeCC5Model model;
+        FakeCC5StripPart strip;
+        CATV5PMIPartIndex index;
+    };
+
+    // Built once per size, for all the benchmarks
+    StripFixture& Fixture(int nFaces)
+    {
+        static map<int, unique_ptr<StripFixture>> s_fixtures;
+        unique_ptr<StripFixture>& pFixture = s_fixtures[nFaces];
+        if (!pFixture)
+            pFixture.reset(new StripFixture(nFaces));
+        return *pFixture;
+    }
+
+    // The items in a fixed pseudo-random order, so that the lookups do not walk the part in memory order
+    template <class T>
+    vector<T> Shuffled(vector<T> items)
+    {
+        shuffle(items.begin(), items.end(), mt19937(1));
+        return items;
+    }
+
+    template <class T>
+    vector<T> Flattened(const vector<vector<T>>& itemsByBody)
+    {
+        vector<T> items;
+        for (const vector<T>& bodyItems : itemsByBody)
+            items.insert(items.end(), bodyItems.begin(), bodyItems.end());
+        return items;
+    }
+
+    // The face and edge references of the part, alternately
+    vector<CC5Entity*> References(const FakeCC5StripPart& strip)
+    {
+        vector<CC5Entity*> faceReferences = Flattened(strip.faceReferences);
+        vector<CC5Entity*> edgeReferences = Flattened(strip.edgeReferences);
+        vector<CC5Entity*> references;
+        for (size_t i = 0; i < max(faceReferences.size(), edgeReferences.size()); i++)
+        {
+            if (i < faceReferences.size())
+                references.push_back(faceReferences[i]);
+            if (i < edgeReferences.size())
+                references.push_back(edgeReferences[i]);
+        }
+        return Shuffled(references);
+    }
+
+    // Probes for an annotation mix: half owned IDs, half IDs of modified geometry
+    vector<int> Probes(const vector<int>& faceIds, size_t nProbes)
+    {
+        vector<int> probes(nProbes);
+        mt19937 random(2);
+        for (size_t i = 0; i < nProbes; i++)
+            probes[i] = i % 2 ? faceIds[random() % faceIds.size()] : -1 - static_cast<int>(random() % faceIds.size());
+        return probes;
+    }
+
+    // CATV5PMIPartIndex::FinalFaceOwner, for the final faces and their intermediate twins
+    void BM_FinalFaceOwner(benchmark::State& state)
+    {
+        StripFixture& fixture = Fixture(static_cast<int>(state.range(0)));
+        vector<int> probes;
+        for (CC5Face* pFace : Flattened(fixture.strip.finalFaces))
+            probes.push_back(pFace->GetID());
+        for (CC5Face* pFace : Flattened(fixture.strip.intermediateFaces))
+            probes.push_back(pFace->GetID());
+        probes = Shuffled(probes);
+
+        size_t iProbe = 0;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(fixture.index.FinalFaceOwner(probes[iProbe]));
+            iProbe = iProbe + 1 < probes.size() ? iProbe + 1 : 0;
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetComplexityN(state.range(0));
+    }
+    BENCHMARK(BM_FinalFaceOwner)->RangeMultiplier(8)->Range(128, 32768)->Complexity();
+
+    // CATV5PMIPartIndex::FindFacesByPersistentID from each intermediate face, the final face being fetched again
+    void BM_FindFacesByPersistentID(benchmark::State& state)
+    {
+        StripFixture& fixture = Fixture(static_cast<int>(state.range(0)));
+        vector<CC5Face*> faces = Shuffled(Flattened(fixture.strip.intermediateFaces));
+
+        size_t iFace = 0;
+        ENTITIESINFINALSOLID entities;
+        for (auto _ : state)
+        {
+            CC5ReleaseArena fetched;
+            entities.clear();
+            benchmark::DoNotOptimize(fixture.index.FindFacesByPersistentID(faces[iFace], entities, fetched));
+            iFace = iFace + 1 < faces.size() ? iFace + 1 : 0;
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetComplexityN(state.range(0));
+    }
+    BENCHMARK(BM_FindFacesByPersistentID)->RangeMultiplier(8)->Range(128, 32768)->Complexity();
+
+    // CATV5PMIPartIndex::FindEdgesByAdjacentFaces from each pair of adjacent intermediate faces
+    void BM_FindEdgesByAdjacentFaces(benchmark::State& state)
+    {
+        StripFixture& fixture = Fixture(static_cast<int>(state.range(0)));
+        vector<pair<CC5Face*, CC5Face*>> pairs;
+        for (const vector<CC5Face*>& faces : fixture.strip.intermediateFaces)
+        {
+            for (size_t f = 0; f + 1 < faces.size(); f++)
+                pairs.emplace_back(faces[f], faces[f + 1]);
+        }
+        pairs = Shuffled(pairs);
+
+        size_t iPair = 0;
+        ENTITIESINFINALSOLID entities;
+        for (auto _ : state)
+        {
+            CC5ReleaseArena fetched;
+            entities.clear();
+            benchmark::DoNotOptimize(fixture.index.FindEdgesByAdjacentFaces(pairs[iPair].first, pairs[iPair].second, entities, fetched));
+            iPair = iPair + 1 < pairs.size() ? iPair + 1 : 0;
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetComplexityN(state.range(0));
+    }
+    BENCHMARK(BM_FindEdgesByAdjacentFaces)->RangeMultiplier(8)->Range(128, 32768)->Complexity();
+
+    // One GeometryReferenceBuilder per annotation, as the producer calls it, the part context being built beforehand
+    void BM_ReferencedGeometryIds(benchmark::State& state)
+    {
+        StripFixture& fixture = Fixture(static_cast<int>(state.range(0)));
+        vector<CC5Entity*> references = References(fixture.strip);
+        CATV5ProducerImpl::Get()->SetTranslatableGroups(fixture.model.TranslatableGroups());
+
+        vector<int> ids;
+        GeometryReferenceBuilder(references.front(), fixture.model.Part()).ReferencedGeometryIds(ids);
+
+        size_t iReference = 0;
+        for (auto _ : state)
+        {
+            ids.clear();
+            GeometryReferenceBuilder builder(references[iReference], fixture.model.Part());
+            benchmark::DoNotOptimize(builder.ReferencedGeometryIds(ids));
+            iReference = iReference + 1 < references.size() ? iReference + 1 : 0;
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetComplexityN(state.range(0));
+
+        CATV5PMIPartSessionScope::Close();
+        CATV5ProducerImpl::Get()->SetTranslatableGroups(FINALBODYLIST());
+    }
+    BENCHMARK(BM_ReferencedGeometryIds)->RangeMultiplier(8)->Range(128, 32768)->Complexity();
+
+    // CATV5PMIDenseIds::Find over IDs too sparse for its direct table
+    void BM_SparseDenseIdsFind(benchmark::State& state)
+    {
+        size_t nFaces = static_cast<size_t>(state.range(0));
+        vector<int> faceIds(nFaces);
+        for (size_t i = 0; i < nFaces; i++)
+            faceIds[i] = static_cast<int>(i * 1000);
+        CATV5PMIDenseIds denseIds;
+        denseIds.Assign(faceIds);
+        vector<int> probes = Probes(faceIds, 4096);
+
+        size_t iProbe = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(denseIds.Find(probes[iProbe++ & 4095]));
+        state.SetItemsProcessed(state.iterations());
+        state.SetComplexityN(state.range(0));
+    }
+    BENCHMARK(BM_SparseDenseIdsFind)->RangeMultiplier(10)->Range(100, 1000000)->Complexity();
+
+    // Persistent-ID group search of one final face, by group size
+    void BM_PersistentIDFindGroup(benchmark::State& state)
+    {
+        uint32_t groupSize = static_cast<uint32_t>(state.range(0));
+        const uint32_t nGroups = 8;
+        vector<int> ids;
+        vector<uint32_t> groupOffsets(1, 0);
+        for (uint32_t g = 0; g < nGroups; g++)
+        {
+            for (uint32_t i = 0; i < groupSize; i++)
+                ids.push_back(static_cast<int>(g * 7 + i));
+            groupOffsets.push_back(static_cast<uint32_t>(ids.size()));
+        }
+        // Matches the last group only, after comparing every other one in full
+        vector<int> group(ids.end() - groupSize, ids.end());
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(CATV5PMIPersistentIDKernel::FindGroup(group.data(), groupSize, ids.data(), groupOffsets.data(), nGroups));
+        state.SetBytesProcessed(state.iterations() * ids.size() * sizeof(int));
+        state.SetLabel(CATV5PMIPersistentIDKernel::ActiveLevel() == CATV5PMIPersistentIDKernel::kAVX2 ? "avx2"
+            : CATV5PMIPersistentIDKernel::ActiveLevel() == CATV5PMIPersistentIDKernel::kSSE2 ? "sse2" : "scalar");
+    }
+    BENCHMARK(BM_PersistentIDFindGroup)->RangeMultiplier(2)->Range(2, 64);
+
+    // GeometryReferenceBatch on the pool, from 1 to 10^4 annotations of a part of 8192 faces, in a translation
+    // whose part context is already built
+    void BM_BatchReferencedGeometryIds(benchmark::State& state)
+    {
+        static CATV5PMIWorkStealingPool s_pool;
+        StripFixture& fixture = Fixture(8192);
+        vector<CC5Entity*> references = References(fixture.strip);
+        size_t nAnnotations = static_cast<size_t>(state.range(0));
+        vector<GeometryAssociation> associations(nAnnotations);
+        for (size_t i = 0; i < nAnnotations; i++)
+            associations[i] = { references[i % references.size()], fixture.model.Part(), string(), 0 };
+
+        CATV5PMITranslation translation(fixture.model.TranslatableGroups(), nullptr);
+        vector<vector<int>> ids;
+        GeometryReferenceBatch::ReferencedGeometryIds(associations, ids, &s_pool);
+
+        for (auto _ : state)
+        {
+            GeometryReferenceBatch::ReferencedGeometryIds(associations, ids, &s_pool);
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * nAnnotations);
+        state.SetComplexityN(state.range(0));
+    }
+    BENCHMARK(BM_BatchReferencedGeometryIds)->RangeMultiplier(10)->Range(1, 10000)->Complexity()->UseRealTime();
+
+    // Exact hits of the geometry cache, by number of records
+    void BM_GeometryCacheLookup(benchmark::State& state)
+    {
+        string filePath = "atf_catv5_pmi_benchmark_cache.bin";
+        remove(filePath.c_str());
+        CATV5PMIGeometryCache::Open(filePath);
+
+        int nRecords = static_cast<int>(state.range(0));
+        CATV5PMIGeometryCacheKey key = { 1, 2, string(), 0, 3 };
+        for (int i = 0; i < nRecords; i++)
+        {
+            key.annotationId = "annotation_" + to_string(i);
+            key.entityId = i;
+            CATV5PMIGeometryCache::Store(key, { i, i + 1 }, { 1, 2 });
+        }
+
+        vector<int> ids;
+        int i = 0;
+        for (auto _ : state)
+        {
+            key.entityId = i % nRecords;
+            key.annotationId = "annotation_" + to_string(key.entityId);
+            benchmark::DoNotOptimize(CATV5PMIGeometryCache::Lookup(key, ids));
+            i++;
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetComplexityN(state.range(0));
+
+        CATV5PMIGeometryCache::Close();
+        remove(filePath.c_str());
+    }
+    BENCHMARK(BM_GeometryCacheLookup)->RangeMultiplier(10)->Range(100, 100000)->Complexity();
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,100 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace ATF
+{
+    // Maps the sparse entity IDs given by GetID() of a part to dense indices [0, Size()), so that
+    // per-entity data can be kept in flat arrays and bitsets.
+    // When the IDs span a range not much larger than their count, the index is read from a direct table;
+    // otherwise it is found by binary search in the sorted IDs.
+    class CATV5PMIDenseIds
+    {
+    public:
+        enum : uint32_t { kNotFound = 0xFFFFFFFFu };
+
+        CATV5PMIDenseIds()
+            : m_minId(0)
+        {}
+
+        // sortedIds must be sorted and without duplicates; index i is given to sortedIds[i]
+        void Assign(std::vector<int> sortedIds)
+        {
+            m_ids.swap(sortedIds);
+            m_table.clear();
+            if (m_ids.empty())
+                return;
+
+            m_minId = m_ids.front();
+            int64_t range = static_cast<int64_t>(m_ids.back()) - m_minId + 1;
+            if (range > static_cast<int64_t>(m_ids.size()) * 4 + 64)
+                return;
+
+            m_table.assign(static_cast<size_t>(range), kNotFound);
+            for (uint32_t i = 0; i < m_ids.size(); i++)
+                m_table[static_cast<size_t>(static_cast<int64_t>(m_ids[i]) - m_minId)] = i;
+        }
+
+        uint32_t Size() const { return static_cast<uint32_t>(m_ids.size()); }
+        int IdAt(uint32_t index) const { return m_ids[index]; }
+
+        uint32_t Find(int id) const
+        {
+            if (!m_table.empty())
+            {
+                int64_t offset = static_cast<int64_t>(id) - m_minId;
+                return offset >= 0 && offset < static_cast<int64_t>(m_table.size()) ? m_table[static_cast<size_t>(offset)] : kNotFound;
+            }
+
+            auto itr = std::lower_bound(m_ids.begin(), m_ids.end(), id);
+            return itr != m_ids.end() && *itr == id ? static_cast<uint32_t>(itr - m_ids.begin()) : kNotFound;
+        }
+
+    private:
+        std::vector<int> m_ids;
+        int m_minId;
+        std::vector<uint32_t> m_table;
+    };
+
+    // Bitset over dense indices. Only grows, so that a per-thread instance reused from query to query
+    // does not allocate once large enough; the caller resets the bits it set.
+    class CATV5PMIDenseBitset
+    {
+    public:
+        void Reserve(uint32_t nBits)
+        {
+            size_t nWords = (static_cast<size_t>(nBits) + 63) / 64;
+            if (m_words.size() < nWords)
+                m_words.resize(nWords, 0);
+        }
+
+        // Sets the bit and returns whether it was already set
+        bool TestAndSet(uint32_t index)
+        {
+            uint64_t& word = m_words[index >> 6];
+            uint64_t bit = 1ULL << (index & 63);
+            bool bWasSet = (word & bit) != 0;
+            word |= bit;
+            return bWasSet;
+        }
+
+        void Reset(uint32_t index)
+        {
+            m_words[index >> 6] &= ~(1ULL << (index & 63));
+        }
+
+    private:
+        std::vector<uint64_t> m_words;
+    };
+}
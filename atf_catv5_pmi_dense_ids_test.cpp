@@ -0,0 +1,103 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_dense_ids.h"
+
+#include <gtest/gtest.h>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    void ExpectDense(const vector<int>& sortedIds)
+    {
+        CATV5PMIDenseIds ids;
+        ids.Assign(sortedIds);
+        ASSERT_EQ(sortedIds.size(), ids.Size());
+        for (uint32_t i = 0; i < sortedIds.size(); i++)
+        {
+            EXPECT_EQ(sortedIds[i], ids.IdAt(i));
+            EXPECT_EQ(i, ids.Find(sortedIds[i]));
+        }
+    }
+}
+
+TEST(CATV5PMIDenseIds, Empty)
+{
+    CATV5PMIDenseIds ids;
+    EXPECT_EQ(0u, ids.Size());
+    EXPECT_EQ(CATV5PMIDenseIds::kNotFound, ids.Find(0));
+
+    ids.Assign(vector<int>());
+    EXPECT_EQ(CATV5PMIDenseIds::kNotFound, ids.Find(1));
+}
+
+TEST(CATV5PMIDenseIds, CompactRangeUsesTheTable)
+{
+    vector<int> sortedIds;
+    for (int id = 100; id < 1100; id += 2)
+        sortedIds.push_back(id);
+    ExpectDense(sortedIds);
+
+    CATV5PMIDenseIds ids;
+    ids.Assign(sortedIds);
+    EXPECT_EQ(CATV5PMIDenseIds::kNotFound, ids.Find(99));
+    EXPECT_EQ(CATV5PMIDenseIds::kNotFound, ids.Find(101));
+    EXPECT_EQ(CATV5PMIDenseIds::kNotFound, ids.Find(1100));
+}
+
+TEST(CATV5PMIDenseIds, SparseRangeUsesTheSearch)
+{
+    vector<int> sortedIds = { -2000000000, -5, 0, 7, 1000000, 2000000000 };
+    ExpectDense(sortedIds);
+
+    CATV5PMIDenseIds ids;
+    ids.Assign(sortedIds);
+    EXPECT_EQ(CATV5PMIDenseIds::kNotFound, ids.Find(-4));
+    EXPECT_EQ(CATV5PMIDenseIds::kNotFound, ids.Find(8));
+    EXPECT_EQ(CATV5PMIDenseIds::kNotFound, ids.Find(2147483647));
+}
+
+TEST(CATV5PMIDenseIds, AssignReplacesTheIds)
+{
+    CATV5PMIDenseIds ids;
+    ids.Assign({ 1, 2, 3 });
+    ids.Assign({ 10, 1000000 });
+    EXPECT_EQ(2u, ids.Size());
+    EXPECT_EQ(CATV5PMIDenseIds::kNotFound, ids.Find(2));
+    EXPECT_EQ(1u, ids.Find(1000000));
+}
+
+TEST(CATV5PMIDenseBitset, TestAndSetThenReset)
+{
+    CATV5PMIDenseBitset bits;
+    bits.Reserve(130);
+    EXPECT_FALSE(bits.TestAndSet(0));
+    EXPECT_FALSE(bits.TestAndSet(64));
+    EXPECT_FALSE(bits.TestAndSet(129));
+    EXPECT_TRUE(bits.TestAndSet(64));
+    EXPECT_FALSE(bits.TestAndSet(63));
+
+    bits.Reset(64);
+    EXPECT_FALSE(bits.TestAndSet(64));
+}
+
+TEST(CATV5PMIDenseBitset, ReserveKeepsTheBits)
+{
+    CATV5PMIDenseBitset bits;
+    bits.Reserve(10);
+    bits.TestAndSet(5);
+    bits.Reserve(1000);
+    bits.Reserve(1);
+    EXPECT_TRUE(bits.TestAndSet(5));
+    EXPECT_FALSE(bits.TestAndSet(999));
+}
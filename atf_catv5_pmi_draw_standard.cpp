@@ -0,0 +1,188 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_draw_standard.h"
+#include "atf_catv5_pmi_session.h"
+#include "atf_catv5_pmi_stats.h"
+#include "atf_catv5_pmi_translation.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    typedef unordered_map<CC5TPSSet*, PMIStandardTypeEnum> STANDARDMAP;
+
+    // Standards of the TPS sets of one session
+    struct StandardRegistry
+    {
+        StandardRegistry() : generation(1) {}
+
+        mutex standardMutex;
+        STANDARDMAP standards;
+        // Changed by Clear, to invalidate the per-thread entries
+        atomic<size_t> generation;
+    };
+
+    StandardRegistry& Registry(CATV5PMISession& session)
+    {
+        return session.State<StandardRegistry>(CATV5PMISession::kSlot_DrawStandards);
+    }
+
+    // The annotations of a set are translated together, so the last set is usually asked again
+    thread_local uint64_t t_lastSessionId = 0;
+    thread_local CC5TPSSet* t_pLastTPS = nullptr;
+    thread_local PMIStandardTypeEnum t_lastStandardType = kPMIStandardTypeEnum_Unknown;
+    thread_local size_t t_lastGeneration = 0;
+
+    bool StartsWith(const char* text, const char* pattern)
+    {
+        return strncmp(text, pattern, strlen(pattern)) == 0;
+    }
+
+    enum StandardPattern
+    {
+        kPattern_ISO = 0x1,
+        kPattern_ANSI = 0x2,
+        kPattern_ASME = 0x4,
+        kPattern_JIS = 0x8
+    };
+}
+
+PMIStandardTypeEnum CATV5PMIDrawStandard::StandardType(CC5TPSSet* pTPS)
+{
+    if (!pTPS)
+        return kPMIStandardTypeEnum_Unknown;
+
+    // GetPMIStandardType is called per roughness or leader, outside of the producer's session
+    CATV5PMIPartSessionScope partSessionScope;
+    CATV5PMISession& session = *CATV5PMISession::Current();
+    StandardRegistry& registry = Registry(session);
+    size_t generation = registry.generation.load();
+    if (t_pLastTPS == pTPS && t_lastGeneration == generation && t_lastSessionId == session.GetId())
+    {
+        ATF_PMI_COUNT(kCounter_DrawStandardCacheHits, 1);
+        return t_lastStandardType;
+    }
+
+    PMIStandardTypeEnum standardType = kPMIStandardTypeEnum_Unknown;
+    bool bFound = false;
+    {
+        lock_guard<mutex> lock(registry.standardMutex);
+        auto itr = registry.standards.find(pTPS);
+        if (itr != registry.standards.end())
+        {
+            standardType = itr->second;
+            bFound = true;
+        }
+    }
+
+    if (bFound)
+        ATF_PMI_COUNT(kCounter_DrawStandardCacheHits, 1);
+    else
+    {
+        ATF_PMI_COUNT(kCounter_DrawStandardCacheMisses, 1);
+        standardType = ReadStandardType(pTPS);
+        lock_guard<mutex> lock(registry.standardMutex);
+        if (registry.generation == generation)
+            registry.standards.emplace(pTPS, standardType);
+    }
+
+    t_lastSessionId = session.GetId();
+    t_pLastTPS = pTPS;
+    t_lastStandardType = standardType;
+    t_lastGeneration = generation;
+    return standardType;
+}
+
+bool CATV5PMIDrawStandard::IsSameAsISORepresentation(CC5TPSSet* pTPS)
+{
+    return CATV5PMIUtil::IsSameAsISORepresentation(StandardType(pTPS));
+}
+
+PMIStandardTypeEnum CATV5PMIDrawStandard::Classify(const char* standardName)
+{
+    if (!standardName)
+        return kPMIStandardTypeEnum_Unknown;
+
+    // One pass over the name, only trying the patterns starting with the current character
+    unsigned found = 0;
+    for (const char* pChar = standardName; *pChar && !(found & kPattern_ISO); pChar++)
+    {
+        switch (*pChar)
+        {
+        case 'I':
+            if (StartsWith(pChar, "ISO"))
+                found |= kPattern_ISO;
+            break;
+        case 'C':
+            // According to CCE, "CER" and "CEG1" are custom standards
+            // which are created from ISO (parent standard)
+            if (StartsWith(pChar, "CER") || StartsWith(pChar, "CEG1"))
+                found |= kPattern_ISO;
+            break;
+        case 'A':
+            if (StartsWith(pChar, "ANSI"))
+                found |= kPattern_ANSI;
+            else if (StartsWith(pChar, "ASME"))
+                found |= kPattern_ASME;
+            break;
+        case 'J':
+            if (StartsWith(pChar, "JIS"))
+                found |= kPattern_JIS;
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Same precedence as the former chain of searches, whatever the position of the patterns
+    if (found & kPattern_ISO)
+        return kPMIStandardTypeEnum_ISO;
+    if (found & kPattern_ANSI)
+        return kPMIStandardTypeEnum_ANSI;
+    if (found & kPattern_ASME)
+        return kPMIStandardTypeEnum_ASME;
+    if (found & kPattern_JIS)
+        return kPMIStandardTypeEnum_JIS;
+
+    ATF_WARNING_ASSERT(0 && "Unknown standard type is found!");
+    return kPMIStandardTypeEnum_Unknown;
+}
+
+void CATV5PMIDrawStandard::Clear()
+{
+    CATV5PMISession* pSession = CATV5PMISession::Current();
+    if (!pSession)
+        return;
+
+    StandardRegistry& registry = Registry(*pSession);
+    lock_guard<mutex> lock(registry.standardMutex);
+    registry.standards.clear();
+    registry.generation++;
+}
+
+PMIStandardTypeEnum CATV5PMIDrawStandard::ReadStandardType(CC5TPSSet* pTPS)
+{
+    char* standardName = nullptr;
+    pTPS->GetTPSDrawStandard(standardName);
+    if (standardName == nullptr)
+        return kPMIStandardTypeEnum_Unknown;
+
+    PMIStandardTypeEnum standardType = Classify(standardName);
+    CC5MemoryDelete_ThreadSafe((void**)&standardName);
+    return standardType;
+}
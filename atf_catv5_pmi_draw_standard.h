@@ -0,0 +1,39 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include "atf_catv5_pmi_util.h"
+
+namespace ATF
+{
+    // Drafting standard of the TPS sets, read once per set.
+    // CATV5PMIUtil::GetPMIStandardType goes through this cache, so querying it per roughness or leader is cheap.
+    // The standards are kept per CATV5PMISession, the functions working on the thread's current session,
+    // or outside of any session on the session kept for the producer's part (see CATV5PMIPartSessionScope).
+    class CATV5PMIDrawStandard
+    {
+    public:
+        static PMIStandardTypeEnum StandardType(CC5TPSSet* pTPS);
+
+        // CATV5PMIUtil::IsSameAsISORepresentation of the standard of the set
+        static bool IsSameAsISORepresentation(CC5TPSSet* pTPS);
+
+        // Classifies a standard name: "ISO" and its custom derivatives "CER" and "CEG1" first, then "ANSI", "ASME" and "JIS".
+        // The name is scanned once for all of them.
+        static PMIStandardTypeEnum Classify(const char* standardName);
+
+        // Drops the cached standards, at the end of the translation (see CATV5PMITranslation).
+        // The sets are keyed by address, which the reader may reuse once a set is deleted.
+        static void Clear();
+
+    private:
+        static PMIStandardTypeEnum ReadStandardType(CC5TPSSet* pTPS);
+    };
+}
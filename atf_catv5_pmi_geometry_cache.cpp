@@ -0,0 +1,857 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_geometry_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace ATF;
+using namespace std;
+
+// File layout, in the byte order of the machine writing it:
+//
+//   header   char magic[8] "ATFPMIGC", uint32 version, uint32 byte order mark 0x01020304
+//   record   uint32 recordSize, uint32 checksum of the bytes after it,
+//            uint64 partHash, uint64 sourceHash, int32 entityId, int32 entityType, uint32 keyLength, uint32 idCount,
+//            int32 ids[idCount], uint64 fingerprints[idCount], key bytes padded with zeros to a multiple of 4
+//
+// Several processes can share the file: records are appended under an exclusive file lock, and the
+// records appended by the other processes are read from the end of the file on the next lookup.
+namespace
+{
+    const char kMagic[8] = { 'A', 'T', 'F', 'P', 'M', 'I', 'G', 'C' };
+    const uint32_t kVersion = 3;
+    const uint32_t kByteOrderMark = 0x01020304;
+    const size_t kHeaderSize = 16;
+    const size_t kRecordHeaderSize = 40;
+    // Below this size the superseded records are left in the file
+    const uint64_t kMinCompactSize = 1 << 20;
+
+    uint32_t Checksum(const char* pData, size_t size)
+    {
+        uint32_t hash = 2166136261U;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= static_cast<unsigned char>(pData[i]);
+            hash *= 16777619U;
+        }
+        return hash;
+    }
+
+    uint64_t StringHash(const string& value)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (char c : value)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    template <class T>
+    T ReadAt(const char* pData, size_t offset)
+    {
+        T value;
+        memcpy(&value, pData + offset, sizeof(T));
+        return value;
+    }
+
+    template <class T>
+    void WriteAt(vector<char>& buffer, size_t offset, T value)
+    {
+        memcpy(buffer.data() + offset, &value, sizeof(T));
+    }
+
+    size_t RecordSize(uint32_t keyLength, uint32_t idCount)
+    {
+        return kRecordHeaderSize + size_t(idCount) * (sizeof(int32_t) + sizeof(uint64_t)) + ((size_t(keyLength) + 3) & ~size_t(3));
+    }
+
+    size_t FingerprintsOffset(uint32_t idCount)
+    {
+        return kRecordHeaderSize + size_t(idCount) * sizeof(int32_t);
+    }
+
+    size_t KeyOffset(uint32_t idCount)
+    {
+        return kRecordHeaderSize + size_t(idCount) * (sizeof(int32_t) + sizeof(uint64_t));
+    }
+
+    // The cache file, mapped read-only for the records present on open and appended to with plain writes
+    class CacheFile
+    {
+    public:
+        CacheFile()
+#ifdef _WIN32
+            : m_hFile(INVALID_HANDLE_VALUE)
+            , m_hMapping(nullptr)
+#else
+            : m_fd(-1)
+#endif
+            , m_pData(nullptr)
+            , m_mappedSize(0)
+        {}
+
+        ~CacheFile() { Close(); }
+
+        bool Open(const string& filePath)
+        {
+#ifdef _WIN32
+            m_hFile = CreateFileA(filePath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            return m_hFile != INVALID_HANDLE_VALUE;
+#else
+            // O_APPEND: a write always lands at the end of the file, whatever the other processes wrote
+            m_fd = open(filePath.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+            return m_fd >= 0;
+#endif
+        }
+
+        void Close()
+        {
+            Unmap();
+#ifdef _WIN32
+            if (m_hFile != INVALID_HANDLE_VALUE)
+                CloseHandle(m_hFile);
+            m_hFile = INVALID_HANDLE_VALUE;
+#else
+            if (m_fd >= 0)
+                close(m_fd);
+            m_fd = -1;
+#endif
+        }
+
+        // Exclusive lock of the whole file between processes; released on Unlock or Close
+        bool Lock()
+        {
+#ifdef _WIN32
+            OVERLAPPED overlapped = {};
+            return LockFileEx(m_hFile, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped) != FALSE;
+#else
+            int result;
+            do
+            {
+                result = flock(m_fd, LOCK_EX);
+            } while (result != 0 && errno == EINTR);
+            return result == 0;
+#endif
+        }
+
+        void Unlock()
+        {
+#ifdef _WIN32
+            OVERLAPPED overlapped = {};
+            UnlockFileEx(m_hFile, 0, MAXDWORD, MAXDWORD, &overlapped);
+#else
+            flock(m_fd, LOCK_UN);
+#endif
+        }
+
+        // Whether the path still names this file, and not one renamed over it by the compaction of another process
+        bool IsAt(const string& filePath) const
+        {
+#ifdef _WIN32
+            // Replacing an open cache file fails on Windows, see Compact
+            (void)filePath;
+            return true;
+#else
+            struct stat fileStat, pathStat;
+            return fstat(m_fd, &fileStat) == 0 && stat(filePath.c_str(), &pathStat) == 0
+                && fileStat.st_dev == pathStat.st_dev && fileStat.st_ino == pathStat.st_ino;
+#endif
+        }
+
+        // The size of the file now, with the records appended by the other processes
+        bool Size(uint64_t& size) const
+        {
+#ifdef _WIN32
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(m_hFile, &fileSize))
+                return false;
+            size = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+            struct stat fileStat;
+            if (fstat(m_fd, &fileStat) != 0)
+                return false;
+            size = static_cast<uint64_t>(fileStat.st_size);
+#endif
+            return true;
+        }
+
+        const char* Data() const { return m_pData; }
+        size_t MappedSize() const { return m_mappedSize; }
+
+        // Maps the start of the file; the records after it are read with Read
+        bool Map(uint64_t size)
+        {
+            Unmap();
+            if (size == 0)
+                return true;
+#ifdef _WIN32
+            m_hMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!m_hMapping)
+                return false;
+            m_pData = static_cast<const char*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, static_cast<SIZE_T>(size)));
+#else
+            void* pData = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_SHARED, m_fd, 0);
+            m_pData = pData != MAP_FAILED ? static_cast<const char*>(pData) : nullptr;
+#endif
+            if (!m_pData)
+                return false;
+            m_mappedSize = static_cast<size_t>(size);
+            return true;
+        }
+
+        void Unmap()
+        {
+#ifdef _WIN32
+            if (m_pData)
+                UnmapViewOfFile(m_pData);
+            if (m_hMapping)
+                CloseHandle(m_hMapping);
+            m_hMapping = nullptr;
+#else
+            if (m_pData)
+                munmap(const_cast<char*>(m_pData), m_mappedSize);
+#endif
+            m_pData = nullptr;
+            m_mappedSize = 0;
+        }
+
+        bool Read(uint64_t offset, size_t size, vector<char>& buffer) const
+        {
+            buffer.resize(size);
+            size_t nRead = 0;
+            while (nRead < size)
+            {
+#ifdef _WIN32
+                OVERLAPPED overlapped = {};
+                overlapped.Offset = static_cast<DWORD>(offset + nRead);
+                overlapped.OffsetHigh = static_cast<DWORD>((offset + nRead) >> 32);
+                DWORD n = 0;
+                if (!ReadFile(m_hFile, buffer.data() + nRead, static_cast<DWORD>(size - nRead), &n, &overlapped) || n == 0)
+                    return false;
+#else
+                ssize_t n = pread(m_fd, buffer.data() + nRead, size - nRead, static_cast<off_t>(offset + nRead));
+                if (n <= 0)
+                    return false;
+#endif
+                nRead += static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        // Must be called under Lock, and not below the mapped size
+        bool Truncate(uint64_t size)
+        {
+#ifdef _WIN32
+            LARGE_INTEGER position;
+            position.QuadPart = static_cast<LONGLONG>(size);
+            return SetFilePointerEx(m_hFile, position, nullptr, FILE_BEGIN) && SetEndOfFile(m_hFile);
+#else
+            return ftruncate(m_fd, static_cast<off_t>(size)) == 0;
+#endif
+        }
+
+        // Must be called under Lock, so that the data is not interleaved with the writes of another process
+        bool Append(const char* pData, size_t size)
+        {
+#ifdef _WIN32
+            LARGE_INTEGER position = {};
+            if (!SetFilePointerEx(m_hFile, position, nullptr, FILE_END))
+                return false;
+            DWORD nWritten = 0;
+            if (!WriteFile(m_hFile, pData, static_cast<DWORD>(size), &nWritten, nullptr) || nWritten != size)
+                return false;
+#else
+            size_t nWritten = 0;
+            while (nWritten < size)
+            {
+                ssize_t n = write(m_fd, pData + nWritten, size - nWritten);
+                if (n <= 0)
+                    return false;
+                nWritten += static_cast<size_t>(n);
+            }
+#endif
+            return true;
+        }
+
+    private:
+        CacheFile(const CacheFile&) = delete;
+        CacheFile& operator=(const CacheFile&) = delete;
+
+#ifdef _WIN32
+        HANDLE m_hFile;
+        HANDLE m_hMapping;
+#else
+        int m_fd;
+#endif
+        const char* m_pData;
+        size_t m_mappedSize;
+    };
+
+    class CacheFileLock
+    {
+    public:
+        explicit CacheFileLock(CacheFile& file) : m_file(file), m_bLocked(file.Lock()) {}
+        ~CacheFileLock()
+        {
+            if (m_bLocked)
+                m_file.Unlock();
+        }
+
+        bool IsLocked() const { return m_bLocked; }
+
+    private:
+        CacheFile& m_file;
+        bool m_bLocked;
+    };
+
+    struct IndexKey
+    {
+        uint64_t partHash;
+        uint64_t sourceHash;
+        uint64_t annotationHash;
+        int entityId;
+        int entityType;
+
+        bool operator==(const IndexKey& other) const
+        {
+            return partHash == other.partHash && sourceHash == other.sourceHash && annotationHash == other.annotationHash
+                && entityId == other.entityId && entityType == other.entityType;
+        }
+    };
+
+    struct IndexKeyHash
+    {
+        size_t operator()(const IndexKey& key) const
+        {
+            uint64_t hash = key.partHash ^ (key.sourceHash * 1099511628211ULL) ^ (key.annotationHash * 14029467366897019727ULL);
+            hash ^= (static_cast<uint64_t>(static_cast<uint32_t>(key.entityId)) << 32) | static_cast<uint32_t>(key.entityType);
+            return static_cast<size_t>(hash ^ (hash >> 29));
+        }
+    };
+
+    // A record in the mapping, or one read or stored after it
+    struct IndexEntry
+    {
+        bool bMapped;
+        size_t offset;
+        size_t size;
+        string annotationId;
+        vector<int> ids;
+        vector<uint64_t> fingerprints;
+    };
+
+    typedef unordered_map<IndexKey, IndexEntry, IndexKeyHash> INDEX;
+    // Last key written for an annotation and entity, whatever the part and source hashes (kept as 0 in the key),
+    // or whatever the source hash only
+    typedef unordered_map<IndexKey, IndexKey, IndexKeyHash> LATESTINDEX;
+
+    struct CacheState
+    {
+        CacheState() : bOpen(false), scannedSize(0), maxSize(0) {}
+
+        void Reset()
+        {
+            index.clear();
+            latest.clear();
+            revisions.clear();
+            file.Close();
+            bOpen = false;
+            scannedSize = 0;
+        }
+
+        bool bOpen;
+        string filePath;
+        CacheFile file;
+        INDEX index;
+        LATESTINDEX latest;
+        LATESTINDEX revisions;
+        // End of the last valid record read from the file
+        uint64_t scannedSize;
+        uint64_t maxSize;
+    };
+
+    mutex& CacheMutex()
+    {
+        static mutex s_mutex;
+        return s_mutex;
+    }
+
+    CacheState& State()
+    {
+        static CacheState s_state;
+        return s_state;
+    }
+
+    IndexKey MakeIndexKey(const CATV5PMIGeometryCacheKey& key)
+    {
+        IndexKey indexKey = { key.partHash, key.sourceHash, StringHash(key.annotationId), key.entityId, key.entityType };
+        return indexKey;
+    }
+
+    IndexKey AnyRevision(IndexKey key)
+    {
+        key.partHash = 0;
+        key.sourceHash = 0;
+        return key;
+    }
+
+    IndexKey SameRevision(IndexKey key)
+    {
+        key.sourceHash = 0;
+        return key;
+    }
+
+    void AddLatest(const IndexKey& indexKey, LATESTINDEX& latest, LATESTINDEX& revisions)
+    {
+        latest[AnyRevision(indexKey)] = indexKey;
+        revisions[SameRevision(indexKey)] = indexKey;
+    }
+
+    // Checks the record at the offset of the buffer and gives its size and key, or returns 0
+    size_t ReadRecord(const char* pData, size_t size, size_t offset, IndexKey& indexKey)
+    {
+        if (offset + kRecordHeaderSize > size)
+            return 0;
+        uint32_t recordSize = ReadAt<uint32_t>(pData, offset);
+        uint32_t keyLength = ReadAt<uint32_t>(pData, offset + 32);
+        uint32_t idCount = ReadAt<uint32_t>(pData, offset + 36);
+        if (recordSize != RecordSize(keyLength, idCount) || recordSize > size - offset)
+            return 0;
+        if (ReadAt<uint32_t>(pData, offset + 4) != Checksum(pData + offset + 8, recordSize - 8))
+            return 0;
+
+        indexKey.partHash = ReadAt<uint64_t>(pData, offset + 8);
+        indexKey.sourceHash = ReadAt<uint64_t>(pData, offset + 16);
+        indexKey.annotationHash = StringHash(string(pData + offset + KeyOffset(idCount), keyLength));
+        indexKey.entityId = ReadAt<int32_t>(pData, offset + 24);
+        indexKey.entityType = ReadAt<int32_t>(pData, offset + 28);
+        return recordSize;
+    }
+
+    // Copies the record out, for a record that is not in the mapping
+    void ReadOwnedEntry(const char* pRecord, IndexEntry& entry)
+    {
+        uint32_t keyLength = ReadAt<uint32_t>(pRecord, 32);
+        uint32_t idCount = ReadAt<uint32_t>(pRecord, 36);
+        entry.bMapped = false;
+        entry.annotationId.assign(pRecord + KeyOffset(idCount), keyLength);
+        entry.ids.resize(idCount);
+        entry.fingerprints.resize(idCount);
+        if (idCount)
+        {
+            memcpy(entry.ids.data(), pRecord + kRecordHeaderSize, size_t(idCount) * sizeof(int32_t));
+            memcpy(entry.fingerprints.data(), pRecord + FingerprintsOffset(idCount), size_t(idCount) * sizeof(uint64_t));
+        }
+    }
+
+    // Indexes the valid records of the mapping and returns the end of the last one
+    size_t IndexRecords(const char* pData, size_t size, INDEX& index, LATESTINDEX& latest, LATESTINDEX& revisions)
+    {
+        size_t offset = kHeaderSize;
+        IndexKey indexKey;
+        while (size_t recordSize = ReadRecord(pData, size, offset, indexKey))
+        {
+            IndexEntry& entry = index[indexKey];
+            entry.bMapped = true;
+            entry.offset = offset;
+            entry.size = recordSize;
+            AddLatest(indexKey, latest, revisions);
+            offset += recordSize;
+        }
+        return offset;
+    }
+
+    enum ScanResult
+    {
+        kScan_Complete,
+        // The file ends with a record that is not complete: being written by another process, or torn by a crash if the file is locked
+        kScan_Incomplete,
+        kScan_Failed
+    };
+
+    // Indexes the records appended since the last scan, by this process or another one
+    ScanResult ScanTail(CacheState& state)
+    {
+        uint64_t size = 0;
+        if (!state.file.Size(size))
+            return kScan_Failed;
+        if (size <= state.scannedSize)
+            return kScan_Complete;
+
+        vector<char> tail;
+        if (!state.file.Read(state.scannedSize, static_cast<size_t>(size - state.scannedSize), tail))
+            return kScan_Failed;
+
+        size_t offset = 0;
+        IndexKey indexKey;
+        while (size_t recordSize = ReadRecord(tail.data(), tail.size(), offset, indexKey))
+        {
+            IndexEntry& entry = state.index[indexKey];
+            ReadOwnedEntry(tail.data() + offset, entry);
+            entry.offset = static_cast<size_t>(state.scannedSize + offset);
+            entry.size = recordSize;
+            AddLatest(indexKey, state.latest, state.revisions);
+            offset += recordSize;
+        }
+        state.scannedSize += offset;
+        return offset == tail.size() ? kScan_Complete : kScan_Incomplete;
+    }
+
+    vector<char> Header()
+    {
+        vector<char> header(kHeaderSize);
+        memcpy(header.data(), kMagic, sizeof(kMagic));
+        WriteAt(header, 8, kVersion);
+        WriteAt(header, 12, kByteOrderMark);
+        return header;
+    }
+
+    string TemporaryPath(const string& filePath)
+    {
+#ifdef _WIN32
+        unsigned long processId = GetCurrentProcessId();
+#else
+        unsigned long processId = static_cast<unsigned long>(getpid());
+#endif
+        return filePath + "." + to_string(processId) + ".tmp";
+    }
+
+    // Replaces the file by one with the content, through a rename so that the processes still reading
+    // the old file are not disturbed. Returns false if the file cannot be replaced while open (Windows).
+    bool Replace(const string& filePath, const vector<char>& content)
+    {
+        string temporaryPath = TemporaryPath(filePath);
+        {
+            ofstream stream(temporaryPath, ios::binary | ios::trunc);
+            if (!stream.write(content.data(), static_cast<streamsize>(content.size())) || !stream.flush())
+            {
+                remove(temporaryPath.c_str());
+                return false;
+            }
+        }
+#ifdef _WIN32
+        bool bReplaced = MoveFileExA(temporaryPath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+#else
+        bool bReplaced = rename(temporaryPath.c_str(), filePath.c_str()) == 0;
+#endif
+        if (!bReplaced)
+            remove(temporaryPath.c_str());
+        return bReplaced;
+    }
+
+    // Keeps the last record of each annotation and entity, and only the newest of them if they do not
+    // fit in half the size cap. Returns false if the file is left as it is.
+    bool Compact(const CacheState& state, const string& filePath)
+    {
+        vector<const IndexEntry*> records;
+        records.reserve(state.latest.size());
+        for (const auto& latest : state.latest)
+        {
+            auto itr = state.index.find(latest.second);
+            if (itr != state.index.end() && itr->second.bMapped)
+                records.push_back(&itr->second);
+        }
+        sort(records.begin(), records.end(), [](const IndexEntry* pLeft, const IndexEntry* pRight) { return pLeft->offset < pRight->offset; });
+
+        uint64_t liveSize = 0;
+        for (const IndexEntry* pRecord : records)
+            liveSize += pRecord->size;
+
+        uint64_t fileSize = state.file.MappedSize();
+        bool bOverCap = fileSize > state.maxSize;
+        if (!bOverCap && (fileSize < kMinCompactSize || liveSize * 2 > fileSize))
+            return false;
+
+        size_t first = 0;
+        if (bOverCap)
+        {
+            while (first < records.size() && liveSize > state.maxSize / 2)
+                liveSize -= records[first++]->size;
+        }
+
+        vector<char> content = Header();
+        content.reserve(static_cast<size_t>(kHeaderSize + liveSize));
+        for (size_t i = first; i < records.size(); i++)
+        {
+            const char* pRecord = state.file.Data() + records[i]->offset;
+            content.insert(content.end(), pRecord, pRecord + records[i]->size);
+        }
+        return Replace(filePath, content);
+    }
+
+    // Reads the entry, checking the annotation id in full since the index only holds its hash
+    bool ReadEntry(const CacheState& state, const IndexEntry& entry, const string& annotationId, vector<int>& ids, vector<uint64_t>* pFingerprints)
+    {
+        if (!entry.bMapped)
+        {
+            if (entry.annotationId != annotationId)
+                return false;
+            ids = entry.ids;
+            if (pFingerprints)
+                *pFingerprints = entry.fingerprints;
+            return true;
+        }
+
+        const char* pRecord = state.file.Data() + entry.offset;
+        uint32_t keyLength = ReadAt<uint32_t>(pRecord, 32);
+        uint32_t idCount = ReadAt<uint32_t>(pRecord, 36);
+        if (keyLength != annotationId.size() || memcmp(pRecord + KeyOffset(idCount), annotationId.data(), keyLength) != 0)
+            return false;
+
+        ids.resize(idCount);
+        if (idCount)
+            memcpy(ids.data(), pRecord + kRecordHeaderSize, size_t(idCount) * sizeof(int32_t));
+        if (pFingerprints)
+        {
+            pFingerprints->resize(idCount);
+            if (idCount)
+                memcpy(pFingerprints->data(), pRecord + FingerprintsOffset(idCount), size_t(idCount) * sizeof(uint64_t));
+        }
+        return true;
+    }
+
+    enum OpenResult
+    {
+        kOpen_Done,
+        kOpen_Failed,
+        // The file was replaced, by this process or another one, and is to be opened again
+        kOpen_Retry
+    };
+
+    OpenResult OpenLocked(CacheState& state, const string& filePath)
+    {
+        if (!state.file.IsAt(filePath))
+            return kOpen_Retry;
+
+        uint64_t size = 0;
+        if (!state.file.Size(size))
+            return kOpen_Failed;
+
+        // New file, or one cut before its header was complete
+        if (size < kHeaderSize)
+        {
+            vector<char> header = Header();
+            if (!state.file.Truncate(0) || !state.file.Append(header.data(), header.size()))
+                return kOpen_Failed;
+            size = kHeaderSize;
+        }
+
+        if (!state.file.Map(size) || memcmp(state.file.Data(), kMagic, sizeof(kMagic)) != 0)
+            return kOpen_Failed;
+
+        // A cache of another version or byte order is started again
+        if (ReadAt<uint32_t>(state.file.Data(), 8) != kVersion || ReadAt<uint32_t>(state.file.Data(), 12) != kByteOrderMark)
+        {
+            state.file.Unmap();
+            if (Replace(filePath, Header()))
+                return kOpen_Retry;
+            vector<char> header = Header();
+            if (!state.file.Truncate(0) || !state.file.Append(header.data(), header.size()) || !state.file.Map(kHeaderSize))
+                return kOpen_Failed;
+        }
+
+        size_t validSize = IndexRecords(state.file.Data(), state.file.MappedSize(), state.index, state.latest, state.revisions);
+        if (validSize < state.file.MappedSize())
+        {
+            // The records after a torn one are lost with it; new records are written in its place
+            state.file.Unmap();
+            if (!state.file.Truncate(validSize) || !state.file.Map(validSize))
+                return kOpen_Failed;
+        }
+        state.scannedSize = validSize;
+
+        return Compact(state, filePath) ? kOpen_Retry : kOpen_Done;
+    }
+}
+
+bool CATV5PMIGeometryCache::Open(const string& filePath, uint64_t maxSize)
+{
+    lock_guard<mutex> lock(CacheMutex());
+    CacheState& state = State();
+    state.filePath = filePath;
+    state.maxSize = maxSize;
+
+    // A few attempts, for the file replaced by compactions while waiting for the lock
+    for (int attempt = 0; attempt < 4; attempt++)
+    {
+        state.Reset();
+        if (!state.file.Open(filePath))
+            break;
+
+        OpenResult result = kOpen_Failed;
+        {
+            CacheFileLock fileLock(state.file);
+            if (fileLock.IsLocked())
+                result = OpenLocked(state, filePath);
+        }
+        if (result == kOpen_Done)
+        {
+            state.bOpen = true;
+            return true;
+        }
+        if (result == kOpen_Failed)
+            break;
+    }
+    state.Reset();
+    return false;
+}
+
+void CATV5PMIGeometryCache::Close()
+{
+    lock_guard<mutex> lock(CacheMutex());
+    State().Reset();
+}
+
+bool CATV5PMIGeometryCache::IsOpen()
+{
+    lock_guard<mutex> lock(CacheMutex());
+    return State().bOpen;
+}
+
+bool CATV5PMIGeometryCache::Lookup(const CATV5PMIGeometryCacheKey& key, vector<int>& ids)
+{
+    lock_guard<mutex> lock(CacheMutex());
+    CacheState& state = State();
+    if (!state.bOpen)
+        return false;
+    ScanTail(state);
+
+    auto revisionItr = state.revisions.find(SameRevision(MakeIndexKey(key)));
+    if (revisionItr == state.revisions.end())
+        return false;
+
+    auto itr = state.index.find(revisionItr->second);
+    return itr != state.index.end() && ReadEntry(state, itr->second, key.annotationId, ids, nullptr);
+}
+
+bool CATV5PMIGeometryCache::LookupPrevious(const CATV5PMIGeometryCacheKey& key, vector<int>& ids, vector<uint64_t>& fingerprints)
+{
+    lock_guard<mutex> lock(CacheMutex());
+    CacheState& state = State();
+    if (!state.bOpen)
+        return false;
+    ScanTail(state);
+
+    // The previous result only holds if the entity still resolves through the same intermediate geometry
+    auto latestItr = state.latest.find(AnyRevision(MakeIndexKey(key)));
+    if (latestItr == state.latest.end() || latestItr->second.sourceHash != key.sourceHash)
+        return false;
+
+    auto itr = state.index.find(latestItr->second);
+    return itr != state.index.end() && ReadEntry(state, itr->second, key.annotationId, ids, &fingerprints);
+}
+
+void CATV5PMIGeometryCache::Store(const CATV5PMIGeometryCacheKey& key, const vector<int>& ids, const vector<uint64_t>& fingerprints)
+{
+    uint32_t keyLength = static_cast<uint32_t>(key.annotationId.size());
+    uint32_t idCount = static_cast<uint32_t>(ids.size());
+    vector<char> record(RecordSize(keyLength, idCount), 0);
+    WriteAt(record, 0, static_cast<uint32_t>(record.size()));
+    WriteAt(record, 8, key.partHash);
+    WriteAt(record, 16, key.sourceHash);
+    WriteAt(record, 24, static_cast<int32_t>(key.entityId));
+    WriteAt(record, 28, static_cast<int32_t>(key.entityType));
+    WriteAt(record, 32, keyLength);
+    WriteAt(record, 36, idCount);
+    for (uint32_t i = 0; i < idCount; i++)
+    {
+        WriteAt(record, kRecordHeaderSize + i * sizeof(int32_t), static_cast<int32_t>(ids[i]));
+        WriteAt(record, FingerprintsOffset(idCount) + i * sizeof(uint64_t), i < fingerprints.size() ? fingerprints[i] : uint64_t(0));
+    }
+    if (keyLength)
+        memcpy(record.data() + KeyOffset(idCount), key.annotationId.data(), keyLength);
+    WriteAt(record, 4, Checksum(record.data() + 8, record.size() - 8));
+
+    lock_guard<mutex> lock(CacheMutex());
+    CacheState& state = State();
+    if (!state.bOpen)
+        return;
+
+    bool bWritten = false;
+    {
+        CacheFileLock fileLock(state.file);
+        if (!fileLock.IsLocked())
+            return;
+
+        // Replaced by the compaction of another process: what would be written is lost, the next open sees the new file
+        if (!state.file.IsAt(state.filePath))
+            return;
+        // Under the lock nobody else is writing: a record left incomplete is torn, and cut off before writing after it
+        ScanResult scan = ScanTail(state);
+        if (scan == kScan_Failed || (scan == kScan_Incomplete && !state.file.Truncate(state.scannedSize)))
+            return;
+        // The cap is enforced by the compaction on open; until then the file is full
+        if (state.scannedSize + record.size() > 2 * state.maxSize)
+            return;
+        bWritten = state.file.Append(record.data(), record.size());
+    }
+    if (!bWritten)
+    {
+        // Nothing more is written after a failed write, so that a torn record can only be the last one
+        state.Reset();
+        return;
+    }
+
+    IndexKey indexKey = MakeIndexKey(key);
+    IndexEntry& entry = state.index[indexKey];
+    entry.bMapped = false;
+    entry.offset = static_cast<size_t>(state.scannedSize);
+    entry.size = record.size();
+    entry.annotationId = key.annotationId;
+    entry.ids = ids;
+    entry.fingerprints.assign(idCount, 0);
+    for (uint32_t i = 0; i < idCount && i < fingerprints.size(); i++)
+        entry.fingerprints[i] = fingerprints[i];
+    AddLatest(indexKey, state.latest, state.revisions);
+    state.scannedSize += record.size();
+}
+
+uint64_t CATV5PMIGeometryCache::FileKey(const string& filePath)
+{
+#ifdef _WIN32
+    struct _stat64 fileStat;
+    if (_stat64(filePath.c_str(), &fileStat) != 0)
+        return 0;
+#else
+    struct stat fileStat;
+    if (stat(filePath.c_str(), &fileStat) != 0)
+        return 0;
+#endif
+
+    uint64_t key = StringHash(filePath);
+    key ^= static_cast<uint64_t>(fileStat.st_size);
+    key *= 1099511628211ULL;
+    key ^= static_cast<uint64_t>(fileStat.st_mtime);
+    key *= 1099511628211ULL;
+    return key != 0 ? key : 1;
+}
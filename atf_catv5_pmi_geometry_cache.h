@@ -0,0 +1,72 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ATF
+{
+    // Key of a resolved association in the cache
+    struct CATV5PMIGeometryCacheKey
+    {
+        // Revision of the part: FileKey of its source file, or CATV5PMIPartIndex::ContentHash of the part
+        uint64_t partHash;
+        // CATV5PMIPartIndex::AssociationFingerprint of the entity: the intermediate geometry it resolves through
+        uint64_t sourceHash;
+        // The annotation, as the string form of the id given by CATV5PMIUtil::AnnotationObjectId
+        std::string annotationId;
+        // The entity given by GetAssociatedGeoEntity, so that an annotation moved to other geometry is resolved again
+        int entityId;
+        int entityType;
+    };
+
+    // Optional on-disk cache of the ids given by GeometryReferenceBuilder::ReferencedGeometryIds, for
+    // the conversions of the same parts again and again. The file is append-only: each resolved
+    // association is written as one record, a later record of the same key replacing the earlier one.
+    // Each record also keeps a fingerprint of the geometry behind each id, so that the result of a previous
+    // revision of the part can be reused when that geometry did not change.
+    // The records found on open are read through a read-only mapping of the file; a torn record at the
+    // end of the file (crash while writing) is cut off.
+    // The file can be shared by several processes: records are appended under an exclusive file lock,
+    // and each lookup first reads the records the other processes appended since.
+    // On open, the records replaced by later ones are dropped when they make up most of the file, and
+    // the oldest records too when the file is over its size cap; the file grows to at most twice the cap
+    // until the next open. The compacted file replaces the old one through a rename; a process still on the
+    // old file stops writing to it until it opens the cache again.
+    //
+    // Not opened, the cache misses every lookup and drops every store.
+    class CATV5PMIGeometryCache
+    {
+    public:
+        // Opens or creates the cache file; a cache file of another version is emptied.
+        // Returns false if it cannot be opened or is not a cache file, the cache then staying closed.
+        static bool Open(const std::string& filePath, uint64_t maxSize = uint64_t(256) << 20);
+        static void Close();
+        static bool IsOpen();
+
+        // Gives the ids stored for the annotation and entity in the same revision of the part, whatever
+        // the source hash: an unchanged part resolves the same way, so the source hash need not be computed.
+        static bool Lookup(const CATV5PMIGeometryCacheKey& key, std::vector<int>& ids);
+
+        // Gives the last record of the annotation and entity, whatever the part hash, if it was stored with the
+        // same source hash: the result of the previous conversion of the part, with the fingerprint of each id
+        // when it was stored (see CATV5PMIPartIndex::Fingerprint).
+        static bool LookupPrevious(const CATV5PMIGeometryCacheKey& key, std::vector<int>& ids, std::vector<uint64_t>& fingerprints);
+
+        // fingerprints[i] is the fingerprint of ids[i] in the part the ids were resolved in
+        static void Store(const CATV5PMIGeometryCacheKey& key, const std::vector<int>& ids, const std::vector<uint64_t>& fingerprints);
+
+        // Revision key of a part from its source file: the path, size and modification time, read without
+        // opening the file. 0 if the file cannot be found, the part then being keyed by its content.
+        static uint64_t FileKey(const std::string& filePath);
+    };
+}
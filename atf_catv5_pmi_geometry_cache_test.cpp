@@ -0,0 +1,232 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_geometry_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    CATV5PMIGeometryCacheKey Key(int entityId, uint64_t partHash = 1, uint64_t sourceHash = 2)
+    {
+        CATV5PMIGeometryCacheKey key;
+        key.partHash = partHash;
+        key.sourceHash = sourceHash;
+        key.annotationId = "annotation_" + to_string(entityId);
+        key.entityId = entityId;
+        key.entityType = 3;
+        return key;
+    }
+
+    uint64_t FileSize(const string& filePath)
+    {
+        ifstream stream(filePath, ios::binary | ios::ate);
+        return stream ? static_cast<uint64_t>(stream.tellg()) : 0;
+    }
+
+    class CATV5PMIGeometryCacheTest : public testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            m_filePath = testing::TempDir() + "atf_catv5_pmi_geometry_cache_test.bin";
+            remove(m_filePath.c_str());
+        }
+
+        void TearDown() override
+        {
+            CATV5PMIGeometryCache::Close();
+            remove(m_filePath.c_str());
+        }
+
+        string m_filePath;
+    };
+}
+
+TEST_F(CATV5PMIGeometryCacheTest, ClosedCacheMissesAndDrops)
+{
+    vector<int> ids;
+    CATV5PMIGeometryCache::Store(Key(1), { 10 }, { 100 });
+    EXPECT_FALSE(CATV5PMIGeometryCache::IsOpen());
+    EXPECT_FALSE(CATV5PMIGeometryCache::Lookup(Key(1), ids));
+}
+
+TEST_F(CATV5PMIGeometryCacheTest, StoreThenLookupAcrossOpens)
+{
+    ASSERT_TRUE(CATV5PMIGeometryCache::Open(m_filePath));
+    CATV5PMIGeometryCache::Store(Key(1), { 10, 11 }, { 100, 101 });
+    CATV5PMIGeometryCache::Store(Key(2), {}, {});
+
+    vector<int> ids;
+    ASSERT_TRUE(CATV5PMIGeometryCache::Lookup(Key(1), ids));
+    EXPECT_EQ(vector<int>({ 10, 11 }), ids);
+
+    CATV5PMIGeometryCache::Close();
+    ASSERT_TRUE(CATV5PMIGeometryCache::Open(m_filePath));
+    ASSERT_TRUE(CATV5PMIGeometryCache::Lookup(Key(1), ids));
+    EXPECT_EQ(vector<int>({ 10, 11 }), ids);
+    ASSERT_TRUE(CATV5PMIGeometryCache::Lookup(Key(2), ids));
+    EXPECT_TRUE(ids.empty());
+}
+
+TEST_F(CATV5PMIGeometryCacheTest, EveryKeyFieldButTheSourceIsMatched)
+{
+    ASSERT_TRUE(CATV5PMIGeometryCache::Open(m_filePath));
+    CATV5PMIGeometryCache::Store(Key(1), { 10 }, { 100 });
+
+    vector<int> ids;
+    EXPECT_FALSE(CATV5PMIGeometryCache::Lookup(Key(1, 9, 2), ids));
+    // Same revision of the part: the source hash is not known before the part is indexed
+    ASSERT_TRUE(CATV5PMIGeometryCache::Lookup(Key(1, 1, 0), ids));
+    EXPECT_EQ(vector<int>({ 10 }), ids);
+    CATV5PMIGeometryCacheKey key = Key(1);
+    key.entityType = 4;
+    EXPECT_FALSE(CATV5PMIGeometryCache::Lookup(key, ids));
+    key = Key(1);
+    key.annotationId += "_other";
+    EXPECT_FALSE(CATV5PMIGeometryCache::Lookup(key, ids));
+}
+
+TEST_F(CATV5PMIGeometryCacheTest, LookupPreviousNeedsTheSameSource)
+{
+    ASSERT_TRUE(CATV5PMIGeometryCache::Open(m_filePath));
+    CATV5PMIGeometryCache::Store(Key(1, 1), { 10 }, { 100 });
+    CATV5PMIGeometryCache::Store(Key(1, 2), { 20 }, { 200 });
+
+    vector<int> ids;
+    vector<uint64_t> fingerprints;
+    ASSERT_TRUE(CATV5PMIGeometryCache::LookupPrevious(Key(1, 3), ids, fingerprints));
+    EXPECT_EQ(vector<int>({ 20 }), ids);
+    EXPECT_EQ(vector<uint64_t>({ 200 }), fingerprints);
+    EXPECT_FALSE(CATV5PMIGeometryCache::LookupPrevious(Key(1, 3, 5), ids, fingerprints));
+}
+
+TEST_F(CATV5PMIGeometryCacheTest, TornRecordIsCutOff)
+{
+    ASSERT_TRUE(CATV5PMIGeometryCache::Open(m_filePath));
+    CATV5PMIGeometryCache::Store(Key(1), { 10 }, { 100 });
+    CATV5PMIGeometryCache::Store(Key(2), { 20 }, { 200 });
+    CATV5PMIGeometryCache::Close();
+
+    // A crash in the middle of the second record
+    uint64_t size = FileSize(m_filePath);
+    {
+        ifstream in(m_filePath, ios::binary);
+        string content((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        ofstream out(m_filePath, ios::binary | ios::trunc);
+        out.write(content.data(), static_cast<streamsize>(size - 6));
+    }
+
+    ASSERT_TRUE(CATV5PMIGeometryCache::Open(m_filePath));
+    vector<int> ids;
+    EXPECT_TRUE(CATV5PMIGeometryCache::Lookup(Key(1), ids));
+    EXPECT_FALSE(CATV5PMIGeometryCache::Lookup(Key(2), ids));
+
+    CATV5PMIGeometryCache::Store(Key(3), { 30 }, { 300 });
+    CATV5PMIGeometryCache::Close();
+    ASSERT_TRUE(CATV5PMIGeometryCache::Open(m_filePath));
+    ASSERT_TRUE(CATV5PMIGeometryCache::Lookup(Key(3), ids));
+    EXPECT_EQ(vector<int>({ 30 }), ids);
+}
+
+TEST_F(CATV5PMIGeometryCacheTest, NotACacheFile)
+{
+    {
+        ofstream out(m_filePath, ios::binary | ios::trunc);
+        out << "something else entirely";
+    }
+    EXPECT_FALSE(CATV5PMIGeometryCache::Open(m_filePath));
+    EXPECT_FALSE(CATV5PMIGeometryCache::IsOpen());
+}
+
+TEST_F(CATV5PMIGeometryCacheTest, OtherVersionIsEmptied)
+{
+    ASSERT_TRUE(CATV5PMIGeometryCache::Open(m_filePath));
+    CATV5PMIGeometryCache::Store(Key(1), { 10 }, { 100 });
+    CATV5PMIGeometryCache::Close();
+
+    {
+        fstream stream(m_filePath, ios::binary | ios::in | ios::out);
+        stream.seekp(8);
+        uint32_t version = 1;
+        stream.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+
+    ASSERT_TRUE(CATV5PMIGeometryCache::Open(m_filePath));
+    vector<int> ids;
+    EXPECT_FALSE(CATV5PMIGeometryCache::Lookup(Key(1), ids));
+}
+
+TEST_F(CATV5PMIGeometryCacheTest, SupersededRecordsAreCompacted)
+{
+    vector<int> ids(50, 0);
+    vector<uint64_t> fingerprints(50, 0);
+    for (int revision = 0; revision < 20; revision++)
+    {
+        ASSERT_TRUE(CATV5PMIGeometryCache::Open(m_filePath));
+        ids.assign(50, revision);
+        for (int entity = 0; entity < 100; entity++)
+            CATV5PMIGeometryCache::Store(Key(entity, revision), ids, fingerprints);
+        CATV5PMIGeometryCache::Close();
+    }
+
+    // Each revision adds about 60 KB, a third of which is live after a compaction
+    EXPECT_LT(FileSize(m_filePath), uint64_t(1500000));
+    ASSERT_TRUE(CATV5PMIGeometryCache::Open(m_filePath));
+    ASSERT_TRUE(CATV5PMIGeometryCache::Lookup(Key(7, 19), ids));
+    EXPECT_EQ(19, ids.front());
+}
+
+TEST_F(CATV5PMIGeometryCacheTest, SizeCapKeepsTheNewestRecords)
+{
+    ASSERT_TRUE(CATV5PMIGeometryCache::Open(m_filePath));
+    for (int entity = 0; entity < 2000; entity++)
+        CATV5PMIGeometryCache::Store(Key(entity), { entity }, { 1 });
+    CATV5PMIGeometryCache::Close();
+
+    const uint64_t maxSize = 20000;
+    ASSERT_TRUE(CATV5PMIGeometryCache::Open(m_filePath, maxSize));
+    EXPECT_LE(FileSize(m_filePath), maxSize / 2 + 16);
+
+    vector<int> ids;
+    EXPECT_TRUE(CATV5PMIGeometryCache::Lookup(Key(1999), ids));
+    EXPECT_FALSE(CATV5PMIGeometryCache::Lookup(Key(0), ids));
+
+    // Past twice the cap, stores are dropped until the next open
+    for (int entity = 0; entity < 2000; entity++)
+        CATV5PMIGeometryCache::Store(Key(entity, 5), { entity }, { 1 });
+    EXPECT_LE(FileSize(m_filePath), 2 * maxSize);
+}
+
+TEST_F(CATV5PMIGeometryCacheTest, FileKeyFollowsTheFile)
+{
+    EXPECT_EQ(0u, CATV5PMIGeometryCache::FileKey(m_filePath));
+
+    {
+        ofstream stream(m_filePath, ios::binary);
+        stream << "part";
+    }
+    uint64_t key = CATV5PMIGeometryCache::FileKey(m_filePath);
+    EXPECT_NE(0u, key);
+    EXPECT_EQ(key, CATV5PMIGeometryCache::FileKey(m_filePath));
+
+    {
+        ofstream stream(m_filePath, ios::binary | ios::app);
+        stream << " revised";
+    }
+    EXPECT_NE(key, CATV5PMIGeometryCache::FileKey(m_filePath));
+}
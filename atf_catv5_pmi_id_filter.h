@@ -0,0 +1,71 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ATF
+{
+    // Bloom filter over 64-bit keys: MayContain never misses an added key, and rejects most of the others
+    // with two bit tests in a single cache line. Sized for at most about 2% of false positives.
+    class CATV5PMIIdFilter
+    {
+    public:
+        CATV5PMIIdFilter()
+            : m_mask(0)
+        {}
+
+        // Empties the filter and sizes it for nKeys keys
+        void Reset(size_t nKeys)
+        {
+            // 16 bits per key, rounded up to a power of two words
+            size_t nWords = 1;
+            while (nWords * 64 < nKeys * 16)
+                nWords *= 2;
+            m_words.assign(nWords, 0);
+            m_mask = nWords - 1;
+        }
+
+        void Add(uint64_t key)
+        {
+            uint64_t hash = Mix(key);
+            m_words[Word(hash)] |= Bits(hash);
+        }
+
+        bool MayContain(uint64_t key) const
+        {
+            if (m_words.empty())
+                return false;
+            uint64_t hash = Mix(key);
+            uint64_t bits = Bits(hash);
+            return (m_words[Word(hash)] & bits) == bits;
+        }
+
+    private:
+        // splitmix64 finalizer
+        static uint64_t Mix(uint64_t key)
+        {
+            key += 0x9E3779B97F4A7C15ULL;
+            key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+            return key ^ (key >> 31);
+        }
+
+        size_t Word(uint64_t hash) const { return static_cast<size_t>(hash >> 32) & m_mask; }
+
+        // Two bits of the word, from two independent 6-bit slices of the hash
+        static uint64_t Bits(uint64_t hash) { return (1ULL << (hash & 63)) | (1ULL << ((hash >> 6) & 63)); }
+
+        std::vector<uint64_t> m_words;
+        size_t m_mask;
+    };
+}
@@ -0,0 +1,80 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_id_filter.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+using namespace ATF;
+using namespace std;
+
+TEST(CATV5PMIIdFilter, EmptyFilterContainsNothing)
+{
+    CATV5PMIIdFilter filter;
+    EXPECT_FALSE(filter.MayContain(0));
+    EXPECT_FALSE(filter.MayContain(42));
+
+    filter.Reset(0);
+    EXPECT_FALSE(filter.MayContain(42));
+}
+
+TEST(CATV5PMIIdFilter, NeverMissesAnAddedKey)
+{
+    CATV5PMIIdFilter filter;
+    filter.Reset(10000);
+    mt19937_64 random(7);
+    vector<uint64_t> keys(10000);
+    for (uint64_t& key : keys)
+    {
+        key = random();
+        filter.Add(key);
+    }
+
+    for (uint64_t key : keys)
+        EXPECT_TRUE(filter.MayContain(key));
+}
+
+TEST(CATV5PMIIdFilter, FewFalsePositives)
+{
+    // Face and edge IDs as keyed by CATV5PMIPartIndex: small consecutive ints, edges with bit 32 set
+    CATV5PMIIdFilter filter;
+    filter.Reset(20000);
+    for (uint64_t id = 1; id <= 10000; id++)
+    {
+        filter.Add(id);
+        filter.Add((1ULL << 32) | id);
+    }
+
+    size_t nFalsePositives = 0;
+    const size_t nProbes = 100000;
+    for (uint64_t id = 10001; id <= 10000 + nProbes; id++)
+    {
+        if (filter.MayContain(id))
+            nFalsePositives++;
+    }
+    EXPECT_LT(nFalsePositives, nProbes * 3 / 100);
+}
+
+TEST(CATV5PMIIdFilter, ResetEmptiesTheFilter)
+{
+    CATV5PMIIdFilter filter;
+    filter.Reset(100);
+    for (uint64_t key = 0; key < 100; key++)
+        filter.Add(key);
+
+    filter.Reset(100);
+    size_t nFound = 0;
+    for (uint64_t key = 0; key < 100; key++)
+        nFound += filter.MayContain(key) ? 1 : 0;
+    EXPECT_EQ(0u, nFound);
+}
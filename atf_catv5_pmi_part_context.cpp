@@ -0,0 +1,258 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_part_context.h"
+#include "atf_catv5_pmi_session.h"
+#include "atf_catv5_pmi_stats.h"
+#include "atf_catv5_pmi_trace.h"
+
+#include <atomic>
+#include <unordered_map>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    typedef unordered_map<CC5Part*, shared_ptr<const CATV5PMIPartContext>> PARTCONTEXTMAP;
+
+    // Contexts of the parts of one session
+    struct PartContextRegistry
+    {
+        PartContextRegistry() : generation(1) {}
+
+        mutex partContextMutex;
+        PARTCONTEXTMAP partContexts;
+        // Bumped by every change of partContexts, so that the thread caches of all the threads see it
+        atomic<uint64_t> generation;
+    };
+
+    PartContextRegistry& Registry(CATV5PMISession& session)
+    {
+        return session.State<PartContextRegistry>(CATV5PMISession::kSlot_PartContexts);
+    }
+
+    // Last context used by the thread: builders of the same part are created back to back,
+    // so most lookups do not need the registry lock. A pool thread outlives the sessions and the
+    // registrations it worked for: the entry only holds for the session and registry generation it
+    // was read in, a part address being reused once its part is closed.
+    thread_local uint64_t t_lastSessionId = 0;
+    thread_local uint64_t t_lastGeneration = 0;
+    thread_local CC5Part* t_pLastPart = nullptr;
+    thread_local weak_ptr<const CATV5PMIPartContext> t_pLastContext;
+
+    void ForgetLastContext()
+    {
+        t_pLastPart = nullptr;
+        t_pLastContext.reset();
+    }
+}
+
+CATV5PMIPartContext::CATV5PMIPartContext(CC5Part* pPart, const FINALBODYLIST& finalBodyList, const FINALBODYLIST& otherTranslatableGroups)
+    : m_pPart(pPart)
+    , m_finalBodyList(finalBodyList)
+    , m_othertranslatablegrps(otherTranslatableGroups)
+{}
+
+CATV5PMIPartContext::~CATV5PMIPartContext()
+{}
+
+shared_ptr<const CATV5PMIPartContext> CATV5PMIPartContext::ForPart(CC5Part* pPart)
+{
+    if (!pPart)
+        return nullptr;
+
+    CATV5PMISession* pSession = CATV5PMISession::Current();
+    if (!pSession)
+    {
+        ATF_WARNING_ASSERT(0 && "No PMI session, see CATV5PMITranslation");
+        return nullptr;
+    }
+
+    CATV5PMISession& session = *pSession;
+    PartContextRegistry& registry = Registry(session);
+    if (t_pLastPart == pPart && t_lastSessionId == session.GetId() && t_lastGeneration == registry.generation.load(memory_order_acquire))
+    {
+        shared_ptr<const CATV5PMIPartContext> pContext = t_pLastContext.lock();
+        if (pContext)
+            return pContext;
+    }
+
+    shared_ptr<const CATV5PMIPartContext> pContext;
+    uint64_t generation = 0;
+    {
+        lock_guard<mutex> lock(registry.partContextMutex);
+        generation = registry.generation.load(memory_order_relaxed);
+        shared_ptr<const CATV5PMIPartContext>& pEntry = registry.partContexts[pPart];
+        if (!pEntry)
+            pEntry = Create(pPart, session.TranslatableGroups());
+        pContext = pEntry;
+    }
+
+    t_lastSessionId = session.GetId();
+    t_lastGeneration = generation;
+    t_pLastPart = pPart;
+    t_pLastContext = pContext;
+    return pContext;
+}
+
+shared_ptr<const CATV5PMIPartContext> CATV5PMIPartContext::Register(CC5Part* pPart, const FINALBODYLIST& translatableGroups
+    , shared_ptr<const CATV5PMIPartContext>* pPrevious)
+{
+    if (pPrevious)
+        pPrevious->reset();
+    if (!pPart)
+        return nullptr;
+
+    CATV5PMISession* pSession = CATV5PMISession::Current();
+    if (!pSession)
+    {
+        ATF_WARNING_ASSERT(0 && "No PMI session, see CATV5PMITranslation");
+        return nullptr;
+    }
+
+    shared_ptr<const CATV5PMIPartContext> pContext;
+    shared_ptr<const CATV5PMIPartContext> pReplaced;
+    {
+        PartContextRegistry& registry = Registry(*pSession);
+        lock_guard<mutex> lock(registry.partContextMutex);
+        shared_ptr<const CATV5PMIPartContext>& pEntry = registry.partContexts[pPart];
+        if (pEntry && pEntry->HasGroups(translatableGroups))
+        {
+            // Same groups: the context and its index, if already built, are shared
+            if (pPrevious)
+                *pPrevious = pEntry;
+            return pEntry;
+        }
+
+        pContext = Create(pPart, translatableGroups);
+        pReplaced = move(pEntry);
+        pEntry = pContext;
+        registry.generation.fetch_add(1, memory_order_release);
+    }
+
+    // A builder still holding the replaced context keeps it alive; the thread caches must not
+    ForgetLastContext();
+    if (pPrevious)
+        *pPrevious = move(pReplaced);
+    return pContext;
+}
+
+void CATV5PMIPartContext::Restore(CC5Part* pPart, shared_ptr<const CATV5PMIPartContext> pPrevious)
+{
+    if (!pPrevious)
+    {
+        Release(pPart);
+        return;
+    }
+
+    CATV5PMISession* pSession = CATV5PMISession::Current();
+    if (!pSession)
+        return;
+
+    shared_ptr<const CATV5PMIPartContext> pReplaced;
+    {
+        PartContextRegistry& registry = Registry(*pSession);
+        lock_guard<mutex> lock(registry.partContextMutex);
+        shared_ptr<const CATV5PMIPartContext>& pEntry = registry.partContexts[pPart];
+        if (pEntry == pPrevious)
+            return;
+
+        // Destroyed outside of the lock
+        pReplaced = move(pEntry);
+        pEntry = move(pPrevious);
+        registry.generation.fetch_add(1, memory_order_release);
+    }
+
+    ForgetLastContext();
+}
+
+void CATV5PMIPartContext::Release(CC5Part* pPart)
+{
+    CATV5PMISession* pSession = CATV5PMISession::Current();
+    if (!pSession)
+        return;
+
+    shared_ptr<const CATV5PMIPartContext> pContext;
+    {
+        PartContextRegistry& registry = Registry(*pSession);
+        lock_guard<mutex> lock(registry.partContextMutex);
+        auto itr = registry.partContexts.find(pPart);
+        if (itr == registry.partContexts.end())
+            return;
+
+        // Destroyed outside of the lock, the index can be large
+        pContext = move(itr->second);
+        registry.partContexts.erase(itr);
+        registry.generation.fetch_add(1, memory_order_release);
+    }
+
+    ForgetLastContext();
+}
+
+void CATV5PMIPartContext::ReleaseAll()
+{
+    CATV5PMISession* pSession = CATV5PMISession::Current();
+    if (!pSession)
+        return;
+
+    // Destroyed outside of the lock
+    PARTCONTEXTMAP partContexts;
+    {
+        PartContextRegistry& registry = Registry(*pSession);
+        lock_guard<mutex> lock(registry.partContextMutex);
+        partContexts.swap(registry.partContexts);
+        registry.generation.fetch_add(1, memory_order_release);
+    }
+
+    ForgetLastContext();
+}
+
+void CATV5PMIPartContext::SplitGroups(const FINALBODYLIST& translatableGroups, FINALBODYLIST& finalBodyList, FINALBODYLIST& otherTranslatableGroups)
+{
+    for (auto e : translatableGroups)
+    {
+        if (e && e->GetType() == CC5_SOLIDGROUP_TYPE)
+            finalBodyList.push_back(e);
+        else
+            otherTranslatableGroups.push_back(e);
+    }
+}
+
+shared_ptr<const CATV5PMIPartContext> CATV5PMIPartContext::Create(CC5Part* pPart, const FINALBODYLIST& translatableGroups)
+{
+    ATF_PMI_TRACE_SPAN("CATV5PMIPartContext");
+    FINALBODYLIST finalBodyList;
+    FINALBODYLIST otherTranslatableGroups;
+    SplitGroups(translatableGroups, finalBodyList, otherTranslatableGroups);
+    return shared_ptr<const CATV5PMIPartContext>(new CATV5PMIPartContext(pPart, finalBodyList, otherTranslatableGroups));
+}
+
+// Compared once split, the context only reading the two lists
+bool CATV5PMIPartContext::HasGroups(const FINALBODYLIST& translatableGroups) const
+{
+    FINALBODYLIST finalBodyList;
+    FINALBODYLIST otherTranslatableGroups;
+    SplitGroups(translatableGroups, finalBodyList, otherTranslatableGroups);
+    return finalBodyList == m_finalBodyList && otherTranslatableGroups == m_othertranslatablegrps;
+}
+
+// Built outside of the registry lock, so that contexts of different parts can be indexed concurrently
+const CATV5PMIPartIndex& CATV5PMIPartContext::Index() const
+{
+    call_once(m_indexOnce, [this]()
+    {
+        ATF_PMI_TIME(kTimer_PartIndexBuild);
+        ATF_PMI_TRACE_SPAN("CATV5PMIPartIndex");
+        m_pIndex.reset(new CATV5PMIPartIndex(m_pPart, m_finalBodyList, m_othertranslatablegrps));
+    });
+    return *m_pIndex;
+}
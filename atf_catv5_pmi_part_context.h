@@ -0,0 +1,75 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include "atf_catv5_pmi_part_index.h"
+
+#include <memory>
+#include <mutex>
+
+namespace ATF
+{
+    // Everything the PMI association of one CC5Part needs, shared by all of its GeometryReferenceBuilder:
+    // the translatable groups split into final solid bodies and other groups, and the lookup structures
+    // derived from them. The context is immutable once created; the index is built on first use.
+    class CATV5PMIPartContext
+    {
+    public:
+        CATV5PMIPartContext(CC5Part* pPart, const FINALBODYLIST& finalBodyList, const FINALBODYLIST& otherTranslatableGroups);
+        ~CATV5PMIPartContext();
+
+        // The contexts are kept per CATV5PMISession; ForPart, Register and Release work on the thread's current session,
+        // and ForPart and Register return null outside of any session.
+        // Returns the context of the part, creating it from the session's translatable groups on first use.
+        static std::shared_ptr<const CATV5PMIPartContext> ForPart(CC5Part* pPart);
+
+        // Makes a context built from the translatable groups, given explicitly instead of read from the session,
+        // the one returned by ForPart. Used to translate several parts at once, each with its own groups.
+        // The registered context is kept if it has the same groups, and replaced otherwise; pPrevious receives
+        // it either way, for Restore once the part is done.
+        static std::shared_ptr<const CATV5PMIPartContext> Register(CC5Part* pPart, const FINALBODYLIST& translatableGroups
+            , std::shared_ptr<const CATV5PMIPartContext>* pPrevious = nullptr);
+
+        // Puts back the context Register replaced, or drops the part's context if there was none.
+        static void Restore(CC5Part* pPart, std::shared_ptr<const CATV5PMIPartContext> pPrevious);
+
+        // Drops the context of the part, once all of its annotations have been translated.
+        static void Release(CC5Part* pPart);
+
+        // Drops the contexts of all the parts, at the end of the translation (see CATV5PMITranslation).
+        // A part is only identified by its address, which the reader may give to another part once this one
+        // is closed: the contexts must not outlive the translation of their parts.
+        static void ReleaseAll();
+
+        CC5Part* GetPart() const { return m_pPart; }
+        const FINALBODYLIST& FinalBodyList() const { return m_finalBodyList; }
+        const FINALBODYLIST& OtherTranslatableGroups() const { return m_othertranslatablegrps; }
+
+        const CATV5PMIPartIndex& Index() const;
+
+        // Whether the context is the one the translatable groups would give
+        bool HasGroups(const FINALBODYLIST& translatableGroups) const;
+
+    private:
+        CATV5PMIPartContext(const CATV5PMIPartContext&) = delete;
+        CATV5PMIPartContext& operator=(const CATV5PMIPartContext&) = delete;
+
+        // Splits the translatable groups into final solid bodies and other groups, keeping their order
+        static void SplitGroups(const FINALBODYLIST& translatableGroups, FINALBODYLIST& finalBodyList, FINALBODYLIST& otherTranslatableGroups);
+        static std::shared_ptr<const CATV5PMIPartContext> Create(CC5Part* pPart, const FINALBODYLIST& translatableGroups);
+
+        CC5Part* m_pPart;
+        FINALBODYLIST m_finalBodyList;
+        FINALBODYLIST m_othertranslatablegrps;
+
+        mutable std::once_flag m_indexOnce;
+        mutable std::unique_ptr<CATV5PMIPartIndex> m_pIndex;
+    };
+}
@@ -0,0 +1,766 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_object_handle.h"
+#include "atf_catv5_pmi_part_index.h"
+#include "atf_catv5_pmi_simd.h"
+#include "atf_catv5_pmi_stats.h"
+
+#include <algorithm>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    const uint32_t kNoFace = static_cast<uint32_t>(-1);
+
+    // FNV-1a over the int list of one persistent-ID group
+    uint64_t PersistentGroupHash(const int* idList, uint32_t nIds)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (uint32_t i = 0; i < nIds; i++)
+        {
+            hash ^= static_cast<uint32_t>(idList[i]);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    void MixContentHash(uint64_t& hash, int value)
+    {
+        hash ^= static_cast<uint32_t>(value);
+        hash *= 1099511628211ULL;
+    }
+
+    // Keys of the owner filter, face and edge IDs being filtered together
+    uint64_t FaceKey(int faceId) { return static_cast<uint32_t>(faceId); }
+    uint64_t EdgeKey(int edgeId) { return (1ULL << 32) | static_cast<uint32_t>(edgeId); }
+
+    // Mixes the persistent ID of the face, as read by CATV5PMIPartIndex::FindFacesByPersistentID
+    void MixPersistentID(uint64_t& hash, CC5Entity* pEntity)
+    {
+        CC5Face* pFace = dynamic_cast<CC5Face*>(pEntity);
+        MixContentHash(hash, pFace ? 1 : 0);
+        if (!pFace)
+            return;
+
+        CATV5PMIPersistentID persistentID(pFace);
+        CATV5PMIPersistentIDView view = persistentID.View();
+        MixContentHash(hash, view.bExists ? 1 : 0);
+        MixContentHash(hash, static_cast<int>(view.nGroups));
+        for (uint32_t iGroup = 0; iGroup < view.nGroups; iGroup++)
+        {
+            MixContentHash(hash, static_cast<int>(view.GroupSize(iGroup)));
+            hash ^= PersistentGroupHash(view.GroupBegin(iGroup), view.GroupSize(iGroup));
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    void SortUnique(vector<uint32_t>& values)
+    {
+        sort(values.begin(), values.end());
+        values.erase(unique(values.begin(), values.end()), values.end());
+    }
+}
+
+CATV5PMIPartIndex::CATV5PMIPartIndex(CC5Part* pPart, const FINALBODYLIST& finalBodyList, const FINALBODYLIST& otherTranslatableGroups)
+    : m_contentHash(14695981039346656037ULL)
+    , m_finalSolids(CATV5PMITopologySnapshot::kReadPersistentIDs)
+    , m_pPart(pPart)
+{
+    // Same search order as GeometryReferenceBuilder::CheckForEntityInFinalBody:
+    // surface/curve groups first, then the final solid bodies.
+    for (CC5Group* pGrp : otherTranslatableGroups)
+    {
+        if (pGrp)
+            IndexOtherGroup(pGrp);
+    }
+
+    uint32_t groupOrdinal = 0;
+    for (CC5Group* pGrp : finalBodyList)
+    {
+        if (pGrp && pGrp->GetType() == CC5_SOLIDGROUP_TYPE)
+            m_finalSolids.AddSolidGroup(pGrp, groupOrdinal);
+        groupOrdinal++;
+    }
+    IndexFinalSolids();
+
+    BuildOwners(m_pendingFaceOwners, m_faceOwnerIds, m_faceOwners);
+    BuildOwners(m_pendingEdgeOwners, m_edgeOwnerIds, m_edgeOwners);
+
+    m_ownerFilter.Reset(DenseEntityCount());
+    for (uint32_t i = 0; i < m_faceOwnerIds.Size(); i++)
+        m_ownerFilter.Add(FaceKey(m_faceOwnerIds.IdAt(i)));
+    for (uint32_t i = 0; i < m_edgeOwnerIds.Size(); i++)
+        m_ownerFilter.Add(EdgeKey(m_edgeOwnerIds.IdAt(i)));
+
+    m_contentHash ^= m_finalSolids.ContentHash();
+    m_contentHash *= 1099511628211ULL;
+}
+
+CATV5PMIPartIndex::IntermediateTopology::IntermediateTopology()
+    : solids(0)
+{}
+
+int CATV5PMIPartIndex::FinalFaceOwner(int faceId) const
+{
+    if (!m_ownerFilter.MayContain(FaceKey(faceId)))
+    {
+        ATF_PMI_COUNT(kCounter_FinalOwnerFilterRejects, 1);
+        return 0;
+    }
+    uint32_t slot = m_faceOwnerIds.Find(faceId);
+    return slot != CATV5PMIDenseIds::kNotFound ? m_faceOwners[slot] : 0;
+}
+
+int CATV5PMIPartIndex::FinalEdgeOwner(int edgeId) const
+{
+    if (!m_ownerFilter.MayContain(EdgeKey(edgeId)))
+    {
+        ATF_PMI_COUNT(kCounter_FinalOwnerFilterRejects, 1);
+        return 0;
+    }
+    uint32_t slot = m_edgeOwnerIds.Find(edgeId);
+    return slot != CATV5PMIDenseIds::kNotFound ? m_edgeOwners[slot] : 0;
+}
+
+// Face slots first, then edge slots; an ID used by a face and an edge gets the face slot
+uint32_t CATV5PMIPartIndex::DenseEntitySlot(int entityId) const
+{
+    uint32_t slot = m_faceOwnerIds.Find(entityId);
+    if (slot != CATV5PMIDenseIds::kNotFound)
+        return slot;
+
+    slot = m_edgeOwnerIds.Find(entityId);
+    return slot != CATV5PMIDenseIds::kNotFound ? m_faceOwnerIds.Size() + slot : slot;
+}
+
+void CATV5PMIPartIndex::BuildOwners(IDOWNERS& idOwners, CATV5PMIDenseIds& ids, vector<int>& owners)
+{
+    // Stable, so that the first owner of an ID in translation order stays first
+    stable_sort(idOwners.begin(), idOwners.end(), [](const pair<int, int>& a, const pair<int, int>& b)
+    {
+        return a.first < b.first;
+    });
+
+    vector<int> sortedIds;
+    sortedIds.reserve(idOwners.size());
+    owners.clear();
+    owners.reserve(idOwners.size());
+    for (size_t i = 0; i < idOwners.size(); i++)
+    {
+        if (i > 0 && idOwners[i].first == idOwners[i - 1].first)
+            continue;
+        sortedIds.push_back(idOwners[i].first);
+        owners.push_back(idOwners[i].second);
+    }
+    ids.Assign(move(sortedIds));
+    IDOWNERS().swap(idOwners);
+}
+
+int CATV5PMIPartIndex::FindFacesByPersistentID(CC5Face* asscFace, ENTITIESINFINALSOLID& entities, CC5ReleaseArena& fetched) const
+{
+    if (!asscFace)
+        return 0;
+
+    // Keep translation order, and stop at the first final body having matches
+    uint32_t iMatchedFace = kNoFace;
+    CATV5PMIPersistentID asscFaceID(asscFace);
+    for (uint32_t iFace : MatchingFinalFaces(asscFaceID.View(), true))
+    {
+        if (iMatchedFace != kNoFace && m_finalSolids.FaceGroupOrdinal(iFace) != m_finalSolids.FaceGroupOrdinal(iMatchedFace))
+            break;
+
+        if (CC5Face* pFace = m_finalSolids.FetchFace(iFace, fetched))
+            entities.push_back(pFace);
+        iMatchedFace = iFace;
+    }
+
+    return iMatchedFace != kNoFace ? m_finalSolids.FaceGroupId(iMatchedFace) : 0;
+}
+
+int CATV5PMIPartIndex::FindEdgesByAdjacentFaces(CC5Face* pIntermdtFace1, CC5Face* pIntermdtFace2, ENTITIESINFINALSOLID& entities, CC5ReleaseArena& fetched) const
+{
+    if (!pIntermdtFace1 || !pIntermdtFace2)
+        return 0;
+
+    CATV5PMIPersistentID faceID1(pIntermdtFace1);
+    vector<uint32_t> faces1 = MatchingFinalFaces(faceID1.View(), false);
+    if (faces1.empty())
+        return 0;
+    CATV5PMIPersistentID faceID2(pIntermdtFace2);
+    vector<uint32_t> faces2 = MatchingFinalFaces(faceID2.View(), false);
+    if (faces2.empty())
+        return 0;
+
+    // Co-edges touching a face of the first set, whose other side (or same side) is in the second set
+    vector<uint32_t> coEdges;
+    for (uint32_t iFace : faces1)
+    {
+        for (uint32_t i = m_faceCoEdgeOffsets[iFace]; i < m_faceCoEdgeOffsets[iFace + 1]; i++)
+        {
+            uint32_t iCoEdge = m_faceCoEdges[i];
+            if (binary_search(faces2.begin(), faces2.end(), m_coEdgeFace1[iCoEdge])
+                || binary_search(faces2.begin(), faces2.end(), m_coEdgeFace2[iCoEdge]))
+                coEdges.push_back(iCoEdge);
+        }
+    }
+    SortUnique(coEdges);
+
+    uint32_t iMatchedFace = kNoFace;
+    for (uint32_t iCoEdge : coEdges)
+    {
+        uint32_t iFace = m_coEdgeFaces[iCoEdge];
+        if (iMatchedFace != kNoFace && m_finalSolids.FaceGroupOrdinal(iFace) != m_finalSolids.FaceGroupOrdinal(iMatchedFace))
+            break;
+
+        if (CC5CurveSegment* pEdge = m_finalSolids.FetchEdge(m_coEdgeEdges[iCoEdge], fetched))
+            entities.push_back(pEdge);
+        iMatchedFace = iFace;
+    }
+
+    return iMatchedFace != kNoFace ? m_finalSolids.FaceGroupId(iMatchedFace) : 0;
+}
+
+int CATV5PMIPartIndex::FindIntermediateFace(int faceId, CC5Entity*& pIntermdtEnt1, CC5ReleaseArena& fetched) const
+{
+    const IntermediateTopology& topology = Intermediate();
+    auto itr = topology.faceById.find(faceId);
+    if (itr == topology.faceById.end())
+        return 0;
+
+    pIntermdtEnt1 = topology.solids.FetchFace(itr->second, fetched);
+    return topology.solids.FaceGroupId(itr->second);
+}
+
+int CATV5PMIPartIndex::FindIntermediateCoEdgeFaces(int edgeId, CC5Entity*& pIntermdtEnt1, CC5Entity*& pIntermdtEnt2, CC5ReleaseArena& fetched) const
+{
+    const IntermediateTopology& topology = Intermediate();
+    auto itr = topology.coEdges.find(edgeId);
+    if (itr == topology.coEdges.end())
+        return 0;
+
+    const IntermediateCoEdge& coEdge = itr->second;
+    pIntermdtEnt1 = topology.solids.FetchFace(coEdge.face1, fetched);
+    if (coEdge.face2 == kNoFace)
+        return 0;
+
+    pIntermdtEnt2 = topology.solids.FetchFace(coEdge.face2, fetched);
+    return topology.solids.FaceGroupId(coEdge.face2);
+}
+
+const CATV5PMIPartIndex::IntermediateTopology& CATV5PMIPartIndex::Intermediate() const
+{
+    call_once(m_intermediateOnce, [this]()
+    {
+        unique_ptr<IntermediateTopology> pTopology(new IntermediateTopology);
+        IndexIntermediateSolids(m_pPart, *pTopology);
+        m_pIntermediate = move(pTopology);
+    });
+    return *m_pIntermediate;
+}
+
+uint64_t CATV5PMIPartIndex::Fingerprint(int entityId) const
+{
+    call_once(m_fingerprintsOnce, [this]()
+    {
+        // Face count of each final body, and position of each face in its body
+        uint32_t nFaces = m_finalSolids.FaceCount();
+        vector<uint32_t> bodyFaceCounts;
+        vector<uint32_t> facePositions(nFaces);
+        for (uint32_t iFace = 0; iFace < nFaces; iFace++)
+        {
+            uint32_t ordinal = m_finalSolids.FaceGroupOrdinal(iFace);
+            if (ordinal >= bodyFaceCounts.size())
+                bodyFaceCounts.resize(ordinal + 1, 0);
+            facePositions[iFace] = bodyFaceCounts[ordinal]++;
+        }
+
+        unique_ptr<Fingerprints> pFingerprints(new Fingerprints());
+        for (uint32_t iFace = 0; iFace < nFaces; iFace++)
+        {
+            uint64_t faceFingerprint = FaceFingerprint(iFace, facePositions[iFace], bodyFaceCounts[m_finalSolids.FaceGroupOrdinal(iFace)]);
+            pFingerprints->faces.emplace(m_finalSolids.FaceId(iFace), faceFingerprint);
+
+            // The edge takes the owner of its first face, then the fingerprints of all the faces holding it
+            for (uint32_t iEdge = m_finalSolids.FaceEdgeBegin(iFace); iEdge < m_finalSolids.FaceEdgeEnd(iFace); iEdge++)
+            {
+                auto inserted = pFingerprints->edges.emplace(m_finalSolids.EdgeId(iEdge), 14695981039346656037ULL);
+                uint64_t& edgeFingerprint = inserted.first->second;
+                if (inserted.second)
+                    MixContentHash(edgeFingerprint, m_finalSolids.FaceGroupId(iFace));
+                edgeFingerprint ^= faceFingerprint;
+                edgeFingerprint *= 1099511628211ULL;
+            }
+        }
+        m_pFingerprints = move(pFingerprints);
+    });
+
+    auto faceItr = m_pFingerprints->faces.find(entityId);
+    if (faceItr != m_pFingerprints->faces.end())
+        return faceItr->second;
+    auto edgeItr = m_pFingerprints->edges.find(entityId);
+    return edgeItr != m_pFingerprints->edges.end() ? edgeItr->second : 0;
+}
+
+// Same walk as GeometryReferenceBuilder::ProcessAssociatedGeomEntity, reading only what decides its result
+uint64_t CATV5PMIPartIndex::AssociationFingerprint(CC5Entity* pEntity) const
+{
+    uint64_t fingerprint = 14695981039346656037ULL;
+    if (!pEntity)
+        return fingerprint;
+
+    int nType = pEntity->GetType();
+    MixContentHash(fingerprint, nType);
+    auto* pGroup = dynamic_cast<CC5Group*>(pEntity->GetParent());
+    if (pGroup && pGroup->NeedTranslate() == 1)
+    {
+        MixContentHash(fingerprint, pGroup->GetID());
+        return fingerprint;
+    }
+    MixContentHash(fingerprint, 0);
+
+    switch (nType)
+    {
+    case CC5_SKIN_TYPE:
+    {
+        CC5Skin* pSkin = dynamic_cast<CC5Skin*>(pEntity);
+        if (!pSkin)
+            break;
+        int nFaces = pSkin->GetNumberOfFaces();
+        for (int iFace = 0; iFace < nFaces; iFace++)
+        {
+            CC5ObjectHandle<CC5Face> face(pSkin->GetFaceAt(iFace));
+            MixFaceSource(fingerprint, face.Get(), true);
+        }
+    }
+    break;
+    case CC5_COMPOSITECURVE_TYPE:
+    {
+        CC5CompositeCurve* pCompositeCur = dynamic_cast<CC5CompositeCurve*>(pEntity);
+        if (!pCompositeCur)
+            break;
+        int nSegments = pCompositeCur->GetNumberOfCurveSegments();
+        for (int iSegment = 0; iSegment < nSegments; iSegment++)
+        {
+            CC5ObjectHandle<CC5CurveSegment> segment(pCompositeCur->GetCurveSegmentAt(iSegment));
+            MixEdgeSource(fingerprint, segment.Get());
+        }
+    }
+    break;
+    case CC5_SOLID_TYPE:
+    {
+        CC5Solid* pSolid = dynamic_cast<CC5Solid*>(pEntity);
+        if (!pSolid)
+            break;
+        int nBodies = pSolid->GetNumberOfBodies();
+        for (int iBody = 0; iBody < nBodies; iBody++)
+        {
+            CC5ObjectHandle<CC5Body> body(pSolid->GetBodyAt(iBody));
+            if (!body || body->GetType() != CC5_BODY_TYPE)
+                continue;
+            int nSkins = body->GetNumberOfSkins();
+            for (int iSkin = 0; iSkin < nSkins; iSkin++)
+            {
+                CC5ObjectHandle<CC5Skin> skin(body->GetSkinAt(iSkin));
+                if (!skin)
+                    continue;
+                int nFaces = skin->GetNumberOfFaces();
+                for (int iFace = 0; iFace < nFaces; iFace++)
+                {
+                    // The faces of a solid are looked up among the edge owners, as CheckFacesInFinalBody(pFace, Part, 1, ...) does
+                    CC5ObjectHandle<CC5Face> face(skin->GetFaceAt(iFace));
+                    MixFaceSource(fingerprint, face.Get(), false);
+                }
+            }
+        }
+    }
+    break;
+    default:
+        break;
+    }
+    return fingerprint;
+}
+
+// As GeometryReferenceBuilder::CheckFacesInFinalBody then GetResolvedFaces
+void CATV5PMIPartIndex::MixFaceSource(uint64_t& fingerprint, CC5Face* pFace, bool bFaceOwner) const
+{
+    MixContentHash(fingerprint, pFace ? 1 : 0);
+    if (!pFace)
+        return;
+
+    int faceId = pFace->GetID();
+    int owner = bFaceOwner ? FinalFaceOwner(faceId) : FinalEdgeOwner(faceId);
+    MixContentHash(fingerprint, faceId);
+    MixContentHash(fingerprint, owner);
+    if (owner != 0)
+        return;
+
+    CC5ReleaseArena fetched;
+    CC5Entity* pIntermdtEnt = nullptr;
+    CC5Entity* pParent = pFace->GetParent();
+    pParent = pParent ? pParent->GetParent() : nullptr;
+    if (pParent && pParent->GetType() == CC5_BODY_TYPE)
+        pIntermdtEnt = pFace;
+    else
+        MixContentHash(fingerprint, FindIntermediateFace(faceId, pIntermdtEnt, fetched));
+    MixPersistentID(fingerprint, pIntermdtEnt);
+}
+
+// As GeometryReferenceBuilder::CheckEdgesInFinalBody then GetResolvedEdges
+void CATV5PMIPartIndex::MixEdgeSource(uint64_t& fingerprint, CC5CurveSegment* pEdge) const
+{
+    MixContentHash(fingerprint, pEdge ? 1 : 0);
+    if (!pEdge)
+        return;
+
+    int edgeId = pEdge->GetID();
+    int owner = FinalEdgeOwner(edgeId);
+    MixContentHash(fingerprint, edgeId);
+    MixContentHash(fingerprint, owner);
+    if (owner != 0)
+        return;
+
+    CC5ReleaseArena fetched;
+    CC5Entity* pIntermdtEnt1 = nullptr;
+    CC5Entity* pIntermdtEnt2 = nullptr;
+    int intermediateBodyId = FindIntermediateCoEdgeFaces(edgeId, pIntermdtEnt1, pIntermdtEnt2, fetched);
+    MixContentHash(fingerprint, intermediateBodyId);
+    if (intermediateBodyId == 0)
+        return;
+    MixPersistentID(fingerprint, pIntermdtEnt1);
+    MixPersistentID(fingerprint, pIntermdtEnt2);
+}
+
+bool CATV5PMIPartIndex::FindVertexEdges(const double point[3], double tolerance, vector<int>& edgeIds) const
+{
+    call_once(m_verticesOnce, [this]()
+    {
+        unique_ptr<Vertices> pVertices(new Vertices());
+        IndexVertices(*pVertices);
+        m_pVertices = move(pVertices);
+    });
+
+    CATV5PMIVertexTree::Vertex vertex;
+    double distance = 0;
+    if (!m_pVertices->tree.Nearest(point, tolerance, vertex, distance))
+    {
+        ATF_PMI_COUNT(kCounter_VertexSnapMisses, 1);
+        return false;
+    }
+    ATF_PMI_COUNT(kCounter_VertexSnapHits, 1);
+
+    // The end points of the edges meeting at a vertex only agree within the tolerance
+    vector<uint32_t> edges;
+    m_pVertices->tree.WithinRadius(vertex.pos, tolerance, edges);
+    SortUnique(edges);
+    for (uint32_t iEdge : edges)
+        edgeIds.push_back(m_pVertices->edgeIds[iEdge]);
+    return true;
+}
+
+void CATV5PMIPartIndex::IndexOtherGroup(CC5Group* pGrp)
+{
+    int groupId = pGrp->GetID();
+    MixContentHash(m_contentHash, groupId);
+    switch (pGrp->GetType())
+    {
+    case CC5_SURFACEGROUP_TYPE:
+    {
+        int nEntity = pGrp->GetNumberOfEntities();
+        for (int entityIdx = 0; entityIdx < nEntity; entityIdx++)
+        {
+            CC5ObjectHandle<CC5Entity> entity(pGrp->GetEntityAt(entityIdx));
+            if (!entity || entity->GetType() != CC5_SKIN_TYPE)
+                continue;
+
+            CC5Skin* skin = dynamic_cast<CC5Skin*>(entity.Get());
+            int no_of_faces = skin ? skin->GetNumberOfFaces() : 0;
+            ATF_PMI_COUNT(kCounter_FacesVisited, no_of_faces);
+            for (int ii = 0; ii < no_of_faces; ii++)
+            {
+                CC5ObjectHandle<CC5Face> face(skin->GetFaceAt(ii));
+                if (face)
+                    IndexOtherFace(face.Get(), groupId);
+            }
+        }
+    }
+    break;
+    case CC5_CURVEGROUP_TYPE:
+    {
+        int nentity = pGrp->GetNumberOfEntities();
+        for (int entitycount = 0; entitycount < nentity; entitycount++)
+        {
+            CC5ObjectHandle<CC5Entity> entity(pGrp->GetEntityAt(entitycount));
+            if (!entity || entity->GetType() != CC5_COMPOSITECURVE_TYPE)
+                continue;
+
+            CC5CompositeCurve* compCurve = dynamic_cast<CC5CompositeCurve*>(entity.Get());
+            int edge_count = compCurve ? compCurve->GetNumberOfCurveSegments() : 0;
+            ATF_PMI_COUNT(kCounter_EdgesVisited, edge_count);
+            for (int l = 0; l < edge_count; l++)
+            {
+                CC5ObjectHandle<CC5CurveSegment> edge(compCurve->GetCurveSegmentAt(l));
+                if (!edge)
+                    continue;
+                m_pendingEdgeOwners.emplace_back(edge->GetID(), groupId);
+                MixContentHash(m_contentHash, edge->GetID());
+            }
+        }
+    }
+    break;
+    default:
+        break;
+    }
+}
+
+// Records a face of a surface group and its edges as owned by the group
+void CATV5PMIPartIndex::IndexOtherFace(CC5Face* pFace, int groupId)
+{
+    m_pendingFaceOwners.emplace_back(pFace->GetID(), groupId);
+    MixContentHash(m_contentHash, pFace->GetID());
+
+    int nLoops = pFace->GetNumberOfLoops();
+    for (int iLoop = 0; iLoop < nLoops; iLoop++)
+    {
+        CC5ObjectHandle<CC5Loop> pLoop(pFace->GetLoopAt(iLoop));
+        if (!pLoop) continue;
+        int nEdges = pLoop->GetNumberOfEdges();
+        ATF_PMI_COUNT(kCounter_LoopsVisited, 1);
+        ATF_PMI_COUNT(kCounter_EdgesVisited, nEdges);
+        for (int iEdge = 0; iEdge < nEdges; iEdge++)
+        {
+            CC5ObjectHandle<CC5CurveSegment> pCrvSeg(pLoop->GetEdgeAt(iEdge));
+            if (!pCrvSeg)
+                continue;
+            m_pendingEdgeOwners.emplace_back(pCrvSeg->GetID(), groupId);
+            MixContentHash(m_contentHash, pCrvSeg->GetID());
+        }
+    }
+}
+
+// Derives the owners, persistent-ID buckets and co-edge tables from the snapshot of the final solids
+void CATV5PMIPartIndex::IndexFinalSolids()
+{
+    const CATV5PMITopologySnapshot& solids = m_finalSolids;
+    uint32_t nFaces = solids.FaceCount();
+
+    COEDGEFACES coEdgeFaces;
+    for (uint32_t iFace = 0; iFace < nFaces; iFace++)
+    {
+        int groupId = solids.FaceGroupId(iFace);
+        m_pendingFaceOwners.emplace_back(solids.FaceId(iFace), groupId);
+
+        CATV5PMIPersistentIDView persistentID = solids.PersistentID(iFace);
+        if (persistentID.bExists && persistentID.nGroups == 0)
+            m_ungroupedFaces.push_back(iFace);
+        for (uint32_t iGroup = 0; iGroup < persistentID.nGroups; iGroup++)
+        {
+            vector<uint32_t>& faces = m_persistentGroupFaces[PersistentGroupHash(persistentID.GroupBegin(iGroup), persistentID.GroupSize(iGroup))];
+            if (faces.empty() || faces.back() != iFace)
+                faces.push_back(iFace);
+        }
+
+        for (uint32_t iEdge = solids.FaceEdgeBegin(iFace); iEdge < solids.FaceEdgeEnd(iFace); iEdge++)
+        {
+            int edgeId = solids.EdgeId(iEdge);
+            m_pendingEdgeOwners.emplace_back(edgeId, groupId);
+            if (!solids.IsCoEdge(iEdge))
+                continue;
+
+            vector<uint32_t>& faces = coEdgeFaces[edgeId];
+            faces.push_back(iFace);
+            if (faces.size() < 2)
+                continue;
+
+            m_coEdgeEdges.push_back(iEdge);
+            m_coEdgeFaces.push_back(iFace);
+            m_coEdgeFace1.push_back(faces[0]);
+            m_coEdgeFace2.push_back(faces[1]);
+        }
+    }
+
+    // Face to co-edge adjacency, each face listing its co-edges in translation order
+    uint32_t nCoEdges = static_cast<uint32_t>(m_coEdgeEdges.size());
+    m_faceCoEdgeOffsets.assign(nFaces + 1, 0);
+    for (uint32_t iCoEdge = 0; iCoEdge < nCoEdges; iCoEdge++)
+    {
+        m_faceCoEdgeOffsets[m_coEdgeFace1[iCoEdge] + 1]++;
+        if (m_coEdgeFace2[iCoEdge] != m_coEdgeFace1[iCoEdge])
+            m_faceCoEdgeOffsets[m_coEdgeFace2[iCoEdge] + 1]++;
+    }
+    for (uint32_t iFace = 0; iFace < nFaces; iFace++)
+        m_faceCoEdgeOffsets[iFace + 1] += m_faceCoEdgeOffsets[iFace];
+
+    m_faceCoEdges.resize(m_faceCoEdgeOffsets[nFaces]);
+    vector<uint32_t> fill(m_faceCoEdgeOffsets.begin(), m_faceCoEdgeOffsets.end() - 1);
+    for (uint32_t iCoEdge = 0; iCoEdge < nCoEdges; iCoEdge++)
+    {
+        m_faceCoEdges[fill[m_coEdgeFace1[iCoEdge]]++] = iCoEdge;
+        if (m_coEdgeFace2[iCoEdge] != m_coEdgeFace1[iCoEdge])
+            m_faceCoEdges[fill[m_coEdgeFace2[iCoEdge]]++] = iCoEdge;
+    }
+}
+
+// The intermediate bodies are all the solid groups of the part, translatable or not.
+// A face is looked up by ID when it is the first one with that ID, and by co-edge when it is one of its first two faces.
+void CATV5PMIPartIndex::IndexIntermediateSolids(CC5Part* pPart, IntermediateTopology& topology)
+{
+    if (!pPart)
+        return;
+
+    ATF_PMI_TIME(kTimer_IntermediateSolidWalk);
+    CATV5PMITopologySnapshot& solids = topology.solids;
+    int nGrps = pPart->GetNumberOfGroups();
+    for (int i = 0; i < nGrps; i++)
+    {
+        CC5Group* pGrp = pPart->GetGroupAt(i);
+        if (pGrp && pGrp->GetType() == CC5_SOLIDGROUP_TYPE)
+            solids.AddSolidGroup(pGrp, static_cast<uint32_t>(i));
+    }
+
+    uint32_t nFaces = solids.FaceCount();
+    for (uint32_t iFace = 0; iFace < nFaces; iFace++)
+    {
+        topology.faceById.emplace(solids.FaceId(iFace), iFace);
+
+        for (uint32_t iEdge = solids.FaceEdgeBegin(iFace); iEdge < solids.FaceEdgeEnd(iFace); iEdge++)
+        {
+            if (!solids.IsCoEdge(iEdge))
+                continue;
+
+            IntermediateCoEdge newCoEdge = { kNoFace, kNoFace };
+            IntermediateCoEdge& coEdge = topology.coEdges.emplace(solids.EdgeId(iEdge), newCoEdge).first->second;
+            if (coEdge.face1 == kNoFace)
+                coEdge.face1 = iFace;
+            else if (coEdge.face2 == kNoFace)
+                coEdge.face2 = iFace;
+        }
+    }
+}
+
+// Both end points of every edge of the final solids, each edge being fetched again once, in translation order
+void CATV5PMIPartIndex::IndexVertices(Vertices& vertices) const
+{
+    vector<CATV5PMIVertexTree::Vertex> endPoints;
+    vector<bool> edgeRead(m_edgeOwnerIds.Size(), false);
+    for (uint32_t iFace = 0; iFace < m_finalSolids.FaceCount(); iFace++)
+    {
+        for (uint32_t iLoop = m_finalSolids.FaceLoopBegin(iFace); iLoop < m_finalSolids.FaceLoopEnd(iFace); iLoop++)
+        {
+            for (uint32_t iEdge = m_finalSolids.LoopEdgeBegin(iLoop); iEdge < m_finalSolids.LoopEdgeEnd(iLoop); iEdge++)
+            {
+                uint32_t slot = m_edgeOwnerIds.Find(m_finalSolids.EdgeId(iEdge));
+                if (slot == CATV5PMIDenseIds::kNotFound || edgeRead[slot])
+                    continue;
+                edgeRead[slot] = true;
+
+                CC5ReleaseArena fetched;
+                CC5CurveSegment* pCrvSeg = m_finalSolids.FetchEdge(iEdge, fetched);
+                CATV5PMIVertexTree::Vertex start, end;
+                if (!pCrvSeg || pCrvSeg->GetStartPoint(start.pos) != CC5_QUERY_SUCCESS || pCrvSeg->GetEndPoint(end.pos) != CC5_QUERY_SUCCESS)
+                    continue;
+                start.payload = end.payload = static_cast<uint32_t>(vertices.edgeIds.size());
+                vertices.edgeIds.push_back(m_finalSolids.EdgeId(iEdge));
+                endPoints.push_back(start);
+                endPoints.push_back(end);
+            }
+        }
+    }
+    vertices.tree.Build(move(endPoints));
+}
+
+uint64_t CATV5PMIPartIndex::FaceFingerprint(uint32_t iFace, uint32_t position, uint32_t bodyFaceCount) const
+{
+    uint64_t fingerprint = 14695981039346656037ULL;
+    MixContentHash(fingerprint, m_finalSolids.FaceGroupId(iFace));
+    MixContentHash(fingerprint, static_cast<int>(m_finalSolids.FaceGroupOrdinal(iFace)));
+    MixContentHash(fingerprint, static_cast<int>(position));
+    MixContentHash(fingerprint, static_cast<int>(bodyFaceCount));
+
+    CATV5PMIPersistentIDView persistentID = m_finalSolids.PersistentID(iFace);
+    MixContentHash(fingerprint, persistentID.bExists ? 1 : 0);
+    MixContentHash(fingerprint, static_cast<int>(persistentID.nGroups));
+    MixContentHash(fingerprint, static_cast<int>(m_ungroupedFaces.size()));
+    MixContentHash(fingerprint, m_ungroupedFaces.empty() ? -1 : static_cast<int>(m_finalSolids.FaceGroupOrdinal(m_ungroupedFaces.front())));
+    for (uint32_t iGroup = 0; iGroup < persistentID.nGroups; iGroup++)
+    {
+        uint64_t groupHash = PersistentGroupHash(persistentID.GroupBegin(iGroup), persistentID.GroupSize(iGroup));
+        auto itr = m_persistentGroupFaces.find(groupHash);
+        MixContentHash(fingerprint, static_cast<int>(persistentID.GroupSize(iGroup)));
+        MixContentHash(fingerprint, itr != m_persistentGroupFaces.end() ? static_cast<int>(itr->second.size()) : 0);
+        // The first final body having a face of the group, which the search stops at
+        MixContentHash(fingerprint, itr != m_persistentGroupFaces.end() ? static_cast<int>(m_finalSolids.FaceGroupOrdinal(itr->second.front())) : -1);
+        fingerprint ^= groupHash;
+        fingerprint *= 1099511628211ULL;
+    }
+    return fingerprint;
+}
+
+// Same rules as GeometryReferenceBuilder::CheckFaceInFaceGroups(pFace, asscFace, bFaceMatched):
+// a persistent ID without any group matches any face, a missing one matches none.
+bool CATV5PMIPartIndex::PersistentIDsMatch(const CATV5PMIPersistentIDView& faceID, const CATV5PMIPersistentIDView& asscFaceID)
+{
+    ATF_PMI_COUNT(kCounter_PersistentIDComparisons, 1);
+    if (!faceID.bExists)
+        return false;
+    if (faceID.nGroups == 0)
+        return true;
+    if (!asscFaceID.bExists)
+        return false;
+    if (asscFaceID.nGroups == 0)
+        return true;
+
+    for (uint32_t iGroup = 0; iGroup < faceID.nGroups; iGroup++)
+    {
+        if (CATV5PMIPersistentIDKernel::FindGroup(faceID.GroupBegin(iGroup), faceID.GroupSize(iGroup),
+            asscFaceID.ids, asscFaceID.groupOffsets, asscFaceID.nGroups))
+            return true;
+    }
+    return false;
+}
+
+// Returns the final faces matching the persistent ID of an intermediate face, in translation order.
+// bFinalFaceFirst gives the argument order of the equivalent CheckFaceInFaceGroups call.
+vector<uint32_t> CATV5PMIPartIndex::MatchingFinalFaces(const CATV5PMIPersistentIDView& persistentID, bool bFinalFaceFirst) const
+{
+    vector<uint32_t> candidates;
+    if (persistentID.bExists && persistentID.nGroups == 0)
+    {
+        candidates.resize(m_finalSolids.FaceCount());
+        for (uint32_t iFace = 0; iFace < candidates.size(); iFace++)
+            candidates[iFace] = iFace;
+    }
+    else
+    {
+        candidates = m_ungroupedFaces;
+        for (uint32_t iGroup = 0; iGroup < persistentID.nGroups; iGroup++)
+        {
+            auto itr = m_persistentGroupFaces.find(PersistentGroupHash(persistentID.GroupBegin(iGroup), persistentID.GroupSize(iGroup)));
+            if (itr != m_persistentGroupFaces.end())
+                candidates.insert(candidates.end(), itr->second.begin(), itr->second.end());
+        }
+        SortUnique(candidates);
+    }
+
+    vector<uint32_t> matches;
+    for (uint32_t iFace : candidates)
+    {
+        CATV5PMIPersistentIDView finalFaceID = m_finalSolids.PersistentID(iFace);
+        bool bFaceMatched = bFinalFaceFirst
+            ? PersistentIDsMatch(finalFaceID, persistentID)
+            : PersistentIDsMatch(persistentID, finalFaceID);
+        if (bFaceMatched)
+            matches.push_back(iFace);
+    }
+    return matches;
+}
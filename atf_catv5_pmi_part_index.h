@@ -0,0 +1,182 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include "atf_catv5_pmi_dense_ids.h"
+#include "atf_catv5_pmi_id_filter.h"
+#include "atf_catv5_pmi_topology_snapshot.h"
+#include "atf_catv5_pmi_util.h"
+#include "atf_catv5_pmi_vertex_tree.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ATF
+{
+    // Lookup tables over the final translatable groups of one CC5Part.
+    // The B-rep of those groups is walked once per part into a flat snapshot, and every GeometryReferenceBuilder
+    // created for the part shares the result (through CATV5PMIPartContext) instead of walking it
+    // again per annotation. The intermediate solids of the part are only indexed when a query first needs them.
+    class CATV5PMIPartIndex
+    {
+    public:
+        CATV5PMIPartIndex(CC5Part* pPart, const FINALBODYLIST& finalBodyList, const FINALBODYLIST& otherTranslatableGroups);
+
+        // Hash of the translatable groups of the part as indexed: the IDs owned by the surface/curve groups,
+        // then the snapshot of the final solids. Stable across sessions for an unchanged part.
+        uint64_t ContentHash() const { return m_contentHash; }
+
+        // Fingerprint of a face or edge of the final solids, 0 for any other ID. It covers the owning group,
+        // the face's body and position in it, the body's face count, the persistent ID of the face (of the
+        // faces holding the edge), and the number of final faces sharing each of its groups with the first
+        // body holding one, i.e. what the search from an intermediate face to the final faces depends on.
+        // Computed for the whole part on first use.
+        uint64_t Fingerprint(int entityId) const;
+
+        // Fingerprint of what resolving the associated entity reads besides the final groups: the owner of
+        // each of its faces/edges and, for the ones not owned, the persistent ID of the intermediate face
+        // (of the two faces sharing the edge) the search starts from. Indexes the intermediate solids if needed.
+        uint64_t AssociationFingerprint(CC5Entity* pEntity) const;
+
+        // Dense slot of the ID of a face or edge of the translatable groups, in [0, DenseEntityCount()),
+        // CATV5PMIDenseIds::kNotFound for any other ID.
+        uint32_t DenseEntityCount() const { return m_faceOwnerIds.Size() + m_edgeOwnerIds.Size(); }
+        uint32_t DenseEntitySlot(int entityId) const;
+
+        // Returns the ID of the translatable group owning the face/edge, 0 if there is none.
+        int FinalFaceOwner(int faceId) const;
+        int FinalEdgeOwner(int edgeId) const;
+
+        // The lookups below fetch the faces/edges they give from the reader again, and leave them
+        // (and the objects fetched on the way) to fetched.
+
+        // Finds the final faces resulting from the intermediate face asscFace, i.e. the faces sharing
+        // one of its persistent-ID groups. The matching faces of the first final body having any are
+        // appended to entities. Returns the ID of that body's group, 0 if no face matched.
+        int FindFacesByPersistentID(CC5Face* asscFace, ENTITIESINFINALSOLID& entities, CC5ReleaseArena& fetched) const;
+
+        // Finds the final co-edges whose two faces result from pIntermdtFace1 and pIntermdtFace2.
+        // The matching edges of the first final body having any are appended to entities.
+        // Returns the ID of that body's group, 0 if no edge matched.
+        int FindEdgesByAdjacentFaces(CC5Face* pIntermdtFace1, CC5Face* pIntermdtFace2, ENTITIESINFINALSOLID& entities, CC5ReleaseArena& fetched) const;
+
+        // Gives the first face with ID faceId in the solid groups of the part.
+        // Returns the ID of the group holding it, 0 if there is none.
+        int FindIntermediateFace(int faceId, CC5Entity*& pIntermdtEnt1, CC5ReleaseArena& fetched) const;
+
+        // Gives the two faces sharing the co-edge edgeId in the solid groups of the part.
+        // Returns the ID of the group holding the second face, 0 if the edge has less than two faces.
+        int FindIntermediateCoEdgeFaces(int edgeId, CC5Entity*& pIntermdtEnt1, CC5Entity*& pIntermdtEnt2, CC5ReleaseArena& fetched) const;
+
+        // Snaps point to the nearest vertex of the final solids not farther than tolerance, and appends the IDs
+        // of the final edges ending at it, in translation order. Returns false if no vertex is near enough.
+        // The vertices are read from the end points of the edges on first use.
+        bool FindVertexEdges(const double point[3], double tolerance, std::vector<int>& edgeIds) const;
+
+    private:
+        CATV5PMIPartIndex(const CATV5PMIPartIndex&) = delete;
+        CATV5PMIPartIndex& operator=(const CATV5PMIPartIndex&) = delete;
+
+        // The first two faces sharing a co-edge in the solid groups of the part
+        struct IntermediateCoEdge
+        {
+            uint32_t face1;
+            uint32_t face2;
+        };
+
+        // Solid groups of the part, translatable or not, with the faces that can be returned by a lookup
+        struct IntermediateTopology
+        {
+            IntermediateTopology();
+
+            CATV5PMITopologySnapshot solids;
+            std::unordered_map<int, uint32_t> faceById;
+            std::unordered_map<int, IntermediateCoEdge> coEdges;
+        };
+
+        struct Fingerprints
+        {
+            std::unordered_map<int, uint64_t> faces;
+            std::unordered_map<int, uint64_t> edges;
+        };
+
+        // End points of the final edges; the payload of a vertex is the position of its edge in edgeIds
+        struct Vertices
+        {
+            CATV5PMIVertexTree tree;
+            std::vector<int> edgeIds;
+        };
+
+        typedef std::unordered_map<int, std::vector<uint32_t>> COEDGEFACES;
+
+        void IndexOtherGroup(CC5Group* pGrp);
+        void IndexOtherFace(CC5Face* pFace, int groupId);
+        void IndexFinalSolids();
+        const IntermediateTopology& Intermediate() const;
+        uint64_t FaceFingerprint(uint32_t iFace, uint32_t position, uint32_t bodyFaceCount) const;
+        void MixFaceSource(uint64_t& fingerprint, CC5Face* pFace, bool bFaceOwner) const;
+        void MixEdgeSource(uint64_t& fingerprint, CC5CurveSegment* pEdge) const;
+        void IndexVertices(Vertices& vertices) const;
+        static void IndexIntermediateSolids(CC5Part* pPart, IntermediateTopology& topology);
+
+        static bool PersistentIDsMatch(const CATV5PMIPersistentIDView& faceID, const CATV5PMIPersistentIDView& asscFaceID);
+        std::vector<uint32_t> MatchingFinalFaces(const CATV5PMIPersistentIDView& persistentID, bool bFinalFaceFirst) const;
+
+        typedef std::vector<std::pair<int, int>> IDOWNERS;
+
+        // Keeps the first owner of each ID, and gives the IDs their dense slots
+        static void BuildOwners(IDOWNERS& idOwners, CATV5PMIDenseIds& ids, std::vector<int>& owners);
+
+        // Owning group of the faces/edges, by dense slot of their IDs. The first group found in
+        // translation order wins, as in the original linear search.
+        CATV5PMIDenseIds m_faceOwnerIds;
+        std::vector<int> m_faceOwners;
+        CATV5PMIDenseIds m_edgeOwnerIds;
+        std::vector<int> m_edgeOwners;
+        // (ID, group) in translation order, until the owners are built
+        IDOWNERS m_pendingFaceOwners;
+        IDOWNERS m_pendingEdgeOwners;
+        // All the owned IDs, so that most IDs of modified geometry are rejected without probing them
+        CATV5PMIIdFilter m_ownerFilter;
+        uint64_t m_contentHash;
+
+        // Faces of the final solid bodies in translation order
+        CATV5PMITopologySnapshot m_finalSolids;
+
+        // Final faces keyed by persistent-ID group hash
+        std::unordered_map<uint64_t, std::vector<uint32_t>> m_persistentGroupFaces;
+        // Faces having a persistent ID without any group, which match any intermediate face
+        std::vector<uint32_t> m_ungroupedFaces;
+
+        // Second (or later) uses of a co-edge in the final bodies, in translation order: the edge use,
+        // the face holding it, and the first two faces sharing the edge
+        std::vector<uint32_t> m_coEdgeEdges;
+        std::vector<uint32_t> m_coEdgeFaces;
+        std::vector<uint32_t> m_coEdgeFace1;
+        std::vector<uint32_t> m_coEdgeFace2;
+
+        // Co-edges touching each final face: m_faceCoEdges[m_faceCoEdgeOffsets[iFace], m_faceCoEdgeOffsets[iFace + 1])
+        std::vector<uint32_t> m_faceCoEdgeOffsets;
+        std::vector<uint32_t> m_faceCoEdges;
+
+        // Built on first use, by whichever builder gets there first
+        CC5Part* m_pPart;
+        mutable std::once_flag m_intermediateOnce;
+        mutable std::unique_ptr<IntermediateTopology> m_pIntermediate;
+        mutable std::once_flag m_fingerprintsOnce;
+        mutable std::unique_ptr<Fingerprints> m_pFingerprints;
+        mutable std::once_flag m_verticesOnce;
+        mutable std::unique_ptr<Vertices> m_pVertices;
+    };
+}
@@ -0,0 +1,306 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_object_handle.h"
+#include "atf_catv5_pmi_fake_reader.h"
+#include "atf_catv5_pmi_part_index.h"
+#include "atf_catv5_pmi_translation.h"
+#include "atf_catv5_producer_impl.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    const double kOrigin[3] = { 0, 0, 0 };
+
+    // Skin of a new body of a new solid of pGroup
+    CC5Skin* AddBodySkin(FakeCC5Model& model, CC5Group* pGroup, int& nextId)
+    {
+        CC5Solid* pSolid = model.AddSolid(pGroup, nextId++);
+        CC5Body* pBody = model.AddBody(pSolid, nextId++);
+        return model.AddSkin(pBody, nextId++);
+    }
+
+    CC5Face* AddFace(FakeCC5Model& model, CC5Skin* pSkin, int id, const vector<vector<int>>& persistentID)
+    {
+        CC5Face* pFace = model.AddFace(pSkin, id);
+        model.SetPersistentID(pFace, persistentID);
+        return pFace;
+    }
+
+    // Two faces of pSkin sharing the co-edge edgeId, with the persistent IDs { { key1 } } and { { key2 } }
+    void AddCoEdgeFaces(FakeCC5Model& model, CC5Skin* pSkin, int faceId1, int faceId2, int edgeId, int key1, int key2, int& nextId)
+    {
+        CC5Face* pFace1 = AddFace(model, pSkin, faceId1, { { key1 } });
+        model.AddEdge(model.AddLoop(pFace1, nextId++), edgeId, true, kOrigin, kOrigin);
+        CC5Face* pFace2 = AddFace(model, pSkin, faceId2, { { key2 } });
+        model.AddEdge(model.AddLoop(pFace2, nextId++), edgeId, true, kOrigin, kOrigin);
+    }
+
+    vector<int> Ids(const ENTITIESINFINALSOLID& entities)
+    {
+        vector<int> ids;
+        for (CC5Entity* pEntity : entities)
+            ids.push_back(pEntity->GetID());
+        return ids;
+    }
+
+    // Checks that every object the reader gave during the test was freed, and no other
+    class ReaderObjectsTest : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            m_liveObjects = FakeCC5Model::LiveObjects();
+            m_badDeletes = FakeCC5Model::BadDeletes();
+        }
+
+        void TearDown() override
+        {
+            EXPECT_EQ(m_liveObjects, FakeCC5Model::LiveObjects());
+            EXPECT_EQ(m_badDeletes, FakeCC5Model::BadDeletes());
+        }
+
+    private:
+        long m_liveObjects;
+        long m_badDeletes;
+    };
+
+    // Associations resolved the way the producer does, in the session kept for the part
+    class ReferencedGeometryTest : public ReaderObjectsTest
+    {
+    protected:
+        void TearDown() override
+        {
+            CATV5PMIPartSessionScope::Close();
+            CATV5ProducerImpl::Get()->SetTranslatableGroups(FINALBODYLIST());
+            CATV5ProducerImpl::Get()->SetEventManager(nullptr);
+            ReaderObjectsTest::TearDown();
+        }
+
+        void Translate(const FakeCC5Model& model)
+        {
+            CATV5ProducerImpl::Get()->SetTranslatableGroups(model.TranslatableGroups());
+            CATV5ProducerImpl::Get()->SetEventManager(&m_eventManager);
+        }
+
+        vector<int> ReferencedGeometryIds(CC5Entity* pEntity, CC5Part* pPart)
+        {
+            vector<int> ids;
+            GeometryReferenceBuilder builder(pEntity, pPart);
+            EXPECT_TRUE(builder.ReferencedGeometryIds(ids));
+            return ids;
+        }
+
+        EventManager m_eventManager;
+    };
+
+    typedef ReaderObjectsTest CATV5PMIPartIndexTest;
+    typedef ReferencedGeometryTest CATV5PMIReferencedGeometryTest;
+}
+
+TEST_F(CATV5PMIPartIndexTest, FindFacesByPersistentIDGivesTheSplitFaces)
+{
+    FakeCC5Model model;
+    int nextId = 1000;
+    CC5Group* pFinal = model.AddGroup(100, CC5_SOLIDGROUP_TYPE, true);
+    CC5Skin* pFinalSkin = AddBodySkin(model, pFinal, nextId);
+    AddFace(model, pFinalSkin, 11, { { 1, 2 } });
+    AddFace(model, pFinalSkin, 12, { { 7 } });
+    AddFace(model, pFinalSkin, 13, { { 3 }, { 1, 2 } });
+
+    CC5Group* pIntermediate = model.AddGroup(10, CC5_SOLIDGROUP_TYPE, false);
+    CC5Skin* pIntermediateSkin = AddBodySkin(model, pIntermediate, nextId);
+    CC5Face* pSplitFace = AddFace(model, pIntermediateSkin, 21, { { 1, 2 } });
+    CC5Face* pRemovedFace = AddFace(model, pIntermediateSkin, 22, { { 5 } });
+
+    CATV5PMIPartIndex index(model.Part(), { pFinal }, FINALBODYLIST());
+
+    CC5ReleaseArena fetched;
+    ENTITIESINFINALSOLID entities;
+    EXPECT_EQ(100, index.FindFacesByPersistentID(pSplitFace, entities, fetched));
+    EXPECT_EQ(vector<int>({ 11, 13 }), Ids(entities));
+
+    entities.clear();
+    EXPECT_EQ(0, index.FindFacesByPersistentID(pRemovedFace, entities, fetched));
+    EXPECT_TRUE(entities.empty());
+}
+
+TEST_F(CATV5PMIPartIndexTest, FindFacesByPersistentIDStopsAtTheFirstBody)
+{
+    FakeCC5Model model;
+    int nextId = 1000;
+    CC5Group* pFirst = model.AddGroup(100, CC5_SOLIDGROUP_TYPE, true);
+    AddFace(model, AddBodySkin(model, pFirst, nextId), 11, { { 1 } });
+    CC5Group* pSecond = model.AddGroup(101, CC5_SOLIDGROUP_TYPE, true);
+    CC5Skin* pSecondSkin = AddBodySkin(model, pSecond, nextId);
+    AddFace(model, pSecondSkin, 21, { { 1 } });
+    AddFace(model, pSecondSkin, 22, { { 1 } });
+
+    CC5Group* pIntermediate = model.AddGroup(10, CC5_SOLIDGROUP_TYPE, false);
+    CC5Face* pFace = AddFace(model, AddBodySkin(model, pIntermediate, nextId), 31, { { 1 } });
+
+    CC5ReleaseArena fetched;
+    {
+        CATV5PMIPartIndex index(model.Part(), { pFirst, pSecond }, FINALBODYLIST());
+        ENTITIESINFINALSOLID entities;
+        EXPECT_EQ(100, index.FindFacesByPersistentID(pFace, entities, fetched));
+        EXPECT_EQ(vector<int>({ 11 }), Ids(entities));
+    }
+    {
+        // The first body in translation order, not in the part
+        CATV5PMIPartIndex index(model.Part(), { pSecond, pFirst }, FINALBODYLIST());
+        ENTITIESINFINALSOLID entities;
+        EXPECT_EQ(101, index.FindFacesByPersistentID(pFace, entities, fetched));
+        EXPECT_EQ(vector<int>({ 21, 22 }), Ids(entities));
+    }
+}
+
+TEST_F(CATV5PMIPartIndexTest, FindEdgesByAdjacentFacesGivesTheCoEdge)
+{
+    FakeCC5Model model;
+    FakeCC5StripPart strip(model, 1, 4);
+    CATV5PMIPartIndex index(model.Part(), model.TranslatableGroups(), FINALBODYLIST());
+
+    CC5ReleaseArena fetched;
+    ENTITIESINFINALSOLID entities;
+    EXPECT_EQ(100, index.FindEdgesByAdjacentFaces(strip.intermediateFaces[0][1], strip.intermediateFaces[0][2], entities, fetched));
+    EXPECT_EQ(vector<int>({ strip.finalCoEdges[0][1]->GetID() }), Ids(entities));
+
+    // Either order of the faces
+    entities.clear();
+    EXPECT_EQ(100, index.FindEdgesByAdjacentFaces(strip.intermediateFaces[0][2], strip.intermediateFaces[0][1], entities, fetched));
+    EXPECT_EQ(vector<int>({ strip.finalCoEdges[0][1]->GetID() }), Ids(entities));
+
+    // Faces not sharing an edge
+    entities.clear();
+    EXPECT_EQ(0, index.FindEdgesByAdjacentFaces(strip.intermediateFaces[0][0], strip.intermediateFaces[0][2], entities, fetched));
+    EXPECT_TRUE(entities.empty());
+}
+
+TEST_F(CATV5PMIPartIndexTest, FindEdgesByAdjacentFacesStopsAtTheFirstBody)
+{
+    FakeCC5Model model;
+    int nextId = 1000;
+    CC5Group* pFirst = model.AddGroup(100, CC5_SOLIDGROUP_TYPE, true);
+    AddCoEdgeFaces(model, AddBodySkin(model, pFirst, nextId), 11, 12, 501, 1, 2, nextId);
+    CC5Group* pSecond = model.AddGroup(101, CC5_SOLIDGROUP_TYPE, true);
+    AddCoEdgeFaces(model, AddBodySkin(model, pSecond, nextId), 21, 22, 601, 1, 2, nextId);
+
+    CC5Group* pIntermediate = model.AddGroup(10, CC5_SOLIDGROUP_TYPE, false);
+    CC5Skin* pIntermediateSkin = AddBodySkin(model, pIntermediate, nextId);
+    CC5Face* pFace1 = AddFace(model, pIntermediateSkin, 31, { { 1 } });
+    CC5Face* pFace2 = AddFace(model, pIntermediateSkin, 32, { { 2 } });
+
+    CC5ReleaseArena fetched;
+    {
+        CATV5PMIPartIndex index(model.Part(), { pFirst, pSecond }, FINALBODYLIST());
+        ENTITIESINFINALSOLID entities;
+        EXPECT_EQ(100, index.FindEdgesByAdjacentFaces(pFace1, pFace2, entities, fetched));
+        EXPECT_EQ(vector<int>({ 501 }), Ids(entities));
+    }
+    {
+        CATV5PMIPartIndex index(model.Part(), { pSecond, pFirst }, FINALBODYLIST());
+        ENTITIESINFINALSOLID entities;
+        EXPECT_EQ(101, index.FindEdgesByAdjacentFaces(pFace1, pFace2, entities, fetched));
+        EXPECT_EQ(vector<int>({ 601 }), Ids(entities));
+    }
+}
+
+TEST_F(CATV5PMIPartIndexTest, FinalOwnerIsTheFirstGroup)
+{
+    FakeCC5Model model;
+    int nextId = 1000;
+    CC5Group* pFirst = model.AddGroup(100, CC5_SOLIDGROUP_TYPE, true);
+    AddCoEdgeFaces(model, AddBodySkin(model, pFirst, nextId), 11, 12, 501, 1, 2, nextId);
+    CC5Group* pSecond = model.AddGroup(101, CC5_SOLIDGROUP_TYPE, true);
+    AddCoEdgeFaces(model, AddBodySkin(model, pSecond, nextId), 11, 22, 501, 1, 2, nextId);
+    // Surface groups are searched before the solids
+    CC5Group* pSurfaces = model.AddGroup(200, CC5_SURFACEGROUP_TYPE, true);
+    model.AddFace(model.AddSkin(pSurfaces, nextId++), 12);
+
+    CATV5PMIPartIndex index(model.Part(), { pFirst, pSecond }, { pSurfaces });
+    EXPECT_EQ(100, index.FinalFaceOwner(11));
+    EXPECT_EQ(200, index.FinalFaceOwner(12));
+    EXPECT_EQ(101, index.FinalFaceOwner(22));
+    EXPECT_EQ(100, index.FinalEdgeOwner(501));
+    EXPECT_EQ(0, index.FinalFaceOwner(501));
+    EXPECT_EQ(0, index.FinalFaceOwner(99));
+}
+
+TEST_F(CATV5PMIPartIndexTest, FindIntermediateCoEdgeFacesGivesBothFaces)
+{
+    FakeCC5Model model;
+    FakeCC5StripPart strip(model, 2, 3);
+    CATV5PMIPartIndex index(model.Part(), model.TranslatableGroups(), FINALBODYLIST());
+
+    CC5ReleaseArena fetched;
+    CC5Entity* pFace = nullptr;
+    EXPECT_EQ(10, index.FindIntermediateFace(strip.intermediateFaces[1][2]->GetID(), pFace, fetched));
+    ASSERT_NE(nullptr, pFace);
+    EXPECT_EQ(strip.intermediateFaces[1][2]->GetID(), pFace->GetID());
+
+    int edgeId = FakeCC5StripPart::kIntermediateEdgeBase + 3 * (3 + 1) + 1;
+    CC5Entity* pFace1 = nullptr;
+    CC5Entity* pFace2 = nullptr;
+    EXPECT_EQ(10, index.FindIntermediateCoEdgeFaces(edgeId, pFace1, pFace2, fetched));
+    ASSERT_NE(nullptr, pFace1);
+    ASSERT_NE(nullptr, pFace2);
+    EXPECT_EQ(strip.intermediateFaces[1][0]->GetID(), pFace1->GetID());
+    EXPECT_EQ(strip.intermediateFaces[1][1]->GetID(), pFace2->GetID());
+}
+
+TEST_F(CATV5PMIReferencedGeometryTest, ReferencesResolveToTheFinalBodies)
+{
+    FakeCC5Model model;
+    FakeCC5StripPart strip(model, 2, 5);
+    Translate(model);
+
+    for (int b = 0; b < 2; b++)
+    {
+        for (size_t f = 0; f < strip.faceReferences[b].size(); f++)
+            EXPECT_EQ(vector<int>({ strip.finalFaces[b][f]->GetID() }), ReferencedGeometryIds(strip.faceReferences[b][f], model.Part()));
+        for (size_t k = 0; k < strip.edgeReferences[b].size(); k++)
+            EXPECT_EQ(vector<int>({ strip.finalCoEdges[b][k]->GetID() }), ReferencedGeometryIds(strip.edgeReferences[b][k], model.Part()));
+    }
+
+    // The intermediate solid itself gives the faces still in a final body
+    CC5ObjectHandle<CC5Entity> pSolid(model.Part()->GetGroupAt(0)->GetEntityAt(0));
+    vector<int> ids = ReferencedGeometryIds(pSolid.Get(), model.Part());
+    EXPECT_EQ(10u, ids.size());
+    EXPECT_TRUE(m_eventManager.Messages().empty());
+}
+
+TEST_F(CATV5PMIReferencedGeometryTest, PointOnAVertexGivesItsEdges)
+{
+    FakeCC5Model model;
+    FakeCC5StripPart strip(model, 1, 3);
+    CC5Group* pPoints = model.AddGroup(30, CC5_CURVEGROUP_TYPE, false);
+    double vertex[3] = { 1.0, 0.0, 0.0 };
+    CC5Entity* pOnVertex = model.AddPoint(pPoints, 31, CC5_POINTONCURVE_TYPE, vertex);
+    double inFace[3] = { 0.5, 0.5, 0.0 };
+    CC5Entity* pInFace = model.AddPoint(pPoints, 32, CC5_POINT_TYPE, inFace);
+    Translate(model);
+
+    // The bottom edges of the first two faces, and the co-edge between them
+    int edgeBase = FakeCC5StripPart::kFinalEdgeBase;
+    vector<int> ids = ReferencedGeometryIds(pOnVertex, model.Part());
+    sort(ids.begin(), ids.end());
+    EXPECT_EQ(vector<int>({ edgeBase + 1, edgeBase + 4, edgeBase + 5 }), ids);
+
+    EXPECT_EQ(vector<int>({ 32 }), ReferencedGeometryIds(pInFace, model.Part()));
+    EXPECT_EQ(1u, m_eventManager.Messages().size());
+}
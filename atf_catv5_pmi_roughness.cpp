@@ -0,0 +1,188 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_roughness.h"
+#include "atf_catv5_pmi_stats.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ATF_PMI_ROUGHNESS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    // Nearest point by (IsLessThan(d1, d2), IsLessThan(d1, d3), IsLessThan(d2, d3)), from the original chain:
+    // d1 < d2 ? (d1 < d3 ? left : (d2 < d3 ? middle : right)) : (d2 < d3 ? middle : (d1 < d3 ? left : right))
+    const int kNearestOfThree[8] = { 2, 1, 0, 1, 2, 1, 0, 0 };
+
+    // Up to V5R18 only left and right: d1 < d2 ? left : right
+    const int kNearestOfTwo[2] = { 2, 0 };
+
+    // Leader starts and connection points of a batch, one array per coordinate
+    struct LeaderBatch
+    {
+        explicit LeaderBatch(size_t n)
+            : startX(n), startY(n), startZ(n)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                pointX[k].resize(n);
+                pointY[k].resize(n);
+                pointZ[k].resize(n);
+                distance[k].resize(n);
+            }
+        }
+
+        vector<double> startX, startY, startZ;
+        vector<double> pointX[3], pointY[3], pointZ[3];
+        vector<double> distance[3];
+    };
+
+    void ComputeDistances(LeaderBatch& batch, int nPoints)
+    {
+        size_t n = batch.startX.size();
+        for (int k = 0; k < nPoints; k++)
+        {
+            size_t i = 0;
+#ifdef ATF_PMI_ROUGHNESS_SSE2
+            for (; i + 2 <= n; i += 2)
+            {
+                __m128d dx = _mm_sub_pd(_mm_loadu_pd(&batch.pointX[k][i]), _mm_loadu_pd(&batch.startX[i]));
+                __m128d dy = _mm_sub_pd(_mm_loadu_pd(&batch.pointY[k][i]), _mm_loadu_pd(&batch.startY[i]));
+                __m128d dz = _mm_sub_pd(_mm_loadu_pd(&batch.pointZ[k][i]), _mm_loadu_pd(&batch.startZ[i]));
+                __m128d squared = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+                _mm_storeu_pd(&batch.distance[k][i], _mm_sqrt_pd(squared));
+            }
+#endif
+            for (; i < n; i++)
+            {
+                double dx = batch.pointX[k][i] - batch.startX[i];
+                double dy = batch.pointY[k][i] - batch.startY[i];
+                double dz = batch.pointZ[k][i] - batch.startZ[i];
+                batch.distance[k][i] = sqrt(dx * dx + dy * dy + dz * dz);
+            }
+        }
+    }
+}
+
+void CATV5PMIRoughnessLeaders::NearestPoints(const vector<RoughnessLeaderRequest>& requests
+    , bool bVersionHigherThanV5R18
+    , vector<RoughnessLeaderConnection>& connections)
+{
+    ATF_PMI_TIME(kTimer_RoughnessLeaders);
+    connections.assign(requests.size(), RoughnessLeaderConnection());
+
+    // Read the leaders through the reader first; only the resolved ones take part in the computation
+    vector<size_t> resolved;
+    vector<Point3d> starts;
+    resolved.reserve(requests.size());
+    starts.reserve(requests.size());
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        const RoughnessLeaderRequest& request = requests[i];
+        connections[i].bResolved = false;
+        connections[i].nIndexOfNearestPt = 0;
+
+        Point3d leaderStartPt;
+        if (!request.pRoughnessUtilData || !ReadLeaderStart(request.pLeader, *request.pRoughnessUtilData, leaderStartPt))
+            continue;
+
+        resolved.push_back(i);
+        starts.push_back(leaderStartPt);
+    }
+
+    LeaderBatch batch(resolved.size());
+    vector<Point3d> points(resolved.size() * 3);
+    for (size_t j = 0; j < resolved.size(); j++)
+    {
+        const RoughnessLeaderRequest& request = requests[resolved[j]];
+        ConnectionPoints(*request.pRoughnessUtilData, request.bSymbolMode, &points[j * 3]);
+
+        batch.startX[j] = starts[j].x;
+        batch.startY[j] = starts[j].y;
+        batch.startZ[j] = starts[j].z;
+        for (int k = 0; k < 3; k++)
+        {
+            batch.pointX[k][j] = points[j * 3 + k].x;
+            batch.pointY[k][j] = points[j * 3 + k].y;
+            batch.pointZ[k][j] = points[j * 3 + k].z;
+        }
+    }
+
+    // Left and right are points 0 and 2; the middle one only counts after V5R18
+    ComputeDistances(batch, 3);
+
+    for (size_t j = 0; j < resolved.size(); j++)
+    {
+        int nIndex = SelectNearest(batch.distance[0][j], batch.distance[1][j], batch.distance[2][j], bVersionHigherThanV5R18);
+
+        RoughnessLeaderConnection& connection = connections[resolved[j]];
+        connection.bResolved = true;
+        connection.nIndexOfNearestPt = nIndex;
+        connection.nearestPt = points[j * 3 + nIndex];
+    }
+}
+
+bool CATV5PMIRoughnessLeaders::ReadLeaderStart(CC5TPSShape* pCC5Shape, const RoughnessUtilData& roughnessUtilData, Point3d& leaderStartPt)
+{
+    if (!pCC5Shape)
+        return false;
+
+    CC5TPSLeader* pCC5Leader = dynamic_cast<CC5TPSLeader*>(pCC5Shape);
+    if (!pCC5Leader)
+        return false;
+
+    double leaderPos[6];
+    CC5_ERROR err = pCC5Leader->GetTPSLeaderPosition(leaderPos);
+    if (err != CC5_QUERY_SUCCESS)
+        return false;
+
+    double leftZ = roughnessUtilData.leftBottomPosition.z;
+    leaderStartPt = Point3d(leaderPos[0], leaderPos[1], leftZ);
+
+    // break points
+    int nBreakPts = 0;
+    err = pCC5Leader->GetNumberOfBreakPoints(nBreakPts);
+    if (err == CC5_QUERY_SUCCESS && nBreakPts > 0)
+    {
+        double breakPts[2] = { 0.0 };
+
+        err = pCC5Leader->GetBreakPointAt(breakPts, nBreakPts - 1);
+        if (err == CC5_QUERY_SUCCESS)
+            leaderStartPt = Point3d(breakPts[0], breakPts[1], leftZ);
+    }
+    return true;
+}
+
+void CATV5PMIRoughnessLeaders::ConnectionPoints(const RoughnessUtilData& roughnessUtilData, bool bSymbolMode, Point3d points[3])
+{
+    points[0] = roughnessUtilData.leftBottomPosition;
+    points[1] = bSymbolMode ? roughnessUtilData.framePt2 : roughnessUtilData.middleBottomPosition;
+    points[2] = roughnessUtilData.rightBottomPosition;
+}
+
+int CATV5PMIRoughnessLeaders::SelectNearest(double dDis1, double dDis2, double dDis3, bool bVersionHigherThanV5R18)
+{
+    //In lower version of CATIA(upto V5R18), for ANSI and ASME standards, there are only two
+    //possible connection points, positioned in middle - left and middle - right of the roughness frame
+    if (!bVersionHigherThanV5R18)
+        return kNearestOfTwo[MathUtil::IsLessThan(dDis1, dDis3) ? 1 : 0];
+
+    unsigned key = (MathUtil::IsLessThan(dDis1, dDis2) ? 4u : 0u)
+        | (MathUtil::IsLessThan(dDis1, dDis3) ? 2u : 0u)
+        | (MathUtil::IsLessThan(dDis2, dDis3) ? 1u : 0u);
+    return kNearestOfThree[key];
+}
@@ -0,0 +1,57 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include "atf_catv5_pmi_util.h"
+
+#include <vector>
+
+namespace ATF
+{
+    // One leader of a roughness symbol, with the frame of its symbol
+    struct RoughnessLeaderRequest
+    {
+        CC5TPSShape* pLeader;
+        const RoughnessUtilData* pRoughnessUtilData;
+        bool bSymbolMode;
+    };
+
+    // What CATV5PMIUtil::GetNearestPoint gives for the leader.
+    // bResolved is false when the shape is not a leader or its position cannot be read.
+    struct RoughnessLeaderConnection
+    {
+        bool bResolved;
+        Point3d nearestPt;
+        int nIndexOfNearestPt;
+    };
+
+    // Connection points of roughness leaders to their frame.
+    // The leader positions of a whole view are read first, then the distances to the connection points
+    // are computed together, two leaders per SSE2 lane pair, and the nearest point picked without branching.
+    class CATV5PMIRoughnessLeaders
+    {
+    public:
+        // connections[i] receives the nearest point of requests[i], as CATV5PMIUtil::GetNearestPoint would
+        static void NearestPoints(const std::vector<RoughnessLeaderRequest>& requests
+            , bool bVersionHigherThanV5R18
+            , std::vector<RoughnessLeaderConnection>& connections);
+
+        // Start of the leader, i.e. its position or last break point, in the plane of the frame
+        static bool ReadLeaderStart(CC5TPSShape* pCC5Shape, const RoughnessUtilData& roughnessUtilData, Point3d& leaderStartPt);
+
+        // Candidate connection points: left, middle (framePt2 in symbol mode) and right.
+        // Up to V5R18 there is no middle point.
+        static void ConnectionPoints(const RoughnessUtilData& roughnessUtilData, bool bSymbolMode, Point3d points[3]);
+
+        // Index (0, 1 or 2) of the nearest of the connection points at distance dDis1, dDis2 and dDis3.
+        // Ties are resolved with MathUtil::IsLessThan exactly as the original comparison chain did.
+        static int SelectNearest(double dDis1, double dDis2, double dDis3, bool bVersionHigherThanV5R18);
+    };
+}
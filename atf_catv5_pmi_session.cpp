@@ -0,0 +1,62 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_producer_impl.h"
+#include "atf_catv5_pmi_session.h"
+
+#include <atomic>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    thread_local CATV5PMISession* t_pSession = nullptr;
+
+    uint64_t NextSessionId()
+    {
+        static atomic<uint64_t> s_nextId(1);
+        return s_nextId++;
+    }
+}
+
+CATV5PMISession::CATV5PMISession()
+    : m_pEventManager(CATV5ProducerImpl::Get()->GetEventManager())
+    , m_id(NextSessionId())
+{
+    for (auto e : CATV5ProducerImpl::Get()->TranslatableGroups())
+        m_translatableGroups.push_back(e);
+}
+
+CATV5PMISession::CATV5PMISession(const FINALBODYLIST& translatableGroups, const EventManager* pEventManager)
+    : m_translatableGroups(translatableGroups)
+    , m_pEventManager(pEventManager)
+    , m_id(NextSessionId())
+{}
+
+CATV5PMISession::~CATV5PMISession()
+{}
+
+CATV5PMISession* CATV5PMISession::Current()
+{
+    return t_pSession;
+}
+
+CATV5PMISessionScope::CATV5PMISessionScope(CATV5PMISession* pSession)
+    : m_pPreviousSession(t_pSession)
+{
+    t_pSession = pSession;
+}
+
+CATV5PMISessionScope::~CATV5PMISessionScope()
+{
+    t_pSession = m_pPreviousSession;
+}
@@ -0,0 +1,90 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include "atf_catv5_pmi_util.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace ATF
+{
+    // State of one PMI translation: the translatable groups and event manager of the conversion, and the
+    // part contexts, annotation descriptors and drafting standards cached while translating it.
+    // Conversions running side by side in one process each use their own session, entered on the
+    // threads working for them with CATV5PMISessionScope. A thread outside of any scope has no session;
+    // see CATV5PMITranslation for the sessions opened by the producer and the PMI entry points.
+    //
+    // The session must outlive the translation: its part contexts keep the groups of the conversion.
+    class CATV5PMISession
+    {
+    public:
+        // Per-session state of the PMI modules, each defined privately by its module
+        enum Slot
+        {
+            kSlot_PartContexts,
+            kSlot_AnnotationDescriptors,
+            kSlot_DrawStandards,
+            kSlot_Count
+        };
+
+        // Session of the part the producer is translating: its groups and event manager are read
+        // from CATV5ProducerImpl once, when the session is created
+        CATV5PMISession();
+        CATV5PMISession(const FINALBODYLIST& translatableGroups, const EventManager* pEventManager);
+        ~CATV5PMISession();
+
+        // The session of the calling thread, null outside of any CATV5PMISessionScope
+        static CATV5PMISession* Current();
+
+        const FINALBODYLIST& TranslatableGroups() const { return m_translatableGroups; }
+        const EventManager* GetEventManager() const { return m_pEventManager; }
+
+        // Never reused, unlike the address of a destroyed session; keys the per-thread caches of the modules
+        uint64_t GetId() const { return m_id; }
+
+        // State of the slot, created on first use. A slot must always be asked with the same T.
+        template <class T>
+        T& State(Slot slot)
+        {
+            std::call_once(m_slotOnce[slot], [this, slot]()
+            {
+                m_slots[slot] = std::make_shared<T>();
+            });
+            return *static_cast<T*>(m_slots[slot].get());
+        }
+
+    private:
+        CATV5PMISession(const CATV5PMISession&) = delete;
+        CATV5PMISession& operator=(const CATV5PMISession&) = delete;
+
+        FINALBODYLIST m_translatableGroups;
+        const EventManager* m_pEventManager;
+        uint64_t m_id;
+
+        std::once_flag m_slotOnce[kSlot_Count];
+        std::shared_ptr<void> m_slots[kSlot_Count];
+    };
+
+    // Makes pSession the session of the calling thread until the end of the scope
+    class CATV5PMISessionScope
+    {
+    public:
+        explicit CATV5PMISessionScope(CATV5PMISession* pSession);
+        ~CATV5PMISessionScope();
+
+    private:
+        CATV5PMISessionScope(const CATV5PMISessionScope&) = delete;
+        CATV5PMISessionScope& operator=(const CATV5PMISessionScope&) = delete;
+
+        CATV5PMISession* m_pPreviousSession;
+    };
+}
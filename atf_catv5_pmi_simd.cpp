@@ -0,0 +1,247 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_simd.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ATF_PMI_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(ATF_PMI_SIMD_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define ATF_PMI_SIMD_SSE2 1
+#endif
+
+// MSVC accepts AVX2 intrinsics in any function; GCC and Clang need them enabled per function
+#if defined(ATF_PMI_SIMD_X86) && defined(_MSC_VER)
+#define ATF_PMI_SIMD_AVX2 1
+#define ATF_PMI_TARGET_AVX2
+#elif defined(ATF_PMI_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define ATF_PMI_SIMD_AVX2 1
+#define ATF_PMI_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    typedef bool (*GROUPSEQUALFUNC)(const int*, const int*, uint32_t);
+    typedef bool (*FINDGROUPFUNC)(const int*, uint32_t, const int*, const uint32_t*, uint32_t);
+
+    bool GroupsEqualScalar(const int* group1, const int* group2, uint32_t size)
+    {
+        for (uint32_t i = 0; i < size; i++)
+        {
+            if (group1[i] != group2[i])
+                return false;
+        }
+        return true;
+    }
+
+    bool FindGroupScalar(const int* group, uint32_t groupSize, const int* ids, const uint32_t* groupOffsets, uint32_t nGroups)
+    {
+        for (uint32_t iGroup = 0; iGroup < nGroups; iGroup++)
+        {
+            if (groupOffsets[iGroup + 1] - groupOffsets[iGroup] == groupSize
+                && GroupsEqualScalar(group, ids + groupOffsets[iGroup], groupSize))
+                return true;
+        }
+        return false;
+    }
+
+    // An empty group only matches an empty group, which the size test alone decides
+    bool FindEmptyGroup(const uint32_t* groupOffsets, uint32_t nGroups)
+    {
+        for (uint32_t iGroup = 0; iGroup < nGroups; iGroup++)
+        {
+            if (groupOffsets[iGroup + 1] == groupOffsets[iGroup])
+                return true;
+        }
+        return false;
+    }
+
+#ifdef ATF_PMI_SIMD_SSE2
+    bool GroupsEqualSSE2(const int* group1, const int* group2, uint32_t size)
+    {
+        uint32_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group1 + i));
+            __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group2 + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(v1, v2)) != 0xFFFF)
+                return false;
+        }
+        return GroupsEqualScalar(group1 + i, group2 + i, size - i);
+    }
+
+    // Sizes of four candidate groups are checked at once from the consecutive offsets,
+    // then the first ints of the candidates of the right size before the full comparison.
+    bool FindGroupSSE2(const int* group, uint32_t groupSize, const int* ids, const uint32_t* groupOffsets, uint32_t nGroups)
+    {
+        if (groupSize == 0)
+            return FindEmptyGroup(groupOffsets, nGroups);
+
+        __m128i vSize = _mm_set1_epi32(static_cast<int>(groupSize));
+        uint32_t iGroup = 0;
+        for (; iGroup + 4 <= nGroups; iGroup += 4)
+        {
+            __m128i vBegin = _mm_loadu_si128(reinterpret_cast<const __m128i*>(groupOffsets + iGroup));
+            __m128i vEnd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(groupOffsets + iGroup + 1));
+            int sizeMask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_sub_epi32(vEnd, vBegin), vSize)));
+            while (sizeMask)
+            {
+                int iLane = 0;
+                while (!(sizeMask & (1 << iLane)))
+                    iLane++;
+                sizeMask &= ~(1 << iLane);
+
+                const int* candidate = ids + groupOffsets[iGroup + iLane];
+                if (candidate[0] == group[0] && GroupsEqualSSE2(group, candidate, groupSize))
+                    return true;
+            }
+        }
+        return FindGroupScalar(group, groupSize, ids, groupOffsets + iGroup, nGroups - iGroup);
+    }
+#endif
+
+#ifdef ATF_PMI_SIMD_AVX2
+    ATF_PMI_TARGET_AVX2 bool GroupsEqualAVX2(const int* group1, const int* group2, uint32_t size)
+    {
+        uint32_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(group1 + i));
+            __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(group2 + i));
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(v1, v2)) != -1)
+                return false;
+        }
+        if (i + 4 <= size)
+        {
+            __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group1 + i));
+            __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group2 + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(v1, v2)) != 0xFFFF)
+                return false;
+            i += 4;
+        }
+        return GroupsEqualScalar(group1 + i, group2 + i, size - i);
+    }
+
+    // Eight candidate groups at once: sizes from the consecutive offsets, and first ints gathered
+    // for the candidates of the right size only, so that no offset past the id pool is read.
+    ATF_PMI_TARGET_AVX2 bool FindGroupAVX2(const int* group, uint32_t groupSize, const int* ids, const uint32_t* groupOffsets, uint32_t nGroups)
+    {
+        if (groupSize == 0)
+            return FindEmptyGroup(groupOffsets, nGroups);
+
+        __m256i vSize = _mm256_set1_epi32(static_cast<int>(groupSize));
+        __m256i vFirst = _mm256_set1_epi32(group[0]);
+        uint32_t iGroup = 0;
+        for (; iGroup + 8 <= nGroups; iGroup += 8)
+        {
+            __m256i vBegin = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(groupOffsets + iGroup));
+            __m256i vEnd = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(groupOffsets + iGroup + 1));
+            __m256i vSizeMatch = _mm256_cmpeq_epi32(_mm256_sub_epi32(vEnd, vBegin), vSize);
+            if (_mm256_testz_si256(vSizeMatch, vSizeMatch))
+                continue;
+
+            __m256i vCandidateFirst = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), ids, vBegin, vSizeMatch, 4);
+            __m256i vMatch = _mm256_and_si256(vSizeMatch, _mm256_cmpeq_epi32(vCandidateFirst, vFirst));
+            int matchMask = _mm256_movemask_ps(_mm256_castsi256_ps(vMatch));
+            while (matchMask)
+            {
+                int iLane = 0;
+                while (!(matchMask & (1 << iLane)))
+                    iLane++;
+                matchMask &= ~(1 << iLane);
+
+                if (GroupsEqualAVX2(group, ids + groupOffsets[iGroup + iLane], groupSize))
+                    return true;
+            }
+        }
+        return FindGroupScalar(group, groupSize, ids, groupOffsets + iGroup, nGroups - iGroup);
+    }
+#endif
+
+    bool CPUSupportsAVX2()
+    {
+#if defined(ATF_PMI_SIMD_AVX2) && defined(_MSC_VER)
+        int regs[4] = {};
+        __cpuid(regs, 0);
+        if (regs[0] < 7)
+            return false;
+
+        // The OS must also save the AVX registers
+        __cpuid(regs, 1);
+        bool bOSXSave = (regs[2] & (1 << 27)) != 0;
+        if (!bOSXSave || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+
+        __cpuidex(regs, 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+#elif defined(ATF_PMI_SIMD_AVX2)
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+#else
+        return false;
+#endif
+    }
+
+    struct KernelTable
+    {
+        CATV5PMIPersistentIDKernel::Level level;
+        GROUPSEQUALFUNC groupsEqual;
+        FINDGROUPFUNC findGroup;
+    };
+
+    KernelTable SelectKernels()
+    {
+        KernelTable table = { CATV5PMIPersistentIDKernel::kScalar, &GroupsEqualScalar, &FindGroupScalar };
+#ifdef ATF_PMI_SIMD_SSE2
+        table.level = CATV5PMIPersistentIDKernel::kSSE2;
+        table.groupsEqual = &GroupsEqualSSE2;
+        table.findGroup = &FindGroupSSE2;
+#endif
+#ifdef ATF_PMI_SIMD_AVX2
+        if (CPUSupportsAVX2())
+        {
+            table.level = CATV5PMIPersistentIDKernel::kAVX2;
+            table.groupsEqual = &GroupsEqualAVX2;
+            table.findGroup = &FindGroupAVX2;
+        }
+#endif
+        return table;
+    }
+
+    const KernelTable& Kernels()
+    {
+        static const KernelTable table = SelectKernels();
+        return table;
+    }
+}
+
+CATV5PMIPersistentIDKernel::Level CATV5PMIPersistentIDKernel::ActiveLevel()
+{
+    return Kernels().level;
+}
+
+bool CATV5PMIPersistentIDKernel::GroupsEqual(const int* group1, const int* group2, uint32_t size)
+{
+    return Kernels().groupsEqual(group1, group2, size);
+}
+
+bool CATV5PMIPersistentIDKernel::FindGroup(const int* group, uint32_t groupSize, const int* ids, const uint32_t* groupOffsets, uint32_t nGroups)
+{
+    return Kernels().findGroup(group, groupSize, ids, groupOffsets, nGroups);
+}
@@ -0,0 +1,37 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace ATF
+{
+    // Comparison of persistent-ID groups (int lists), with AVX2, SSE2 and scalar implementations.
+    // The implementation is chosen once, from the instruction sets supported by the running CPU.
+    class CATV5PMIPersistentIDKernel
+    {
+    public:
+        enum Level
+        {
+            kScalar,
+            kSSE2,
+            kAVX2
+        };
+
+        static Level ActiveLevel();
+
+        // Returns true if the lists group1 and group2, both of size ids, are identical
+        static bool GroupsEqual(const int* group1, const int* group2, uint32_t size);
+
+        // Returns true if group is identical to one of the nGroups groups stored flat in ids,
+        // group g being ids[groupOffsets[g], groupOffsets[g + 1]).
+        static bool FindGroup(const int* group, uint32_t groupSize, const int* ids, const uint32_t* groupOffsets, uint32_t nGroups);
+    };
+}
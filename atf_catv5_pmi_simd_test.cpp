@@ -0,0 +1,105 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_simd.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    bool ReferenceFindGroup(const vector<int>& group, const vector<int>& ids, const vector<uint32_t>& groupOffsets)
+    {
+        for (size_t g = 0; g + 1 < groupOffsets.size(); g++)
+        {
+            if (groupOffsets[g + 1] - groupOffsets[g] == group.size()
+                && equal(group.begin(), group.end(), ids.begin() + groupOffsets[g]))
+                return true;
+        }
+        return false;
+    }
+}
+
+TEST(CATV5PMIPersistentIDKernel, ActiveLevelIsStable)
+{
+    CATV5PMIPersistentIDKernel::Level level = CATV5PMIPersistentIDKernel::ActiveLevel();
+    EXPECT_EQ(level, CATV5PMIPersistentIDKernel::ActiveLevel());
+}
+
+// Every size around the 4- and 8-int vector widths, with the difference at every position
+TEST(CATV5PMIPersistentIDKernel, GroupsEqualAtEverySizeAndPosition)
+{
+    for (uint32_t size = 0; size <= 40; size++)
+    {
+        vector<int> group1(size);
+        for (uint32_t i = 0; i < size; i++)
+            group1[i] = static_cast<int>(i * 2654435761u);
+        vector<int> group2 = group1;
+        EXPECT_TRUE(CATV5PMIPersistentIDKernel::GroupsEqual(group1.data(), group2.data(), size)) << size;
+
+        for (uint32_t i = 0; i < size; i++)
+        {
+            group2[i] ^= 1 << (i % 31);
+            EXPECT_FALSE(CATV5PMIPersistentIDKernel::GroupsEqual(group1.data(), group2.data(), size)) << size << " " << i;
+            group2[i] = group1[i];
+        }
+    }
+}
+
+// Unaligned lists, as the groups stored flat in a snapshot are
+TEST(CATV5PMIPersistentIDKernel, GroupsEqualUnaligned)
+{
+    vector<int> storage(64);
+    for (size_t i = 0; i < storage.size(); i++)
+        storage[i] = static_cast<int>(i % 5);
+    for (uint32_t offset = 0; offset < 8; offset++)
+    {
+        EXPECT_TRUE(CATV5PMIPersistentIDKernel::GroupsEqual(storage.data() + offset, storage.data() + offset + 5, 20)) << offset;
+        EXPECT_FALSE(CATV5PMIPersistentIDKernel::GroupsEqual(storage.data() + offset, storage.data() + offset + 1, 20)) << offset;
+    }
+}
+
+TEST(CATV5PMIPersistentIDKernel, FindGroupMatchesTheReference)
+{
+    mt19937 random(3);
+    for (int iCase = 0; iCase < 2000; iCase++)
+    {
+        // Few distinct values, so that lists often share a prefix or the whole content
+        uint32_t nGroups = random() % 6;
+        vector<int> ids;
+        vector<uint32_t> groupOffsets(1, 0);
+        for (uint32_t g = 0; g < nGroups; g++)
+        {
+            uint32_t size = random() % 12;
+            for (uint32_t i = 0; i < size; i++)
+                ids.push_back(static_cast<int>(random() % 3));
+            groupOffsets.push_back(static_cast<uint32_t>(ids.size()));
+        }
+
+        vector<int> group(random() % 12);
+        for (int& id : group)
+            id = static_cast<int>(random() % 3);
+        if (nGroups && random() % 2)
+        {
+            uint32_t g = random() % nGroups;
+            group.assign(ids.begin() + groupOffsets[g], ids.begin() + groupOffsets[g + 1]);
+        }
+
+        EXPECT_EQ(ReferenceFindGroup(group, ids, groupOffsets),
+            CATV5PMIPersistentIDKernel::FindGroup(group.data(), static_cast<uint32_t>(group.size()), ids.data(), groupOffsets.data(), nGroups)) << iCase;
+    }
+}
@@ -0,0 +1,184 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_stats.h"
+
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+using namespace ATF;
+using namespace std;
+
+thread_local CATV5PMIStatsBlock* ATF::t_pPMIStatsBlock = nullptr;
+
+namespace
+{
+    typedef pair<CC5Part*, thread::id> BLOCKKEY;
+    typedef map<BLOCKKEY, shared_ptr<CATV5PMIStatsBlock>> BLOCKMAP;
+
+    mutex& StatsMutex()
+    {
+        static mutex s_mutex;
+        return s_mutex;
+    }
+
+    BLOCKMAP& BlockMap()
+    {
+        static BLOCKMAP s_blockMap;
+        return s_blockMap;
+    }
+
+    // Changed by Release, to invalidate the per-thread entries
+    atomic<uint64_t>& Generation()
+    {
+        static atomic<uint64_t> s_generation(1);
+        return s_generation;
+    }
+
+    // Last block used by the thread, the builders of a part running back to back
+    thread_local CC5Part* t_pLastPart = nullptr;
+    thread_local uint64_t t_lastGeneration = 0;
+    thread_local shared_ptr<CATV5PMIStatsBlock> t_pLastBlock;
+    thread_local shared_ptr<CATV5PMIStatsBlock> t_pDefaultBlock;
+    thread_local uint64_t t_defaultGeneration = 0;
+
+    shared_ptr<CATV5PMIStatsBlock> ThreadBlock(CC5Part* pPart)
+    {
+        uint64_t generation = Generation().load();
+        if (t_pLastBlock && t_pLastPart == pPart && t_lastGeneration == generation)
+            return t_pLastBlock;
+
+        shared_ptr<CATV5PMIStatsBlock> pBlock;
+        {
+            lock_guard<mutex> lock(StatsMutex());
+            shared_ptr<CATV5PMIStatsBlock>& pEntry = BlockMap()[BLOCKKEY(pPart, this_thread::get_id())];
+            if (!pEntry)
+                pEntry = make_shared<CATV5PMIStatsBlock>();
+            pBlock = pEntry;
+        }
+
+        t_pLastPart = pPart;
+        t_lastGeneration = generation;
+        t_pLastBlock = pBlock;
+        return pBlock;
+    }
+
+    const char* const kCounterNames[CATV5PMIStats::kCounter_Count] =
+    {
+        "faces_visited",
+        "loops_visited",
+        "edges_visited",
+        "persistent_id_comparisons",
+        "final_owner_hits",
+        "final_owner_misses",
+        "final_owner_filter_rejects",
+        "annotation_cache_hits",
+        "annotation_cache_misses",
+        "draw_standard_cache_hits",
+        "draw_standard_cache_misses",
+        "entity_id_fallbacks",
+        "vertex_snap_hits",
+        "vertex_snap_misses"
+    };
+
+    const char* const kTimerNames[CATV5PMIStats::kTimer_Count] =
+    {
+        "referenced_geometry_ids",
+        "face_search",
+        "edge_search",
+        "part_index_build",
+        "intermediate_solid_walk",
+        "roughness_leaders"
+    };
+}
+
+CATV5PMIStatsBlock::CATV5PMIStatsBlock()
+{
+    for (atomic<uint64_t>& counter : counters)
+        counter.store(0);
+    for (int i = 0; i < CATV5PMIStats::kTimer_Count; i++)
+    {
+        timerCalls[i].store(0);
+        timerNanoseconds[i].store(0);
+    }
+}
+
+CATV5PMIStatsBlock* CATV5PMIStats::DefaultBlock()
+{
+    uint64_t generation = Generation().load();
+    if (!t_pDefaultBlock || t_defaultGeneration != generation)
+    {
+        t_pDefaultBlock = ThreadBlock(nullptr);
+        t_defaultGeneration = generation;
+    }
+    t_pPMIStatsBlock = t_pDefaultBlock.get();
+    return t_pPMIStatsBlock;
+}
+
+string CATV5PMIStats::SummaryJson(CC5Part* pPart)
+{
+    uint64_t counters[kCounter_Count] = {};
+    uint64_t timerCalls[kTimer_Count] = {};
+    uint64_t timerNanoseconds[kTimer_Count] = {};
+    size_t nThreads = 0;
+    {
+        lock_guard<mutex> lock(StatsMutex());
+        auto itr = BlockMap().lower_bound(BLOCKKEY(pPart, thread::id()));
+        for (; itr != BlockMap().end() && itr->first.first == pPart; ++itr)
+        {
+            const CATV5PMIStatsBlock& block = *itr->second;
+            for (int i = 0; i < kCounter_Count; i++)
+                counters[i] += block.counters[i].load(memory_order_relaxed);
+            for (int i = 0; i < kTimer_Count; i++)
+            {
+                timerCalls[i] += block.timerCalls[i].load(memory_order_relaxed);
+                timerNanoseconds[i] += block.timerNanoseconds[i].load(memory_order_relaxed);
+            }
+            nThreads++;
+        }
+    }
+
+    ostringstream json;
+    json << "{\"threads\":" << nThreads << ",\"counters\":{";
+    for (int i = 0; i < kCounter_Count; i++)
+        json << (i ? "," : "") << "\"" << kCounterNames[i] << "\":" << counters[i];
+    json << "},\"timers\":{";
+    for (int i = 0; i < kTimer_Count; i++)
+    {
+        json << (i ? "," : "") << "\"" << kTimerNames[i] << "\":{\"calls\":" << timerCalls[i]
+            << ",\"total_us\":" << timerNanoseconds[i] / 1000 << "}";
+    }
+    json << "}}";
+    return json.str();
+}
+
+void CATV5PMIStats::Release(CC5Part* pPart)
+{
+    lock_guard<mutex> lock(StatsMutex());
+    auto itr = BlockMap().lower_bound(BLOCKKEY(pPart, thread::id()));
+    while (itr != BlockMap().end() && itr->first.first == pPart)
+        itr = BlockMap().erase(itr);
+    Generation()++;
+}
+
+CATV5PMIStatsPartScope::CATV5PMIStatsPartScope(CC5Part* pPart)
+    : m_pBlock(ThreadBlock(pPart))
+    , m_pPreviousBlock(t_pPMIStatsBlock)
+{
+    t_pPMIStatsBlock = m_pBlock.get();
+}
+
+CATV5PMIStatsPartScope::~CATV5PMIStatsPartScope()
+{
+    t_pPMIStatsBlock = m_pPreviousBlock;
+}
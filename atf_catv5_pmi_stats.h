@@ -0,0 +1,154 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include "atf_catv5_pmi_util.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Instrumentation of the PMI association. Define ATF_PMI_RELEASE_LITE to compile it out:
+// the macros below then expand to nothing.
+//
+//   ATF_PMI_STATS_PART(pPart)      attributes what the thread counts until the end of the scope to pPart
+//   ATF_PMI_COUNT(kCounter_X, n)   adds n to a counter
+//   ATF_PMI_TIME(kTimer_X)         adds the wall time of the scope, and one call, to a timer
+#ifndef ATF_PMI_RELEASE_LITE
+#define ATF_PMI_STATS_CONCAT_(a, b) a##b
+#define ATF_PMI_STATS_CONCAT(a, b) ATF_PMI_STATS_CONCAT_(a, b)
+#define ATF_PMI_STATS_PART(pPart) ::ATF::CATV5PMIStatsPartScope ATF_PMI_STATS_CONCAT(atfPmiStatsPart, __LINE__)(pPart)
+#define ATF_PMI_COUNT(counter, n) ::ATF::CATV5PMIStats::Add(::ATF::CATV5PMIStats::counter, n)
+#define ATF_PMI_TIME(timer) ::ATF::CATV5PMIStatsTimer ATF_PMI_STATS_CONCAT(atfPmiStatsTimer, __LINE__)(::ATF::CATV5PMIStats::timer)
+#else
+#define ATF_PMI_STATS_PART(pPart) ((void)0)
+#define ATF_PMI_COUNT(counter, n) ((void)0)
+#define ATF_PMI_TIME(timer) ((void)0)
+#endif
+
+namespace ATF
+{
+    struct CATV5PMIStatsBlock;
+
+    // Counters of one thread for one part. Only the owning thread writes them, so relaxed
+    // load/store pairs are enough; the summary reads them from any thread.
+    extern thread_local CATV5PMIStatsBlock* t_pPMIStatsBlock;
+
+    class CATV5PMIStats
+    {
+    public:
+        enum Counter
+        {
+            kCounter_FacesVisited,
+            kCounter_LoopsVisited,
+            kCounter_EdgesVisited,
+            kCounter_PersistentIDComparisons,
+            kCounter_FinalOwnerHits,
+            kCounter_FinalOwnerMisses,
+            kCounter_FinalOwnerFilterRejects,
+            kCounter_AnnotationCacheHits,
+            kCounter_AnnotationCacheMisses,
+            kCounter_DrawStandardCacheHits,
+            kCounter_DrawStandardCacheMisses,
+            kCounter_EntityIdFallbacks,
+            kCounter_VertexSnapHits,
+            kCounter_VertexSnapMisses,
+            kCounter_Count
+        };
+
+        enum Timer
+        {
+            kTimer_ReferencedGeometryIds,
+            kTimer_FaceSearch,
+            kTimer_EdgeSearch,
+            kTimer_PartIndexBuild,
+            kTimer_IntermediateSolidWalk,
+            kTimer_RoughnessLeaders,
+            kTimer_Count
+        };
+
+        static void Add(Counter counter, uint64_t n);
+        static void AddTime(Timer timer, uint64_t nanoseconds);
+
+        // Counters of the thread outside of any part scope, attached on first use
+        static CATV5PMIStatsBlock* DefaultBlock();
+
+        // Counters and timers of the part summed over all threads, as a JSON object.
+        // Work done outside of any part scope is reported for a null part.
+        static std::string SummaryJson(CC5Part* pPart);
+
+        // Drops the counters of the part, once its summary has been written
+        static void Release(CC5Part* pPart);
+    };
+
+    struct CATV5PMIStatsBlock
+    {
+        CATV5PMIStatsBlock();
+
+        std::atomic<uint64_t> counters[CATV5PMIStats::kCounter_Count];
+        std::atomic<uint64_t> timerCalls[CATV5PMIStats::kTimer_Count];
+        std::atomic<uint64_t> timerNanoseconds[CATV5PMIStats::kTimer_Count];
+    };
+
+    inline void CATV5PMIStats::Add(Counter counter, uint64_t n)
+    {
+        CATV5PMIStatsBlock* pBlock = t_pPMIStatsBlock ? t_pPMIStatsBlock : DefaultBlock();
+        std::atomic<uint64_t>& value = pBlock->counters[counter];
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    inline void CATV5PMIStats::AddTime(Timer timer, uint64_t nanoseconds)
+    {
+        CATV5PMIStatsBlock* pBlock = t_pPMIStatsBlock ? t_pPMIStatsBlock : DefaultBlock();
+        std::atomic<uint64_t>& calls = pBlock->timerCalls[timer];
+        calls.store(calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic<uint64_t>& total = pBlock->timerNanoseconds[timer];
+        total.store(total.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+    }
+
+    // Switches the thread's counters to those of pPart, and back at the end of the scope
+    class CATV5PMIStatsPartScope
+    {
+    public:
+        explicit CATV5PMIStatsPartScope(CC5Part* pPart);
+        ~CATV5PMIStatsPartScope();
+
+    private:
+        CATV5PMIStatsPartScope(const CATV5PMIStatsPartScope&) = delete;
+        CATV5PMIStatsPartScope& operator=(const CATV5PMIStatsPartScope&) = delete;
+
+        std::shared_ptr<CATV5PMIStatsBlock> m_pBlock;
+        CATV5PMIStatsBlock* m_pPreviousBlock;
+    };
+
+    class CATV5PMIStatsTimer
+    {
+    public:
+        explicit CATV5PMIStatsTimer(CATV5PMIStats::Timer timer)
+            : m_timer(timer)
+            , m_start(std::chrono::steady_clock::now())
+        {}
+
+        ~CATV5PMIStatsTimer()
+        {
+            std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - m_start;
+            CATV5PMIStats::AddTime(m_timer, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+
+    private:
+        CATV5PMIStatsTimer(const CATV5PMIStatsTimer&) = delete;
+        CATV5PMIStatsTimer& operator=(const CATV5PMIStatsTimer&) = delete;
+
+        CATV5PMIStats::Timer m_timer;
+        std::chrono::steady_clock::time_point m_start;
+    };
+}
@@ -0,0 +1,241 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_thread_pool.h"
+
+#include <algorithm>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    // Pool whose tasks the thread is running, to catch a nested ParallelFor
+    thread_local const CATV5PMIWorkStealingPool* t_pRunningPool = nullptr;
+}
+
+CATV5PMIWorkStealingPool::CATV5PMIWorkStealingPool(unsigned nThreads)
+    : m_nQueuedRanges(0)
+    , m_nIdleWorkers(0)
+    , m_generation(0)
+    , m_nActiveWorkers(0)
+    , m_bStop(false)
+    , m_pTask(nullptr)
+    , m_grainSize(1)
+    , m_nRemaining(0)
+{
+    if (nThreads == 0)
+        nThreads = max(1u, thread::hardware_concurrency());
+
+    for (unsigned i = 0; i < nThreads; i++)
+        m_queues.emplace_back(new WorkerQueue);
+
+    // Worker 0 is the thread calling ParallelFor
+    for (unsigned i = 1; i < nThreads; i++)
+        m_threads.emplace_back(&CATV5PMIWorkStealingPool::WorkerMain, this, i);
+}
+
+CATV5PMIWorkStealingPool::~CATV5PMIWorkStealingPool()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_bStop = true;
+    }
+    m_wakeUp.notify_all();
+
+    for (thread& worker : m_threads)
+        worker.join();
+}
+
+void CATV5PMIWorkStealingPool::ParallelFor(size_t nTasks, const function<void(size_t)>& task)
+{
+    if (nTasks == 0)
+        return;
+
+    if (t_pRunningPool == this)
+        ATF_WARNING_ASSERT(0 && "Nested CATV5PMIWorkStealingPool::ParallelFor, run on the calling thread");
+
+    unsigned nThreads = GetThreadCount();
+    if (nThreads == 1 || nTasks == 1 || t_pRunningPool == this)
+    {
+        for (size_t i = 0; i < nTasks; i++)
+            task(i);
+        return;
+    }
+
+    lock_guard<mutex> callLock(m_callMutex);
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_pTask = &task;
+        m_pError = nullptr;
+        m_grainSize = max<size_t>(1, nTasks / (nThreads * 32));
+        m_nRemaining = nTasks;
+
+        // Each worker starts on its own contiguous share, and steals once it is done
+        size_t share = (nTasks + nThreads - 1) / nThreads;
+        for (unsigned i = 0; i < nThreads; i++)
+        {
+            Range range = { min(nTasks, i * share), min(nTasks, (i + 1) * share) };
+            if (range.begin < range.end)
+            {
+                m_queues[i]->ranges.push_back(range);
+                ++m_nQueuedRanges;
+            }
+        }
+
+        m_nActiveWorkers = nThreads - 1;
+        ++m_generation;
+    }
+    m_wakeUp.notify_all();
+
+    RunWorker(0);
+
+    unique_lock<mutex> lock(m_mutex);
+    m_allDone.wait(lock, [this]() { return m_nActiveWorkers == 0; });
+    m_pTask = nullptr;
+
+    if (m_pError)
+    {
+        exception_ptr pError = m_pError;
+        m_pError = nullptr;
+        rethrow_exception(pError);
+    }
+}
+
+void CATV5PMIWorkStealingPool::WorkerMain(unsigned iWorker)
+{
+    size_t lastGeneration = 0;
+    for (;;)
+    {
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [&]() { return m_bStop || m_generation != lastGeneration; });
+            if (m_bStop)
+                return;
+            lastGeneration = m_generation;
+        }
+
+        RunWorker(iWorker);
+
+        {
+            lock_guard<mutex> lock(m_mutex);
+            --m_nActiveWorkers;
+        }
+        m_allDone.notify_one();
+    }
+}
+
+void CATV5PMIWorkStealingPool::RunWorker(unsigned iWorker)
+{
+    const CATV5PMIWorkStealingPool* pOuterPool = t_pRunningPool;
+    t_pRunningPool = this;
+
+    // Ranges are split while they run, so work can show up again until every task is done
+    while (m_nRemaining.load() > 0)
+    {
+        Range range;
+        if (PopLocal(iWorker, range) || Steal(iWorker, range))
+        {
+            Execute(iWorker, range);
+            continue;
+        }
+
+        // Registered as idle before checking, so that PushRange either sees it or the range is seen here
+        unique_lock<mutex> lock(m_mutex);
+        ++m_nIdleWorkers;
+        m_workQueued.wait(lock, [this]() { return m_nRemaining.load() == 0 || m_nQueuedRanges.load() > 0; });
+        --m_nIdleWorkers;
+    }
+
+    t_pRunningPool = pOuterPool;
+}
+
+void CATV5PMIWorkStealingPool::PushRange(unsigned iWorker, Range range)
+{
+    {
+        WorkerQueue& queue = *m_queues[iWorker];
+        lock_guard<mutex> lock(queue.mutex);
+        queue.ranges.push_back(range);
+    }
+    ++m_nQueuedRanges;
+
+    if (m_nIdleWorkers.load() > 0)
+    {
+        // Taken so that the notification cannot fall between the check and the wait of an idle worker
+        { lock_guard<mutex> lock(m_mutex); }
+        m_workQueued.notify_one();
+    }
+}
+
+// The owner works at the back of its queue, on the most recently split (smallest) range
+bool CATV5PMIWorkStealingPool::PopLocal(unsigned iWorker, Range& range)
+{
+    WorkerQueue& queue = *m_queues[iWorker];
+    lock_guard<mutex> lock(queue.mutex);
+    if (queue.ranges.empty())
+        return false;
+
+    range = queue.ranges.back();
+    queue.ranges.pop_back();
+    --m_nQueuedRanges;
+    return true;
+}
+
+// Thieves take from the front of the other queues, where the largest ranges are
+bool CATV5PMIWorkStealingPool::Steal(unsigned iWorker, Range& range)
+{
+    unsigned nThreads = GetThreadCount();
+    for (unsigned i = 1; i < nThreads; i++)
+    {
+        WorkerQueue& queue = *m_queues[(iWorker + i) % nThreads];
+        lock_guard<mutex> lock(queue.mutex);
+        if (queue.ranges.empty())
+            continue;
+
+        range = queue.ranges.front();
+        queue.ranges.pop_front();
+        --m_nQueuedRanges;
+        return true;
+    }
+    return false;
+}
+
+void CATV5PMIWorkStealingPool::Execute(unsigned iWorker, Range range)
+{
+    while (range.end - range.begin > m_grainSize)
+    {
+        size_t middle = range.begin + (range.end - range.begin) / 2;
+        Range upper = { middle, range.end };
+        PushRange(iWorker, upper);
+        range.end = middle;
+    }
+
+    for (size_t i = range.begin; i < range.end; i++)
+    {
+        try
+        {
+            (*m_pTask)(i);
+        }
+        catch (...)
+        {
+            lock_guard<mutex> lock(m_mutex);
+            if (!m_pError)
+                m_pError = current_exception();
+        }
+    }
+    size_t nDone = range.end - range.begin;
+    if (m_nRemaining.fetch_sub(nDone) == nDone)
+    {
+        // Last range of the loop: the idle workers go back to waiting for the next one
+        { lock_guard<mutex> lock(m_mutex); }
+        m_workQueued.notify_all();
+    }
+}
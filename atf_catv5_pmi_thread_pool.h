@@ -0,0 +1,89 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ATF
+{
+    // Fixed set of worker threads running index ranges with work stealing.
+    // Each worker splits its range in halves, keeps working on the lower half and leaves the upper half
+    // in its own queue, where idle workers steal it from. Uneven task costs (a few annotations on
+    // huge faces among many cheap ones) are therefore balanced without a central queue.
+    // Workers with nothing to run or steal sleep until a range is queued or the loop is done.
+    class CATV5PMIWorkStealingPool
+    {
+    public:
+        // nThreads counts the calling thread; 0 uses one thread per hardware core.
+        explicit CATV5PMIWorkStealingPool(unsigned nThreads = 0);
+        ~CATV5PMIWorkStealingPool();
+
+        unsigned GetThreadCount() const { return static_cast<unsigned>(m_queues.size()); }
+
+        // Runs task(i) for every i in [0, nTasks) and returns once all of them ran.
+        // The calling thread takes part in the work. The first exception thrown by a task is rethrown here.
+        // Calls from several threads are run one after the other. Not reentrant: a task calling ParallelFor
+        // on the same pool asserts, and the nested loop then runs on the task's thread alone.
+        void ParallelFor(size_t nTasks, const std::function<void(size_t)>& task);
+
+    private:
+        CATV5PMIWorkStealingPool(const CATV5PMIWorkStealingPool&) = delete;
+        CATV5PMIWorkStealingPool& operator=(const CATV5PMIWorkStealingPool&) = delete;
+
+        struct Range
+        {
+            size_t begin;
+            size_t end;
+        };
+
+        struct WorkerQueue
+        {
+            std::mutex mutex;
+            std::deque<Range> ranges;
+        };
+
+        void WorkerMain(unsigned iWorker);
+        void RunWorker(unsigned iWorker);
+        bool PopLocal(unsigned iWorker, Range& range);
+        bool Steal(unsigned iWorker, Range& range);
+        void Execute(unsigned iWorker, Range range);
+        void PushRange(unsigned iWorker, Range range);
+
+        std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+        std::vector<std::thread> m_threads;
+
+        // Held for a whole ParallelFor, which has the pool to itself
+        std::mutex m_callMutex;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wakeUp;
+        std::condition_variable m_allDone;
+        // Idle workers of the running loop wait on it for a range to steal, or for the end of the loop
+        std::condition_variable m_workQueued;
+        std::atomic<size_t> m_nQueuedRanges;
+        std::atomic<unsigned> m_nIdleWorkers;
+        size_t m_generation;
+        unsigned m_nActiveWorkers;
+        bool m_bStop;
+
+        const std::function<void(size_t)>* m_pTask;
+        size_t m_grainSize;
+        std::atomic<size_t> m_nRemaining;
+        std::exception_ptr m_pError;
+    };
+}
@@ -0,0 +1,104 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace ATF;
+using namespace std;
+
+TEST(CATV5PMIWorkStealingPool, EveryTaskRunsOnce)
+{
+    CATV5PMIWorkStealingPool pool(8);
+    EXPECT_EQ(8u, pool.GetThreadCount());
+    for (size_t nTasks : { size_t(0), size_t(1), size_t(2), size_t(7), size_t(1000), size_t(100003) })
+    {
+        vector<atomic<int>> runs(nTasks);
+        for (atomic<int>& run : runs)
+            run = 0;
+        pool.ParallelFor(nTasks, [&](size_t i) { runs[i]++; });
+        for (size_t i = 0; i < nTasks; i++)
+            ASSERT_EQ(1, runs[i].load()) << nTasks << " " << i;
+    }
+}
+
+TEST(CATV5PMIWorkStealingPool, UnevenTasksAreBalanced)
+{
+    CATV5PMIWorkStealingPool pool(4);
+    const size_t nTasks = 4000;
+    vector<atomic<int>> runs(nTasks);
+    for (atomic<int>& run : runs)
+        run = 0;
+    pool.ParallelFor(nTasks, [&](size_t i)
+    {
+        // The first share of the range is much more costly than the others
+        if (i < nTasks / 4)
+            this_thread::sleep_for(chrono::microseconds(200));
+        runs[i]++;
+    });
+    for (size_t i = 0; i < nTasks; i++)
+        ASSERT_EQ(1, runs[i].load()) << i;
+}
+
+TEST(CATV5PMIWorkStealingPool, SingleThreadRunsInline)
+{
+    CATV5PMIWorkStealingPool pool(1);
+    thread::id caller = this_thread::get_id();
+    bool bOtherThread = false;
+    pool.ParallelFor(100, [&](size_t) { bOtherThread |= this_thread::get_id() != caller; });
+    EXPECT_FALSE(bOtherThread);
+}
+
+TEST(CATV5PMIWorkStealingPool, FirstExceptionIsRethrown)
+{
+    CATV5PMIWorkStealingPool pool(4);
+    EXPECT_THROW(pool.ParallelFor(1000, [](size_t i)
+    {
+        if (i == 500)
+            throw runtime_error("task failed");
+    }), runtime_error);
+
+    // The pool is still usable afterwards
+    atomic<size_t> nRuns(0);
+    pool.ParallelFor(1000, [&](size_t) { nRuns++; });
+    EXPECT_EQ(1000u, nRuns.load());
+}
+
+TEST(CATV5PMIWorkStealingPool, ConcurrentCallers)
+{
+    CATV5PMIWorkStealingPool pool(4);
+    atomic<int> nErrors(0);
+    vector<thread> callers;
+    for (int c = 0; c < 4; c++)
+    {
+        callers.emplace_back([&, c]()
+        {
+            for (int repeat = 0; repeat < 50; repeat++)
+            {
+                vector<atomic<int>> runs(1000 + c);
+                for (atomic<int>& run : runs)
+                    run = 0;
+                pool.ParallelFor(runs.size(), [&](size_t i) { runs[i]++; });
+                for (atomic<int>& run : runs)
+                    nErrors += run.load() != 1 ? 1 : 0;
+            }
+        });
+    }
+    for (thread& caller : callers)
+        caller.join();
+    EXPECT_EQ(0, nErrors.load());
+}
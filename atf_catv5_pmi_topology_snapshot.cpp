@@ -0,0 +1,236 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_object_handle.h"
+#include "atf_catv5_pmi_stats.h"
+#include "atf_catv5_pmi_topology_snapshot.h"
+
+#include <algorithm>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    // FNV-1a over the values of an array, with its size first so that the arrays do not run into each other
+    template <class T>
+    void HashValues(uint64_t& hash, const vector<T>& values)
+    {
+        hash ^= static_cast<uint64_t>(values.size());
+        hash *= 1099511628211ULL;
+        for (const T& value : values)
+        {
+            hash ^= static_cast<uint32_t>(value);
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    // Calls faceFunc(pFace, path) for each face of the solids of a solid group, path giving the indexes
+    // the face was fetched with. Every object fetched on the way is freed when its handle goes out of scope.
+    template <class FaceFunc>
+    void ForEachSolidFace(CC5Group* pGrp, FaceFunc faceFunc)
+    {
+        int iNumEnt = pGrp->GetNumberOfEntities();
+        for (int iEntItr = 0; iEntItr < iNumEnt; iEntItr++)
+        {
+            CC5ObjectHandle<CC5Entity> pEnt(pGrp->GetEntityAt(iEntItr));
+            if (!pEnt || pEnt->GetType() != CC5_SOLID_TYPE)
+                continue;
+
+            CC5Solid* pCC5SolidBody = dynamic_cast<CC5Solid*>(pEnt.Get());
+            int iNumBody = pCC5SolidBody ? pCC5SolidBody->GetNumberOfBodies() : 0;
+            for (int iBodyItr = 0; iBodyItr < iNumBody; iBodyItr++)
+            {
+                CC5ObjectHandle<CC5Body> pBody(pCC5SolidBody->GetBodyAt(iBodyItr));
+                if (!pBody || pBody->GetType() != CC5_BODY_TYPE)
+                    continue;
+
+                int iNumSkin = pBody->GetNumberOfSkins();
+                for (int iSkinItr = 0; iSkinItr < iNumSkin; iSkinItr++)
+                {
+                    CC5ObjectHandle<CC5Skin> pSkin(pBody->GetSkinAt(iSkinItr));
+                    if (!pSkin)
+                        continue;
+
+                    int iNumFace = pSkin->GetNumberOfFaces();
+                    for (int iFaceItr = 0; iFaceItr < iNumFace; iFaceItr++)
+                    {
+                        CC5ObjectHandle<CC5Face> pFace(pSkin->GetFaceAt(iFaceItr));
+                        if (pFace)
+                            faceFunc(pFace.Get(), { iEntItr, iBodyItr, iSkinItr, iFaceItr });
+                    }
+                }
+            }
+        }
+    }
+}
+
+CATV5PMIPersistentID::CATV5PMIPersistentID(CC5Face* pFace)
+    : m_bExists(false)
+    , m_groupOffsets(1, 0)
+{
+    if (pFace)
+        m_bExists = CATV5PMITopologySnapshot::ReadPersistentID(pFace, m_groupOffsets, m_ids);
+}
+
+CATV5PMIPersistentIDView CATV5PMIPersistentID::View() const
+{
+    CATV5PMIPersistentIDView view;
+    view.bExists = m_bExists;
+    view.nGroups = static_cast<uint32_t>(m_groupOffsets.size() - 1);
+    view.groupOffsets = m_groupOffsets.data();
+    view.ids = m_ids.data();
+    return view;
+}
+
+CATV5PMITopologySnapshot::CATV5PMITopologySnapshot(unsigned options)
+    : m_options(options)
+    , m_faceLoopOffsets(1, 0)
+    , m_loopEdgeOffsets(1, 0)
+    , m_facePersistentGroupOffsets(1, 0)
+    , m_persistentGroupOffsets(1, 0)
+{}
+
+void CATV5PMITopologySnapshot::AddSolidGroup(CC5Group* pGrp, uint32_t groupOrdinal)
+{
+    if (!pGrp)
+        return;
+
+    if (m_groups.size() <= groupOrdinal)
+        m_groups.resize(groupOrdinal + 1, nullptr);
+    m_groups[groupOrdinal] = pGrp;
+
+    int groupId = pGrp->GetID();
+    ForEachSolidFace(pGrp, [&](CC5Face* pFace, const FacePath& path)
+    {
+        AddFace(pFace, path, groupId, groupOrdinal);
+    });
+}
+
+CC5Face* CATV5PMITopologySnapshot::FetchFace(uint32_t iFace, CC5ReleaseArena& fetched) const
+{
+    const FacePath& path = m_facePaths[iFace];
+    CC5Group* pGrp = m_groups[m_faceGroupOrdinals[iFace]];
+
+    CC5Solid* pSolid = dynamic_cast<CC5Solid*>(fetched.Track(pGrp->GetEntityAt(path.entity)));
+    CC5Body* pBody = pSolid ? fetched.Track(pSolid->GetBodyAt(path.body)) : nullptr;
+    CC5Skin* pSkin = pBody ? fetched.Track(pBody->GetSkinAt(path.skin)) : nullptr;
+    CC5Face* pFace = pSkin ? fetched.Track(pSkin->GetFaceAt(path.face)) : nullptr;
+    if (!pFace || pFace->GetID() != m_faceIds[iFace])
+    {
+        ATF_WARNING_ASSERT(0 && "The face is no longer where it was snapshot");
+        return nullptr;
+    }
+    return pFace;
+}
+
+CC5CurveSegment* CATV5PMITopologySnapshot::FetchEdge(uint32_t iEdge, CC5ReleaseArena& fetched) const
+{
+    // The loop holding the edge use is the last one starting at or before it, and the same for the face
+    uint32_t iLoop = static_cast<uint32_t>(upper_bound(m_loopEdgeOffsets.begin(), m_loopEdgeOffsets.end(), iEdge) - m_loopEdgeOffsets.begin()) - 1;
+    uint32_t iFace = static_cast<uint32_t>(upper_bound(m_faceLoopOffsets.begin(), m_faceLoopOffsets.end(), iLoop) - m_faceLoopOffsets.begin()) - 1;
+
+    CC5Face* pFace = FetchFace(iFace, fetched);
+    CC5Loop* pLoop = pFace ? fetched.Track(pFace->GetLoopAt(m_loopIndexes[iLoop])) : nullptr;
+    CC5CurveSegment* pEdge = pLoop ? fetched.Track(pLoop->GetEdgeAt(m_edgeIndexes[iEdge])) : nullptr;
+    if (!pEdge || pEdge->GetID() != m_edgeIds[iEdge])
+    {
+        ATF_WARNING_ASSERT(0 && "The edge is no longer where it was snapshot");
+        return nullptr;
+    }
+    return pEdge;
+}
+
+CATV5PMIPersistentIDView CATV5PMITopologySnapshot::PersistentID(uint32_t iFace) const
+{
+    uint32_t iFirstGroup = m_facePersistentGroupOffsets[iFace];
+
+    CATV5PMIPersistentIDView view;
+    view.bExists = m_faceHasPersistentID[iFace] != 0;
+    view.nGroups = m_facePersistentGroupOffsets[iFace + 1] - iFirstGroup;
+    view.groupOffsets = m_persistentGroupOffsets.data() + iFirstGroup;
+    view.ids = m_persistentIds.data();
+    return view;
+}
+
+uint64_t CATV5PMITopologySnapshot::ContentHash() const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    HashValues(hash, m_faceIds);
+    HashValues(hash, m_faceGroupIds);
+    HashValues(hash, m_faceGroupOrdinals);
+    HashValues(hash, m_faceLoopOffsets);
+    HashValues(hash, m_loopEdgeOffsets);
+    HashValues(hash, m_edgeIds);
+    HashValues(hash, m_edgeCoEdge);
+    HashValues(hash, m_faceHasPersistentID);
+    HashValues(hash, m_facePersistentGroupOffsets);
+    HashValues(hash, m_persistentGroupOffsets);
+    HashValues(hash, m_persistentIds);
+    return hash;
+}
+
+bool CATV5PMITopologySnapshot::ReadPersistentID(CC5Face* pFace, vector<uint32_t>& groupOffsets, vector<int>& ids)
+{
+    CC5PersistentID* pPersisID = nullptr;
+    pFace->GetPersistentIdentifier(pPersisID);
+    if (!pPersisID)
+        return false;
+
+    // A group without list is kept as an empty group
+    int nGroups = pPersisID->GetGroupCount();
+    for (int i = 0; i < nGroups; i++)
+    {
+        int iSize = 0;
+        int* iIDList = nullptr;
+        pPersisID->GetGroupAt(i, iSize, iIDList);
+        if (iIDList && iSize > 0)
+            ids.insert(ids.end(), iIDList, iIDList + iSize);
+        groupOffsets.push_back(static_cast<uint32_t>(ids.size()));
+    }
+    return true;
+}
+
+void CATV5PMITopologySnapshot::AddFace(CC5Face* pFace, const FacePath& path, int groupId, uint32_t groupOrdinal)
+{
+    ATF_PMI_COUNT(kCounter_FacesVisited, 1);
+    m_faceIds.push_back(pFace->GetID());
+    m_faceGroupIds.push_back(groupId);
+    m_faceGroupOrdinals.push_back(groupOrdinal);
+    m_facePaths.push_back(path);
+
+    int nLoops = pFace->GetNumberOfLoops();
+    for (int iLoop = 0; iLoop < nLoops; iLoop++)
+    {
+        CC5ObjectHandle<CC5Loop> pLoop(pFace->GetLoopAt(iLoop));
+        if (!pLoop) continue;
+        int nEdges = pLoop->GetNumberOfEdges();
+        ATF_PMI_COUNT(kCounter_LoopsVisited, 1);
+        ATF_PMI_COUNT(kCounter_EdgesVisited, nEdges);
+        for (int iEdge = 0; iEdge < nEdges; iEdge++)
+        {
+            CC5ObjectHandle<CC5CurveSegment> pCrvSeg(pLoop->GetEdgeAt(iEdge));
+            if (!pCrvSeg) continue;
+            m_edgeIds.push_back(pCrvSeg->GetID());
+            m_edgeCoEdge.push_back(pCrvSeg->CoEdgeExisted() == CC5_TRUE ? 1 : 0);
+            m_edgeIndexes.push_back(iEdge);
+        }
+        m_loopEdgeOffsets.push_back(static_cast<uint32_t>(m_edgeIds.size()));
+        m_loopIndexes.push_back(iLoop);
+    }
+    m_faceLoopOffsets.push_back(static_cast<uint32_t>(m_loopEdgeOffsets.size() - 1));
+
+    bool bHasPersistentID = false;
+    if (m_options & kReadPersistentIDs)
+        bHasPersistentID = ReadPersistentID(pFace, m_persistentGroupOffsets, m_persistentIds);
+    m_faceHasPersistentID.push_back(bHasPersistentID ? 1 : 0);
+    m_facePersistentGroupOffsets.push_back(static_cast<uint32_t>(m_persistentGroupOffsets.size() - 1));
+}
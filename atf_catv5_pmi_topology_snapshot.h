@@ -0,0 +1,144 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include "atf_catv5_object_handle.h"
+#include "atf_catv5_pmi_util.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace ATF
+{
+    // Persistent-ID groups of one face, stored flat: group g is ids[groupOffsets[g], groupOffsets[g + 1]).
+    // A face without persistent ID has bExists false; a persistent ID can exist with no group at all.
+    struct CATV5PMIPersistentIDView
+    {
+        bool bExists;
+        uint32_t nGroups;
+        const uint32_t* groupOffsets;
+        const int* ids;
+
+        const int* GroupBegin(uint32_t iGroup) const { return ids + groupOffsets[iGroup]; }
+        uint32_t GroupSize(uint32_t iGroup) const { return groupOffsets[iGroup + 1] - groupOffsets[iGroup]; }
+    };
+
+    // Persistent ID of a face read on its own, for the faces queried against a snapshot
+    class CATV5PMIPersistentID
+    {
+    public:
+        explicit CATV5PMIPersistentID(CC5Face* pFace);
+
+        CATV5PMIPersistentIDView View() const;
+
+    private:
+        bool m_bExists;
+        std::vector<uint32_t> m_groupOffsets;
+        std::vector<int> m_ids;
+    };
+
+    // Flat copy of the B-rep of a list of solid groups, taken with one walk through the CC5 accessors.
+    // Faces, loops and edges are numbered in translation order and described by parallel arrays, the
+    // loops of a face and the edges of a loop being contiguous ranges. Lookups over the snapshot then
+    // run on plain arrays instead of fetching and casting CC5 objects again for every query.
+    // No CC5 object is kept: each face records where the reader gives it, so that the few faces and
+    // edges a lookup returns are fetched again for its caller.
+    class CATV5PMITopologySnapshot
+    {
+    public:
+        enum Options
+        {
+            // Keep the face's persistent ID in the snapshot
+            kReadPersistentIDs = 0x1
+        };
+
+        explicit CATV5PMITopologySnapshot(unsigned options);
+
+        // Appends the faces of the solids of pGrp. groupOrdinal is the position of the group in its list.
+        // pGrp is not owned, and must outlive the snapshot.
+        void AddSolidGroup(CC5Group* pGrp, uint32_t groupOrdinal);
+
+        uint32_t FaceCount() const { return static_cast<uint32_t>(m_faceIds.size()); }
+        int FaceId(uint32_t iFace) const { return m_faceIds[iFace]; }
+        int FaceGroupId(uint32_t iFace) const { return m_faceGroupIds[iFace]; }
+        uint32_t FaceGroupOrdinal(uint32_t iFace) const { return m_faceGroupOrdinals[iFace]; }
+
+        // Fetches the face/edge again from the reader. The object and its parents are tracked by fetched.
+        // Returns null if the B-rep no longer has it where it was snapshot.
+        CC5Face* FetchFace(uint32_t iFace, CC5ReleaseArena& fetched) const;
+        CC5CurveSegment* FetchEdge(uint32_t iEdge, CC5ReleaseArena& fetched) const;
+
+        // Loops of the face, and edges of the loop
+        uint32_t FaceLoopBegin(uint32_t iFace) const { return m_faceLoopOffsets[iFace]; }
+        uint32_t FaceLoopEnd(uint32_t iFace) const { return m_faceLoopOffsets[iFace + 1]; }
+        uint32_t LoopEdgeBegin(uint32_t iLoop) const { return m_loopEdgeOffsets[iLoop]; }
+        uint32_t LoopEdgeEnd(uint32_t iLoop) const { return m_loopEdgeOffsets[iLoop + 1]; }
+
+        // All the edges of the face, its loops being stored one after the other
+        uint32_t FaceEdgeBegin(uint32_t iFace) const { return m_loopEdgeOffsets[m_faceLoopOffsets[iFace]]; }
+        uint32_t FaceEdgeEnd(uint32_t iFace) const { return m_loopEdgeOffsets[m_faceLoopOffsets[iFace + 1]]; }
+
+        int EdgeId(uint32_t iEdge) const { return m_edgeIds[iEdge]; }
+        bool IsCoEdge(uint32_t iEdge) const { return m_edgeCoEdge[iEdge] != 0; }
+
+        // Only available with kReadPersistentIDs
+        CATV5PMIPersistentIDView PersistentID(uint32_t iFace) const;
+
+        // Hash of the IDs, ranges and persistent IDs of the snapshot, i.e. of everything but the reader indexes.
+        // Two snapshots of the same B-rep, even in different sessions, have the same hash.
+        uint64_t ContentHash() const;
+
+        // Appends the persistent-ID groups of pFace to groupOffsets/ids, as stored in a snapshot.
+        // groupOffsets must already hold the start of the first group. Returns false if the face has no persistent ID.
+        static bool ReadPersistentID(CC5Face* pFace, std::vector<uint32_t>& groupOffsets, std::vector<int>& ids);
+
+    private:
+        CATV5PMITopologySnapshot(const CATV5PMITopologySnapshot&) = delete;
+        CATV5PMITopologySnapshot& operator=(const CATV5PMITopologySnapshot&) = delete;
+
+        // Indexes of the face in GetEntityAt/GetBodyAt/GetSkinAt/GetFaceAt, from its group
+        struct FacePath
+        {
+            int entity;
+            int body;
+            int skin;
+            int face;
+        };
+
+        void AddFace(CC5Face* pFace, const FacePath& path, int groupId, uint32_t groupOrdinal);
+
+        unsigned m_options;
+
+        // Per face
+        std::vector<int> m_faceIds;
+        std::vector<int> m_faceGroupIds;
+        std::vector<uint32_t> m_faceGroupOrdinals;
+        std::vector<FacePath> m_facePaths;
+        std::vector<uint32_t> m_faceLoopOffsets;
+
+        // Per loop, with its index in GetLoopAt
+        std::vector<uint32_t> m_loopEdgeOffsets;
+        std::vector<int> m_loopIndexes;
+
+        // Per edge use, with its index in GetEdgeAt
+        std::vector<int> m_edgeIds;
+        std::vector<uint8_t> m_edgeCoEdge;
+        std::vector<int> m_edgeIndexes;
+
+        // Groups by ordinal, not owned
+        std::vector<CC5Group*> m_groups;
+
+        // Persistent IDs: per face a range of groups, per group a range of the id pool
+        std::vector<uint8_t> m_faceHasPersistentID;
+        std::vector<uint32_t> m_facePersistentGroupOffsets;
+        std::vector<uint32_t> m_persistentGroupOffsets;
+        std::vector<int> m_persistentIds;
+    };
+}
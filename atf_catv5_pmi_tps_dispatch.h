@@ -0,0 +1,81 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include "atf_catv5_pmi_util.h"
+
+#include <utility>
+
+namespace ATF
+{
+    // Concrete class of each annotation type translated as PMI
+    template <CC5_TPS_TYPE Type> struct CATV5PMITPSClass;
+    template <> struct CATV5PMITPSClass<CC5_TPS_TEXT> { typedef CC5TPSText Type; };
+    template <> struct CATV5PMITPSClass<CC5_TPS_FLAG_NOTE> { typedef CC5TPSFlagNote Type; };
+    template <> struct CATV5PMITPSClass<CC5_TPS_LINEAR_DIMENSION> { typedef CC5TPSLinearDimension Type; };
+    template <> struct CATV5PMITPSClass<CC5_TPS_COORDINATE_DIMENSION> { typedef CC5TPSCoordDimension Type; };
+    template <> struct CATV5PMITPSClass<CC5_TPS_GEOMETRIC_TOLERANCE> { typedef CC5TPSGeometricTolerance Type; };
+    template <> struct CATV5PMITPSClass<CC5_TPS_SIMPLE_DATUM> { typedef CC5TPSSimpleDatum Type; };
+    template <> struct CATV5PMITPSClass<CC5_TPS_DATUM_TARGET> { typedef CC5TPSDatumTarget Type; };
+    template <> struct CATV5PMITPSClass<CC5_TPS_ROUGHNESS> { typedef CC5TPSRoughness Type; };
+
+    class CATV5PMITPSDispatch
+    {
+    public:
+        // Calls func with pShape cast to the concrete class of type, as given by pShape->GetTPSType.
+        // func is typically a generic lambda, [&](auto* pAnnotationObj) { ... }.
+        // Returns false without calling func if type is not a supported annotation type, or not the class of pShape.
+        template <class Func>
+        static bool Visit(CC5TPSShape* pShape, CC5_TPS_TYPE type, Func&& func)
+        {
+            if (!pShape)
+                return false;
+
+            switch (type)
+            {
+            case CC5_TPS_TEXT:
+                return Call<CC5_TPS_TEXT>(pShape, std::forward<Func>(func));
+            case CC5_TPS_FLAG_NOTE:
+                return Call<CC5_TPS_FLAG_NOTE>(pShape, std::forward<Func>(func));
+            case CC5_TPS_LINEAR_DIMENSION:
+                return Call<CC5_TPS_LINEAR_DIMENSION>(pShape, std::forward<Func>(func));
+            case CC5_TPS_COORDINATE_DIMENSION:
+                return Call<CC5_TPS_COORDINATE_DIMENSION>(pShape, std::forward<Func>(func));
+            case CC5_TPS_GEOMETRIC_TOLERANCE:
+                return Call<CC5_TPS_GEOMETRIC_TOLERANCE>(pShape, std::forward<Func>(func));
+            case CC5_TPS_SIMPLE_DATUM:
+                return Call<CC5_TPS_SIMPLE_DATUM>(pShape, std::forward<Func>(func));
+            case CC5_TPS_DATUM_TARGET:
+                return Call<CC5_TPS_DATUM_TARGET>(pShape, std::forward<Func>(func));
+            case CC5_TPS_ROUGHNESS:
+                return Call<CC5_TPS_ROUGHNESS>(pShape, std::forward<Func>(func));
+            default:
+                return false;
+            }
+        }
+
+    private:
+        // The tag only picks the class: the cast to it is still checked, a single dynamic_cast instead of
+        // trying each annotation class in turn. A shape whose class does not match its tag is not visited.
+        template <CC5_TPS_TYPE Type, class Func>
+        static bool Call(CC5TPSShape* pShape, Func&& func)
+        {
+            auto* pAnnotationObj = dynamic_cast<typename CATV5PMITPSClass<Type>::Type*>(pShape);
+            if (!pAnnotationObj)
+            {
+                ATF_WARNING_ASSERT(0 && "TPS type does not match the annotation class");
+                return false;
+            }
+
+            func(pAnnotationObj);
+            return true;
+        }
+    };
+}
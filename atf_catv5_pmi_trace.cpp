@@ -0,0 +1,217 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace ATF;
+using namespace std;
+
+std::atomic<bool> CATV5PMITrace::s_bEnabled(false);
+
+namespace
+{
+    const size_t kChunkSize = 4096;
+
+    struct TraceEvent
+    {
+        const char* name;
+        int64_t id;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    struct TraceChunk
+    {
+        TraceChunk() : pNext(nullptr) {}
+
+        TraceEvent events[kChunkSize];
+        atomic<TraceChunk*> pNext;
+    };
+
+    // Spans of one thread for one recording. Only the owning thread appends; the events up to
+    // nEvents are published, so Stop reads them without stopping the thread.
+    struct TraceBuffer
+    {
+        TraceBuffer(uint64_t recording, uint32_t threadIndex)
+            : recording(recording)
+            , threadIndex(threadIndex)
+            , pFirst(new TraceChunk())
+            , pLast(pFirst)
+            , nInLast(0)
+            , nEvents(0)
+        {}
+
+        ~TraceBuffer()
+        {
+            TraceChunk* pChunk = pFirst;
+            while (pChunk)
+            {
+                TraceChunk* pNext = pChunk->pNext.load(memory_order_relaxed);
+                delete pChunk;
+                pChunk = pNext;
+            }
+        }
+
+        void Append(const TraceEvent& event)
+        {
+            if (nInLast == kChunkSize)
+            {
+                TraceChunk* pChunk = new TraceChunk();
+                pLast->pNext.store(pChunk, memory_order_relaxed);
+                pLast = pChunk;
+                nInLast = 0;
+            }
+            pLast->events[nInLast++] = event;
+            nEvents.store(nEvents.load(memory_order_relaxed) + 1, memory_order_release);
+        }
+
+        const uint64_t recording;
+        const uint32_t threadIndex;
+        TraceChunk* const pFirst;
+        TraceChunk* pLast;
+        size_t nInLast;
+        atomic<size_t> nEvents;
+    };
+
+    struct TraceRecording
+    {
+        TraceRecording() : id(0), start(0), nThreads(0) {}
+
+        uint64_t id;
+        uint64_t start;
+        uint32_t nThreads;
+        vector<shared_ptr<TraceBuffer>> buffers;
+    };
+
+    mutex& TraceMutex()
+    {
+        static mutex s_mutex;
+        return s_mutex;
+    }
+
+    TraceRecording& Recording()
+    {
+        static TraceRecording s_recording;
+        return s_recording;
+    }
+
+    atomic<uint64_t>& RecordingId()
+    {
+        static atomic<uint64_t> s_recordingId(0);
+        return s_recordingId;
+    }
+
+    // Kept by the thread after a restart of the recording, until its next span replaces it
+    thread_local shared_ptr<TraceBuffer> t_pBuffer;
+
+    TraceBuffer* ThreadBuffer()
+    {
+        uint64_t recording = RecordingId().load(memory_order_acquire);
+        if (t_pBuffer && t_pBuffer->recording == recording)
+            return t_pBuffer.get();
+
+        lock_guard<mutex> lock(TraceMutex());
+        TraceRecording& current = Recording();
+        if (current.id != recording)
+            return nullptr;
+
+        t_pBuffer = make_shared<TraceBuffer>(recording, ++current.nThreads);
+        current.buffers.push_back(t_pBuffer);
+        return t_pBuffer.get();
+    }
+
+    // Microseconds since the start of the recording, as expected by the trace viewers
+    void WriteMicroseconds(ostream& out, uint64_t nanoseconds)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%llu.%03u", static_cast<unsigned long long>(nanoseconds / 1000), static_cast<unsigned>(nanoseconds % 1000));
+        out << buffer;
+    }
+}
+
+void CATV5PMITrace::Start()
+{
+    vector<shared_ptr<TraceBuffer>> previousBuffers;
+    {
+        lock_guard<mutex> lock(TraceMutex());
+        TraceRecording& current = Recording();
+        previousBuffers.swap(current.buffers);
+        current.id = RecordingId().load(memory_order_relaxed) + 1;
+        current.start = Now();
+        current.nThreads = 0;
+        RecordingId().store(current.id, memory_order_release);
+    }
+    s_bEnabled.store(true, memory_order_relaxed);
+}
+
+bool CATV5PMITrace::Stop(const string& filePath)
+{
+    s_bEnabled.store(false, memory_order_relaxed);
+
+    uint64_t start = 0;
+    vector<shared_ptr<TraceBuffer>> buffers;
+    {
+        lock_guard<mutex> lock(TraceMutex());
+        start = Recording().start;
+        buffers = Recording().buffers;
+    }
+
+    ofstream out(filePath.c_str(), ios::out | ios::trunc);
+    if (!out)
+        return false;
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"PMI translation\"}}";
+    for (const shared_ptr<TraceBuffer>& pBuffer : buffers)
+    {
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << pBuffer->threadIndex
+            << ",\"args\":{\"name\":\"PMI thread " << pBuffer->threadIndex << "\"}}";
+
+        size_t nEvents = pBuffer->nEvents.load(memory_order_acquire);
+        const TraceChunk* pChunk = pBuffer->pFirst;
+        for (size_t iFirst = 0; iFirst < nEvents; iFirst += kChunkSize)
+        {
+            size_t nInChunk = min(kChunkSize, nEvents - iFirst);
+            for (size_t i = 0; i < nInChunk; i++)
+            {
+                const TraceEvent& event = pChunk->events[i];
+                out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << pBuffer->threadIndex << ",\"ts\":";
+                WriteMicroseconds(out, event.start > start ? event.start - start : 0);
+                out << ",\"dur\":";
+                WriteMicroseconds(out, event.end > event.start ? event.end - event.start : 0);
+                if (event.id != kNoId)
+                    out << ",\"args\":{\"id\":" << event.id << "}";
+                out << "}";
+            }
+            pChunk = pChunk->pNext.load(memory_order_relaxed);
+        }
+    }
+    out << "\n]}\n";
+    out.close();
+    return !out.fail();
+}
+
+void CATV5PMITrace::Record(const char* name, int64_t id, uint64_t startNanoseconds, uint64_t endNanoseconds)
+{
+    TraceBuffer* pBuffer = ThreadBuffer();
+    if (!pBuffer)
+        return;
+
+    TraceEvent event = { name, id, startNanoseconds, endNanoseconds };
+    pBuffer->Append(event);
+}
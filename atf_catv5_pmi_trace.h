@@ -0,0 +1,85 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Span tracing of the PMI translation, written as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+// Nothing is recorded until CATV5PMITrace::Start; a span then costs two clock reads and a store into
+// the thread's own buffer. Define ATF_PMI_RELEASE_LITE to compile the spans out.
+//
+//   ATF_PMI_TRACE_SPAN("name")          records the scope as a span; name must be a string literal
+//   ATF_PMI_TRACE_SPAN_ID("name", id)   same, with id shown in the span arguments (an entity id, ...)
+#ifndef ATF_PMI_RELEASE_LITE
+#define ATF_PMI_TRACE_CONCAT_(a, b) a##b
+#define ATF_PMI_TRACE_CONCAT(a, b) ATF_PMI_TRACE_CONCAT_(a, b)
+#define ATF_PMI_TRACE_SPAN(name) ::ATF::CATV5PMITraceSpan ATF_PMI_TRACE_CONCAT(atfPmiTraceSpan, __LINE__)(name)
+#define ATF_PMI_TRACE_SPAN_ID(name, id) ::ATF::CATV5PMITraceSpan ATF_PMI_TRACE_CONCAT(atfPmiTraceSpan, __LINE__)(name, id)
+#else
+#define ATF_PMI_TRACE_SPAN(name) ((void)0)
+#define ATF_PMI_TRACE_SPAN_ID(name, id) ((void)0)
+#endif
+
+namespace ATF
+{
+    class CATV5PMITrace
+    {
+    public:
+        static const int64_t kNoId = INT64_MIN;
+
+        // Starts recording, dropping the spans of any previous recording
+        static void Start();
+
+        // Stops recording and writes the spans recorded since Start to filePath.
+        // Spans still open are not written. Returns false if the file cannot be written.
+        static bool Stop(const std::string& filePath);
+
+        static bool IsEnabled() { return s_bEnabled.load(std::memory_order_relaxed); }
+
+        static uint64_t Now()
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        // Appends a span to the buffer of the calling thread
+        static void Record(const char* name, int64_t id, uint64_t startNanoseconds, uint64_t endNanoseconds);
+
+    private:
+        static std::atomic<bool> s_bEnabled;
+    };
+
+    class CATV5PMITraceSpan
+    {
+    public:
+        explicit CATV5PMITraceSpan(const char* name, int64_t id = CATV5PMITrace::kNoId)
+            : m_name(CATV5PMITrace::IsEnabled() ? name : nullptr)
+            , m_id(id)
+            , m_start(m_name ? CATV5PMITrace::Now() : 0)
+        {}
+
+        ~CATV5PMITraceSpan()
+        {
+            if (m_name)
+                CATV5PMITrace::Record(m_name, m_id, m_start, CATV5PMITrace::Now());
+        }
+
+    private:
+        CATV5PMITraceSpan(const CATV5PMITraceSpan&) = delete;
+        CATV5PMITraceSpan& operator=(const CATV5PMITraceSpan&) = delete;
+
+        const char* m_name;
+        int64_t m_id;
+        uint64_t m_start;
+    };
+}
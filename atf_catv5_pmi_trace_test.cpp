@@ -0,0 +1,118 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_trace.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    string ReadFile(const string& filePath)
+    {
+        ifstream in(filePath);
+        stringstream content;
+        content << in.rdbuf();
+        return content.str();
+    }
+
+    size_t Count(const string& text, const string& pattern)
+    {
+        size_t nFound = 0;
+        for (size_t pos = text.find(pattern); pos != string::npos; pos = text.find(pattern, pos + 1))
+            nFound++;
+        return nFound;
+    }
+
+    string TracePath()
+    {
+        return testing::TempDir() + "atf_catv5_pmi_trace_test.json";
+    }
+}
+
+TEST(CATV5PMITrace, NothingRecordedBeforeStart)
+{
+    {
+        ATF_PMI_TRACE_SPAN("before");
+    }
+    CATV5PMITrace::Start();
+    {
+        ATF_PMI_TRACE_SPAN("during");
+    }
+    ASSERT_TRUE(CATV5PMITrace::Stop(TracePath()));
+    EXPECT_FALSE(CATV5PMITrace::IsEnabled());
+
+    string trace = ReadFile(TracePath());
+    EXPECT_EQ(0u, Count(trace, "\"before\""));
+    EXPECT_EQ(1u, Count(trace, "\"during\""));
+    remove(TracePath().c_str());
+}
+
+TEST(CATV5PMITrace, SpansOfEveryThread)
+{
+    const int nThreads = 4;
+    const int nSpans = 5000;
+    CATV5PMITrace::Start();
+    vector<thread> threads;
+    for (int t = 0; t < nThreads; t++)
+    {
+        threads.emplace_back([]()
+        {
+            for (int i = 0; i < nSpans; i++)
+            {
+                ATF_PMI_TRACE_SPAN_ID("work", i);
+            }
+        });
+    }
+    for (thread& worker : threads)
+        worker.join();
+    ASSERT_TRUE(CATV5PMITrace::Stop(TracePath()));
+
+    string trace = ReadFile(TracePath());
+    EXPECT_EQ(0u, trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+    EXPECT_EQ(size_t(nThreads * nSpans), Count(trace, "\"name\":\"work\",\"ph\":\"X\""));
+    EXPECT_EQ(size_t(nThreads), Count(trace, "\"args\":{\"id\":4999}"));
+    EXPECT_EQ(size_t(nThreads), Count(trace, "\"thread_name\""));
+    EXPECT_EQ(trace.size() - 4, trace.rfind("\n]}\n"));
+    remove(TracePath().c_str());
+}
+
+TEST(CATV5PMITrace, RestartDropsThePreviousRecording)
+{
+    CATV5PMITrace::Start();
+    {
+        ATF_PMI_TRACE_SPAN("first");
+    }
+    CATV5PMITrace::Start();
+    {
+        ATF_PMI_TRACE_SPAN("second");
+    }
+    ASSERT_TRUE(CATV5PMITrace::Stop(TracePath()));
+
+    string trace = ReadFile(TracePath());
+    EXPECT_EQ(0u, Count(trace, "\"first\""));
+    EXPECT_EQ(1u, Count(trace, "\"second\""));
+    remove(TracePath().c_str());
+}
+
+TEST(CATV5PMITrace, UnwritableFile)
+{
+    CATV5PMITrace::Start();
+    EXPECT_FALSE(CATV5PMITrace::Stop(testing::TempDir() + "no_such_directory/trace.json"));
+}
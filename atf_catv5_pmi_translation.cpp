@@ -0,0 +1,132 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_producer_impl.h"
+#include "atf_catv5_pmi_annotation_cache.h"
+#include "atf_catv5_pmi_draw_standard.h"
+#include "atf_catv5_pmi_part_context.h"
+#include "atf_catv5_pmi_translation.h"
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    // Drops everything cached for the current session
+    void ReleaseCaches()
+    {
+        CATV5PMIPartContext::ReleaseAll();
+        CATV5PMIAnnotationCache::Clear();
+        CATV5PMIDrawStandard::Clear();
+    }
+
+    // Session of the calling thread's CATV5PMIPartSessionScope, kept from one scope to the next
+    struct KeptSession
+    {
+        KeptSession()
+            : pPart(nullptr)
+        {}
+
+        ~KeptSession()
+        {
+            Close();
+        }
+
+        // Whether the session was opened for the part the producer is translating now
+        bool IsForProducerPart() const
+        {
+            CATV5ProducerImpl* pProducer = CATV5ProducerImpl::Get();
+            if (pSession->GetEventManager() != pProducer->GetEventManager())
+                return false;
+
+            const FINALBODYLIST& groups = pSession->TranslatableGroups();
+            size_t iGroup = 0;
+            for (auto e : pProducer->TranslatableGroups())
+            {
+                if (iGroup == groups.size() || groups[iGroup] != e)
+                    return false;
+                iGroup++;
+            }
+            return iGroup == groups.size();
+        }
+
+        void Close()
+        {
+            if (!pSession)
+                return;
+            {
+                CATV5PMISessionScope scope(pSession.get());
+                ReleaseCaches();
+            }
+            pSession.reset();
+            pPart = nullptr;
+        }
+
+        // Null until an entry point knowing its part is called
+        CC5Part* pPart;
+        unique_ptr<CATV5PMISession> pSession;
+    };
+
+    thread_local KeptSession t_keptSession;
+}
+
+CATV5PMITranslation::CATV5PMITranslation()
+    : m_pSession(new CATV5PMISession())
+    , m_scope(m_pSession.get())
+{}
+
+CATV5PMITranslation::CATV5PMITranslation(const FINALBODYLIST& translatableGroups, const EventManager* pEventManager)
+    : m_pSession(new CATV5PMISession(translatableGroups, pEventManager))
+    , m_scope(m_pSession.get())
+{}
+
+// Still in the session: the caches are dropped before the scope is left and the session destroyed
+CATV5PMITranslation::~CATV5PMITranslation()
+{
+    ReleaseCaches();
+}
+
+unique_ptr<CATV5PMITranslation> CATV5PMITranslation::OpenIfNone()
+{
+    if (CATV5PMISession::Current())
+        return nullptr;
+    return unique_ptr<CATV5PMITranslation>(new CATV5PMITranslation());
+}
+
+CATV5PMIPartSessionScope::CATV5PMIPartSessionScope(CC5Part* pPart)
+{
+    if (CATV5PMISession::Current())
+        return;
+
+    KeptSession& kept = t_keptSession;
+    if (kept.pSession && ((pPart && kept.pPart && kept.pPart != pPart) || !kept.IsForProducerPart()))
+        kept.Close();
+    if (!kept.pSession)
+        kept.pSession.reset(new CATV5PMISession());
+    if (pPart)
+        kept.pPart = pPart;
+
+    m_pScope.reset(new CATV5PMISessionScope(kept.pSession.get()));
+}
+
+CATV5PMIPartSessionScope::~CATV5PMIPartSessionScope()
+{}
+
+void CATV5PMIPartSessionScope::Close()
+{
+    KeptSession& kept = t_keptSession;
+    if (kept.pSession && CATV5PMISession::Current() == kept.pSession.get())
+    {
+        ATF_WARNING_ASSERT(0 && "The kept session cannot be closed from within a CATV5PMIPartSessionScope");
+        return;
+    }
+    kept.Close();
+}
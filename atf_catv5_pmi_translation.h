@@ -0,0 +1,69 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include "atf_catv5_pmi_session.h"
+#include "atf_catv5_pmi_util.h"
+
+#include <memory>
+
+namespace ATF
+{
+    // One PMI translation on the calling thread: creates a CATV5PMISession and enters it until destroyed.
+    // The destructor drops everything cached for the translation, then the session.
+    //
+    // The producer opens one around the translation of each part. GeometryReferenceBatch and
+    // CATV5PMIAssemblyScheduler, called outside of any session, open one for the duration of the call;
+    // the per-annotation entry points use CATV5PMIPartSessionScope instead.
+    // A translation must be destroyed on the thread that created it.
+    class CATV5PMITranslation
+    {
+    public:
+        // Translation of the part the producer is translating, see CATV5PMISession()
+        CATV5PMITranslation();
+        CATV5PMITranslation(const FINALBODYLIST& translatableGroups, const EventManager* pEventManager);
+        ~CATV5PMITranslation();
+
+        CATV5PMISession& Session() { return *m_pSession; }
+
+        // Opens a translation of the producer's part if the calling thread has no session, returns null otherwise
+        static std::unique_ptr<CATV5PMITranslation> OpenIfNone();
+
+    private:
+        CATV5PMITranslation(const CATV5PMITranslation&) = delete;
+        CATV5PMITranslation& operator=(const CATV5PMITranslation&) = delete;
+
+        std::unique_ptr<CATV5PMISession> m_pSession;
+        CATV5PMISessionScope m_scope;
+    };
+
+    // Enters, until destroyed, the session kept on the calling thread for the part the producer is translating,
+    // when the thread has no session; does nothing otherwise. The PMI entry points called once per annotation
+    // (GeometryReferenceBuilder...) go through it, so that all the annotations of a part share one part context
+    // instead of indexing the part again on every call.
+    // The kept session and its caches are dropped when the producer's translatable groups change, when an entry
+    // point is called for another CC5Part, by Close(), or when the thread exits.
+    class CATV5PMIPartSessionScope
+    {
+    public:
+        // pPart is the part the entry point works on, null if it does not know it
+        explicit CATV5PMIPartSessionScope(CC5Part* pPart = nullptr);
+        ~CATV5PMIPartSessionScope();
+
+        // Drops the session kept on the calling thread, e.g. before the reader closes the part
+        static void Close();
+
+    private:
+        CATV5PMIPartSessionScope(const CATV5PMIPartSessionScope&) = delete;
+        CATV5PMIPartSessionScope& operator=(const CATV5PMIPartSessionScope&) = delete;
+
+        std::unique_ptr<CATV5PMISessionScope> m_pScope;
+    };
+}
@@ -0,0 +1,137 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_vertex_tree.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace ATF;
+using namespace std;
+
+void CATV5PMIVertexTree::Build(vector<Vertex> vertices)
+{
+    m_vertices.swap(vertices);
+    m_axes.assign(m_vertices.size(), 0);
+    BuildRange(0, m_vertices.size());
+}
+
+bool CATV5PMIVertexTree::Nearest(const double point[3], double maxDistance, Vertex& nearest, double& distance) const
+{
+    if (m_vertices.empty() || maxDistance < 0)
+        return false;
+
+    size_t iBest = m_vertices.size();
+    double bestSqDistance = maxDistance * maxDistance;
+    NearestInRange(0, m_vertices.size(), point, iBest, bestSqDistance);
+    if (iBest == m_vertices.size())
+        return false;
+
+    nearest = m_vertices[iBest];
+    distance = sqrt(bestSqDistance);
+    return true;
+}
+
+void CATV5PMIVertexTree::WithinRadius(const double point[3], double radius, vector<uint32_t>& payloads) const
+{
+    if (radius >= 0)
+        WithinRadiusInRange(0, m_vertices.size(), point, radius * radius, payloads);
+}
+
+void CATV5PMIVertexTree::BuildRange(size_t begin, size_t end)
+{
+    if (end - begin <= 1)
+        return;
+
+    double lo[3] = { m_vertices[begin].pos[0], m_vertices[begin].pos[1], m_vertices[begin].pos[2] };
+    double hi[3] = { lo[0], lo[1], lo[2] };
+    for (size_t i = begin + 1; i < end; i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            lo[k] = min(lo[k], m_vertices[i].pos[k]);
+            hi[k] = max(hi[k], m_vertices[i].pos[k]);
+        }
+    }
+
+    uint8_t axis = 0;
+    for (uint8_t k = 1; k < 3; k++)
+    {
+        if (hi[k] - lo[k] > hi[axis] - lo[axis])
+            axis = k;
+    }
+
+    size_t mid = begin + (end - begin) / 2;
+    nth_element(m_vertices.begin() + begin, m_vertices.begin() + mid, m_vertices.begin() + end, [axis](const Vertex& a, const Vertex& b)
+    {
+        return a.pos[axis] < b.pos[axis];
+    });
+    m_axes[mid] = axis;
+
+    BuildRange(begin, mid);
+    BuildRange(mid + 1, end);
+}
+
+// The side of the split holding the point is searched first, the other one only if the
+// splitting plane is nearer than the best vertex found so far
+void CATV5PMIVertexTree::NearestInRange(size_t begin, size_t end, const double point[3], size_t& iBest, double& bestSqDistance) const
+{
+    if (begin >= end)
+        return;
+
+    size_t mid = begin + (end - begin) / 2;
+    const Vertex& node = m_vertices[mid];
+    double sqDistance = SqDistance(point, node.pos);
+    if (sqDistance <= bestSqDistance)
+    {
+        iBest = mid;
+        bestSqDistance = sqDistance;
+    }
+
+    double offset = point[m_axes[mid]] - node.pos[m_axes[mid]];
+    if (offset < 0)
+    {
+        NearestInRange(begin, mid, point, iBest, bestSqDistance);
+        if (offset * offset <= bestSqDistance)
+            NearestInRange(mid + 1, end, point, iBest, bestSqDistance);
+    }
+    else
+    {
+        NearestInRange(mid + 1, end, point, iBest, bestSqDistance);
+        if (offset * offset <= bestSqDistance)
+            NearestInRange(begin, mid, point, iBest, bestSqDistance);
+    }
+}
+
+void CATV5PMIVertexTree::WithinRadiusInRange(size_t begin, size_t end, const double point[3], double sqRadius, vector<uint32_t>& payloads) const
+{
+    if (begin >= end)
+        return;
+
+    size_t mid = begin + (end - begin) / 2;
+    const Vertex& node = m_vertices[mid];
+    if (SqDistance(point, node.pos) <= sqRadius)
+        payloads.push_back(node.payload);
+
+    double offset = point[m_axes[mid]] - node.pos[m_axes[mid]];
+    if (offset <= 0 || offset * offset <= sqRadius)
+        WithinRadiusInRange(begin, mid, point, sqRadius, payloads);
+    if (offset >= 0 || offset * offset <= sqRadius)
+        WithinRadiusInRange(mid + 1, end, point, sqRadius, payloads);
+}
+
+double CATV5PMIVertexTree::SqDistance(const double a[3], const double b[3])
+{
+    double dx = a[0] - b[0];
+    double dy = a[1] - b[1];
+    double dz = a[2] - b[2];
+    return dx * dx + dy * dy + dz * dz;
+}
@@ -0,0 +1,53 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ATF
+{
+    // Static k-d tree over 3D positions, for snapping a point to the nearest vertex of a part.
+    // The positions are reordered in an array laid out as a balanced tree: the node of a range is the median
+    // at its middle, split on the widest axis of the range. Queries descend it in O(log n) without pointers.
+    class CATV5PMIVertexTree
+    {
+    public:
+        struct Vertex
+        {
+            double pos[3];
+            // Data of the caller, returned by the queries
+            uint32_t payload;
+        };
+
+        // Replaces the content of the tree
+        void Build(std::vector<Vertex> vertices);
+
+        uint32_t Size() const { return static_cast<uint32_t>(m_vertices.size()); }
+
+        // Finds the vertex nearest to point, not farther than maxDistance. Returns false if there is none.
+        bool Nearest(const double point[3], double maxDistance, Vertex& nearest, double& distance) const;
+
+        // Appends the payloads of the vertices not farther than radius from point, in no particular order
+        void WithinRadius(const double point[3], double radius, std::vector<uint32_t>& payloads) const;
+
+    private:
+        void BuildRange(size_t begin, size_t end);
+        void NearestInRange(size_t begin, size_t end, const double point[3], size_t& iBest, double& bestSqDistance) const;
+        void WithinRadiusInRange(size_t begin, size_t end, const double point[3], double sqRadius, std::vector<uint32_t>& payloads) const;
+
+        static double SqDistance(const double a[3], const double b[3]);
+
+        std::vector<Vertex> m_vertices;
+        // Split axis of the node at each position
+        std::vector<uint8_t> m_axes;
+    };
+}
@@ -0,0 +1,136 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_vertex_tree.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    CATV5PMIVertexTree::Vertex MakeVertex(double x, double y, double z, uint32_t payload)
+    {
+        CATV5PMIVertexTree::Vertex vertex = { { x, y, z }, payload };
+        return vertex;
+    }
+
+    double SqDistance(const double a[3], const double b[3])
+    {
+        double dx = a[0] - b[0];
+        double dy = a[1] - b[1];
+        double dz = a[2] - b[2];
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    vector<CATV5PMIVertexTree::Vertex> RandomVertices(size_t count, mt19937& random)
+    {
+        uniform_real_distribution<double> coordinate(-100.0, 100.0);
+        vector<CATV5PMIVertexTree::Vertex> vertices;
+        for (size_t i = 0; i < count; i++)
+            vertices.push_back(MakeVertex(coordinate(random), coordinate(random), coordinate(random), static_cast<uint32_t>(i)));
+        return vertices;
+    }
+}
+
+TEST(CATV5PMIVertexTree, EmptyTreeFindsNothing)
+{
+    CATV5PMIVertexTree tree;
+    double point[3] = { 0, 0, 0 };
+    CATV5PMIVertexTree::Vertex nearest;
+    double distance = 0;
+    EXPECT_FALSE(tree.Nearest(point, 1.0, nearest, distance));
+
+    vector<uint32_t> payloads;
+    tree.WithinRadius(point, 1.0, payloads);
+    EXPECT_TRUE(payloads.empty());
+}
+
+TEST(CATV5PMIVertexTree, NearestIsWithinTheTolerance)
+{
+    CATV5PMIVertexTree tree;
+    tree.Build({ MakeVertex(0, 0, 0, 1), MakeVertex(10, 0, 0, 2), MakeVertex(0, 10, 0, 3) });
+
+    double point[3] = { 10.0005, 0, 0 };
+    CATV5PMIVertexTree::Vertex nearest;
+    double distance = 0;
+    ASSERT_TRUE(tree.Nearest(point, 1.0e-3, nearest, distance));
+    EXPECT_EQ(2u, nearest.payload);
+    EXPECT_NEAR(5.0e-4, distance, 1.0e-9);
+
+    double farPoint[3] = { 5, 5, 0 };
+    EXPECT_FALSE(tree.Nearest(farPoint, 1.0e-3, nearest, distance));
+}
+
+TEST(CATV5PMIVertexTree, NearestMatchesALinearSearch)
+{
+    mt19937 random(7);
+    vector<CATV5PMIVertexTree::Vertex> vertices = RandomVertices(2000, random);
+    CATV5PMIVertexTree tree;
+    tree.Build(vertices);
+    ASSERT_EQ(vertices.size(), tree.Size());
+
+    uniform_real_distribution<double> coordinate(-110.0, 110.0);
+    for (int query = 0; query < 200; query++)
+    {
+        double point[3] = { coordinate(random), coordinate(random), coordinate(random) };
+        double bestSqDistance = 1.0e300;
+        for (const CATV5PMIVertexTree::Vertex& vertex : vertices)
+            bestSqDistance = min(bestSqDistance, SqDistance(point, vertex.pos));
+
+        CATV5PMIVertexTree::Vertex nearest;
+        double distance = 0;
+        ASSERT_TRUE(tree.Nearest(point, 1000.0, nearest, distance));
+        EXPECT_DOUBLE_EQ(bestSqDistance, SqDistance(point, nearest.pos));
+    }
+}
+
+TEST(CATV5PMIVertexTree, WithinRadiusMatchesALinearSearch)
+{
+    mt19937 random(11);
+    vector<CATV5PMIVertexTree::Vertex> vertices = RandomVertices(2000, random);
+    CATV5PMIVertexTree tree;
+    tree.Build(vertices);
+
+    uniform_real_distribution<double> coordinate(-100.0, 100.0);
+    for (int query = 0; query < 50; query++)
+    {
+        double point[3] = { coordinate(random), coordinate(random), coordinate(random) };
+        vector<uint32_t> expected;
+        for (const CATV5PMIVertexTree::Vertex& vertex : vertices)
+        {
+            if (SqDistance(point, vertex.pos) <= 15.0 * 15.0)
+                expected.push_back(vertex.payload);
+        }
+
+        vector<uint32_t> payloads;
+        tree.WithinRadius(point, 15.0, payloads);
+        sort(payloads.begin(), payloads.end());
+        EXPECT_EQ(expected, payloads);
+    }
+}
+
+TEST(CATV5PMIVertexTree, CoincidentVerticesAreAllFound)
+{
+    // The end points of the edges meeting at a vertex, as read from each edge
+    CATV5PMIVertexTree tree;
+    tree.Build({ MakeVertex(1, 1, 1, 0), MakeVertex(1.0002, 1, 1, 1), MakeVertex(1, 0.9998, 1, 2), MakeVertex(2, 1, 1, 3) });
+
+    vector<uint32_t> payloads;
+    double vertex[3] = { 1, 1, 1 };
+    tree.WithinRadius(vertex, 1.0e-3, payloads);
+    sort(payloads.begin(), payloads.end());
+    EXPECT_EQ(vector<uint32_t>({ 0, 1, 2 }), payloads);
+}
@@ -0,0 +1,504 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#include "atf_precompile.h"
+
+#include "atf_catv5_pmi_fake_reader.h"
+#include "atf_catv5_producer_impl.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+using namespace ATF;
+using namespace std;
+
+namespace
+{
+    atomic<long> s_liveObjects(0);
+    atomic<long> s_badDeletes(0);
+
+    CC5Entity* NewHandle(FakeCC5Node* pNode)
+    {
+        switch (pNode->type)
+        {
+        case CC5_SOLIDGROUP_TYPE:
+        case CC5_SURFACEGROUP_TYPE:
+        case CC5_CURVEGROUP_TYPE:
+            return new CC5Group(pNode);
+        case CC5_SKIN_TYPE:
+            return new CC5Skin(pNode);
+        case CC5_COMPOSITECURVE_TYPE:
+            return new CC5CompositeCurve(pNode);
+        case CC5_SOLID_TYPE:
+            return new CC5Solid(pNode);
+        case CC5_BODY_TYPE:
+            return new CC5Body(pNode);
+        case CC5_POINT_TYPE:
+            return new CC5Point(pNode);
+        case CC5_POINTONCURVE_TYPE:
+            return new CC5PointOnCurve(pNode);
+        case CC5_POINTONSURFACE_TYPE:
+            return new CC5PointOnSurface(pNode);
+        case CC5_FACE_TYPE:
+            return new CC5Face(pNode);
+        case CC5_LOOP_TYPE:
+            return new CC5Loop(pNode);
+        case CC5_CURVESEGMENT_TYPE:
+            return new CC5CurveSegment(pNode);
+        default:
+            return new CC5Entity(pNode);
+        }
+    }
+
+    // New handle over child i of the node, owned by the caller as a fetched reader object
+    template <class T>
+    T* FetchChild(FakeCC5Node* pNode, int i)
+    {
+        if (i < 0 || i >= static_cast<int>(pNode->children.size()))
+            return nullptr;
+
+        CC5Entity* pHandle = NewHandle(pNode->children[i]);
+        s_liveObjects++;
+        return dynamic_cast<T*>(pHandle);
+    }
+
+    int ChildCount(FakeCC5Node* pNode)
+    {
+        return static_cast<int>(pNode->children.size());
+    }
+
+    void CopyPoint(const double from[3], double to[3])
+    {
+        to[0] = from[0];
+        to[1] = from[1];
+        to[2] = from[2];
+    }
+
+    CC5TPSShape* NewAnnotation(CC5_TPS_TYPE type)
+    {
+        switch (type)
+        {
+        case CC5_TPS_TEXT:
+            return new CC5TPSText();
+        case CC5_TPS_FLAG_NOTE:
+            return new CC5TPSFlagNote();
+        case CC5_TPS_LINEAR_DIMENSION:
+            return new CC5TPSLinearDimension();
+        case CC5_TPS_COORDINATE_DIMENSION:
+            return new CC5TPSCoordDimension();
+        case CC5_TPS_GEOMETRIC_TOLERANCE:
+            return new CC5TPSGeometricTolerance();
+        case CC5_TPS_SIMPLE_DATUM:
+            return new CC5TPSSimpleDatum();
+        case CC5_TPS_DATUM_TARGET:
+            return new CC5TPSDatumTarget();
+        case CC5_TPS_ROUGHNESS:
+            return new CC5TPSRoughness();
+        case CC5_TPS_LEADER:
+            return new CC5TPSLeader();
+        default:
+            return new CC5TPSShape();
+        }
+    }
+}
+
+// Reader
+
+CC5Object::CC5Object()
+    : m_bFakeCanonical(false)
+{}
+
+CC5Object::~CC5Object()
+{}
+
+int CC5Entity::GetID() { return m_pNode->id; }
+int CC5Entity::GetType() { return m_pNode->type; }
+CC5Entity* CC5Entity::GetParent() { return m_pNode->pParent ? m_pNode->pParent->pCanonical.get() : nullptr; }
+
+int CC5PersistentID::GetGroupCount() { return static_cast<int>(m_pNode->persistentGroups.size()); }
+
+void CC5PersistentID::GetGroupAt(int iGroup, int& iSize, int*& iIDList)
+{
+    vector<int>& group = m_pNode->persistentGroups[iGroup];
+    iSize = static_cast<int>(group.size());
+    iIDList = group.empty() ? nullptr : group.data();
+}
+
+int CC5CurveSegment::CoEdgeExisted() { return m_pNode->bCoEdge ? CC5_TRUE : CC5_FALSE; }
+
+CC5_ERROR CC5CurveSegment::GetStartPoint(double point[3])
+{
+    CopyPoint(m_pNode->start, point);
+    return CC5_QUERY_SUCCESS;
+}
+
+CC5_ERROR CC5CurveSegment::GetEndPoint(double point[3])
+{
+    CopyPoint(m_pNode->end, point);
+    return CC5_QUERY_SUCCESS;
+}
+
+int CC5Loop::GetNumberOfEdges() { return ChildCount(m_pNode); }
+CC5CurveSegment* CC5Loop::GetEdgeAt(int i) { return FetchChild<CC5CurveSegment>(m_pNode, i); }
+
+int CC5Face::GetNumberOfLoops() { return ChildCount(m_pNode); }
+CC5Loop* CC5Face::GetLoopAt(int i) { return FetchChild<CC5Loop>(m_pNode, i); }
+void CC5Face::GetPersistentIdentifier(CC5PersistentID*& pPersistentID) { pPersistentID = m_pNode->pPersistentID.get(); }
+
+int CC5Skin::GetNumberOfFaces() { return ChildCount(m_pNode); }
+CC5Face* CC5Skin::GetFaceAt(int i) { return FetchChild<CC5Face>(m_pNode, i); }
+
+int CC5Body::GetNumberOfSkins() { return ChildCount(m_pNode); }
+CC5Skin* CC5Body::GetSkinAt(int i) { return FetchChild<CC5Skin>(m_pNode, i); }
+
+int CC5Solid::GetNumberOfBodies() { return ChildCount(m_pNode); }
+CC5Body* CC5Solid::GetBodyAt(int i) { return FetchChild<CC5Body>(m_pNode, i); }
+
+int CC5CompositeCurve::GetNumberOfCurveSegments() { return ChildCount(m_pNode); }
+CC5CurveSegment* CC5CompositeCurve::GetCurveSegmentAt(int i) { return FetchChild<CC5CurveSegment>(m_pNode, i); }
+
+CC5_ERROR CC5Point::GetCoordinates(double coord[3])
+{
+    CopyPoint(m_pNode->start, coord);
+    return CC5_QUERY_SUCCESS;
+}
+
+CC5_ERROR CC5PointOnCurve::GetCoordinates(double coord[3])
+{
+    CopyPoint(m_pNode->start, coord);
+    return CC5_QUERY_SUCCESS;
+}
+
+CC5_ERROR CC5PointOnSurface::GetCoordinates(double coord[3])
+{
+    CopyPoint(m_pNode->start, coord);
+    return CC5_QUERY_SUCCESS;
+}
+
+int CC5Group::GetNumberOfEntities() { return ChildCount(m_pNode); }
+CC5Entity* CC5Group::GetEntityAt(int i) { return FetchChild<CC5Entity>(m_pNode, i); }
+int CC5Group::NeedTranslate() { return m_pNode->bNeedTranslate ? 1 : 0; }
+
+int CC5Part::GetNumberOfGroups() { return ChildCount(m_pNode); }
+
+CC5Group* CC5Part::GetGroupAt(int i)
+{
+    if (i < 0 || i >= ChildCount(m_pNode))
+        return nullptr;
+    return dynamic_cast<CC5Group*>(m_pNode->children[i]->pCanonical.get());
+}
+
+CC5_ERROR CC5TPSShape::GetTPSType(CC5_TPS_TYPE& type)
+{
+    type = m_type;
+    return CC5_QUERY_SUCCESS;
+}
+
+CC5_ERROR CC5TPSShape::IsVisible(int& bVisible)
+{
+    bVisible = m_bVisible ? 1 : 0;
+    return CC5_QUERY_SUCCESS;
+}
+
+CC5_ERROR CC5TPSShape::GetAssociatedGeoEntity(CC5Entity*& pEntity)
+{
+    pEntity = m_pAssociatedEntity;
+    return CC5_QUERY_SUCCESS;
+}
+
+CC5_ERROR CC5TPSLeader::GetTPSLeaderPosition(double* pPosition)
+{
+    CopyPoint(m_position, pPosition);
+    return CC5_QUERY_SUCCESS;
+}
+
+CC5_ERROR CC5TPSLeader::GetNumberOfBreakPoints(int& nBreakPoints)
+{
+    nBreakPoints = static_cast<int>(m_breakPoints.size() / 3);
+    return CC5_QUERY_SUCCESS;
+}
+
+CC5_ERROR CC5TPSLeader::GetBreakPointAt(double* pPoint, int i)
+{
+    if (i < 0 || 3 * static_cast<size_t>(i) + 3 > m_breakPoints.size())
+        return CC5_QUERY_FAIL;
+    CopyPoint(m_breakPoints.data() + 3 * i, pPoint);
+    return CC5_QUERY_SUCCESS;
+}
+
+// Allocated as the reader does, for CC5MemoryDelete_ThreadSafe
+void CC5TPSSet::GetTPSDrawStandard(char*& standardName)
+{
+    standardName = nullptr;
+    if (m_standardName.empty())
+        return;
+    standardName = static_cast<char*>(malloc(m_standardName.size() + 1));
+    memcpy(standardName, m_standardName.c_str(), m_standardName.size() + 1);
+}
+
+void CC5ObjectDelete_ThreadSafe(CC5Object** ppObject)
+{
+    if (!ppObject || !*ppObject)
+        return;
+
+    if ((*ppObject)->m_bFakeCanonical)
+    {
+        s_badDeletes++;
+    }
+    else
+    {
+        delete *ppObject;
+        s_liveObjects--;
+    }
+    *ppObject = nullptr;
+}
+
+void CC5MemoryDelete_ThreadSafe(void** ppMemory)
+{
+    if (!ppMemory)
+        return;
+    free(*ppMemory);
+    *ppMemory = nullptr;
+}
+
+// ATF
+
+void EventManager::FireEvent(Event* pEvent) const
+{
+    ExceptionEvent* pExceptionEvent = dynamic_cast<ExceptionEvent*>(pEvent);
+    if (pExceptionEvent)
+        m_messages.push_back(pExceptionEvent->Exception().Message());
+}
+
+CATV5ProducerImpl* CATV5ProducerImpl::Get()
+{
+    static CATV5ProducerImpl s_producer;
+    return &s_producer;
+}
+
+// FakeCC5Model
+
+FakeCC5Model::FakeCC5Model()
+    : m_pPartNode(new FakeCC5Node())
+{
+    m_pPartNode->id = 0;
+    m_pPartNode->type = 0;
+    m_pPartNode->pParent = nullptr;
+    m_pPartNode->bNeedTranslate = false;
+    m_pPartNode->bCoEdge = false;
+    m_pPart.reset(new CC5Part(m_pPartNode.get()));
+    m_pPart->m_bFakeCanonical = true;
+}
+
+FakeCC5Model::~FakeCC5Model()
+{}
+
+FakeCC5Node* FakeCC5Model::AddNode(FakeCC5Node* pParent, int id, int type)
+{
+    unique_ptr<FakeCC5Node> pNode(new FakeCC5Node());
+    pNode->id = id;
+    pNode->type = type;
+    pNode->pParent = pParent;
+    pNode->bNeedTranslate = false;
+    pNode->bCoEdge = false;
+    for (int i = 0; i < 3; i++)
+        pNode->start[i] = pNode->end[i] = 0;
+    pNode->pCanonical.reset(NewHandle(pNode.get()));
+    pNode->pCanonical->m_bFakeCanonical = true;
+
+    pParent->children.push_back(pNode.get());
+    m_nodes.push_back(move(pNode));
+    return m_nodes.back().get();
+}
+
+FakeCC5Node* FakeCC5Model::AddNode(CC5Entity* pParent, int id, int type)
+{
+    return AddNode(pParent->FakeNode(), id, type);
+}
+
+CC5Group* FakeCC5Model::AddGroup(int id, int type, bool bNeedTranslate)
+{
+    FakeCC5Node* pNode = AddNode(m_pPartNode.get(), id, type);
+    pNode->bNeedTranslate = bNeedTranslate;
+    return dynamic_cast<CC5Group*>(pNode->pCanonical.get());
+}
+
+CC5Solid* FakeCC5Model::AddSolid(CC5Group* pGroup, int id)
+{
+    return dynamic_cast<CC5Solid*>(AddNode(pGroup, id, CC5_SOLID_TYPE)->pCanonical.get());
+}
+
+CC5Body* FakeCC5Model::AddBody(CC5Solid* pSolid, int id)
+{
+    return dynamic_cast<CC5Body*>(AddNode(pSolid, id, CC5_BODY_TYPE)->pCanonical.get());
+}
+
+CC5Skin* FakeCC5Model::AddSkin(CC5Entity* pParent, int id)
+{
+    return dynamic_cast<CC5Skin*>(AddNode(pParent, id, CC5_SKIN_TYPE)->pCanonical.get());
+}
+
+CC5Face* FakeCC5Model::AddFace(CC5Skin* pSkin, int id)
+{
+    return dynamic_cast<CC5Face*>(AddNode(pSkin, id, CC5_FACE_TYPE)->pCanonical.get());
+}
+
+CC5Loop* FakeCC5Model::AddLoop(CC5Face* pFace, int id)
+{
+    return dynamic_cast<CC5Loop*>(AddNode(pFace, id, CC5_LOOP_TYPE)->pCanonical.get());
+}
+
+CC5CurveSegment* FakeCC5Model::AddEdge(CC5Entity* pParent, int id, bool bCoEdge, const double start[3], const double end[3])
+{
+    FakeCC5Node* pNode = AddNode(pParent, id, CC5_CURVESEGMENT_TYPE);
+    pNode->bCoEdge = bCoEdge;
+    CopyPoint(start, pNode->start);
+    CopyPoint(end, pNode->end);
+    return dynamic_cast<CC5CurveSegment*>(pNode->pCanonical.get());
+}
+
+CC5CompositeCurve* FakeCC5Model::AddCompositeCurve(CC5Group* pGroup, int id)
+{
+    return dynamic_cast<CC5CompositeCurve*>(AddNode(pGroup, id, CC5_COMPOSITECURVE_TYPE)->pCanonical.get());
+}
+
+CC5Entity* FakeCC5Model::AddPoint(CC5Group* pGroup, int id, int type, const double coord[3])
+{
+    FakeCC5Node* pNode = AddNode(pGroup, id, type);
+    CopyPoint(coord, pNode->start);
+    return pNode->pCanonical.get();
+}
+
+void FakeCC5Model::SetPersistentID(CC5Face* pFace, const vector<vector<int>>& groups)
+{
+    FakeCC5Node* pNode = pFace->FakeNode();
+    pNode->persistentGroups = groups;
+    pNode->pPersistentID.reset(new CC5PersistentID(pNode));
+}
+
+CC5TPSShape* FakeCC5Model::AddAnnotation(CC5_TPS_TYPE type, int id, CC5Entity* pEntity)
+{
+    unique_ptr<CC5TPSShape> pShape(NewAnnotation(type));
+    pShape->m_bFakeCanonical = true;
+    pShape->m_type = type;
+    pShape->m_id = id;
+    pShape->m_pAssociatedEntity = pEntity;
+    m_annotations.push_back(move(pShape));
+    return m_annotations.back().get();
+}
+
+FINALBODYLIST FakeCC5Model::TranslatableGroups() const
+{
+    FINALBODYLIST groups;
+    for (FakeCC5Node* pNode : m_pPartNode->children)
+    {
+        if (pNode->bNeedTranslate)
+            groups.push_back(dynamic_cast<CC5Group*>(pNode->pCanonical.get()));
+    }
+    return groups;
+}
+
+long FakeCC5Model::LiveObjects()
+{
+    return s_liveObjects;
+}
+
+long FakeCC5Model::BadDeletes()
+{
+    return s_badDeletes;
+}
+
+// FakeCC5StripPart
+
+namespace
+{
+    // Strip of quad faces along x at height z: face f spans [f, f + 1] x [0, 1], and its loop is its bottom edge,
+    // the edge it shares with the next face, its top edge and the edge it shares with the previous one.
+    // The edges of the strip have IDs edgeBase + [0, 3 * (nFaces + 1)).
+    void AddStrip(FakeCC5Model& model, CC5Skin* pSkin, int faceBase, int edgeBase, int& nextId, int nFaces, double z
+        , int firstKey, vector<CC5Face*>& faces, vector<CC5CurveSegment*>& coEdges)
+    {
+        for (int f = 0; f < nFaces; f++)
+        {
+            CC5Face* pFace = model.AddFace(pSkin, faceBase + f);
+            model.SetPersistentID(pFace, { { firstKey + f } });
+            CC5Loop* pLoop = model.AddLoop(pFace, nextId++);
+
+            double x0 = f;
+            double x1 = f + 1;
+            double p00[3] = { x0, 0, z };
+            double p10[3] = { x1, 0, z };
+            double p01[3] = { x0, 1, z };
+            double p11[3] = { x1, 1, z };
+            model.AddEdge(pLoop, edgeBase + nFaces + 1 + f, false, p00, p10);
+            CC5CurveSegment* pRight = model.AddEdge(pLoop, edgeBase + f + 1, f + 1 < nFaces, p10, p11);
+            model.AddEdge(pLoop, edgeBase + 2 * (nFaces + 1) + f, false, p11, p01);
+            model.AddEdge(pLoop, edgeBase + f, f > 0, p01, p00);
+
+            faces.push_back(pFace);
+            if (f + 1 < nFaces)
+                coEdges.push_back(pRight);
+        }
+    }
+}
+
+FakeCC5StripPart::FakeCC5StripPart(FakeCC5Model& model, int nBodies, int nFaces)
+    : finalFaces(nBodies)
+    , finalCoEdges(nBodies)
+    , intermediateFaces(nBodies)
+    , faceReferences(nBodies)
+    , edgeReferences(nBodies)
+{
+    int nextId = 7000000;
+    int edgesPerStrip = 3 * (nFaces + 1);
+
+    // The feature the final bodies result from
+    CC5Group* pIntermediateGroup = model.AddGroup(10, CC5_SOLIDGROUP_TYPE, false);
+    CC5Solid* pIntermediateSolid = model.AddSolid(pIntermediateGroup, nextId++);
+    vector<vector<CC5CurveSegment*>> intermediateCoEdges(nBodies);
+    for (int b = 0; b < nBodies; b++)
+    {
+        CC5Body* pBody = model.AddBody(pIntermediateSolid, nextId++);
+        CC5Skin* pSkin = model.AddSkin(pBody, nextId++);
+        AddStrip(model, pSkin, kIntermediateFaceBase + b * nFaces, kIntermediateEdgeBase + b * edgesPerStrip, nextId, nFaces, 10.0 * b
+            , b * nFaces + 1, intermediateFaces[b], intermediateCoEdges[b]);
+    }
+
+    for (int b = 0; b < nBodies; b++)
+    {
+        CC5Group* pGroup = model.AddGroup(100 + b, CC5_SOLIDGROUP_TYPE, true);
+        CC5Solid* pSolid = model.AddSolid(pGroup, nextId++);
+        CC5Body* pBody = model.AddBody(pSolid, nextId++);
+        CC5Skin* pSkin = model.AddSkin(pBody, nextId++);
+        AddStrip(model, pSkin, kFinalFaceBase + b * nFaces, kFinalEdgeBase + b * edgesPerStrip, nextId, nFaces, 10.0 * b
+            , b * nFaces + 1, finalFaces[b], finalCoEdges[b]);
+    }
+
+    CC5Group* pFaceReferences = model.AddGroup(20, CC5_SURFACEGROUP_TYPE, false);
+    CC5Group* pEdgeReferences = model.AddGroup(21, CC5_CURVEGROUP_TYPE, false);
+    for (int b = 0; b < nBodies; b++)
+    {
+        for (CC5Face* pFace : intermediateFaces[b])
+        {
+            CC5Skin* pSkin = model.AddSkin(pFaceReferences, nextId++);
+            model.AddFace(pSkin, pFace->GetID());
+            faceReferences[b].push_back(pSkin);
+        }
+        for (CC5CurveSegment* pEdge : intermediateCoEdges[b])
+        {
+            CC5CompositeCurve* pCurve = model.AddCompositeCurve(pEdgeReferences, nextId++);
+            double start[3], end[3];
+            pEdge->GetStartPoint(start);
+            pEdge->GetEndPoint(end);
+            model.AddEdge(pCurve, pEdge->GetID(), true, start, end);
+            edgeReferences[b].push_back(pCurve);
+        }
+    }
+}
@@ -0,0 +1,114 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+#include "atf_catv5_pmi_util.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Entity of a FakeCC5Model. The reader objects are handles over it.
+struct FakeCC5Node
+{
+    int id;
+    int type;
+    FakeCC5Node* pParent;
+    std::vector<FakeCC5Node*> children;
+    bool bNeedTranslate;
+    bool bCoEdge;
+    // Start and end points of an edge; the coordinates of a point are in start
+    double start[3];
+    double end[3];
+    std::vector<std::vector<int>> persistentGroups;
+    std::unique_ptr<CC5PersistentID> pPersistentID;
+    // Handle given by GetParent and GetGroupAt, and to the tests; never freed by the reader's users
+    std::unique_ptr<CC5Entity> pCanonical;
+};
+
+namespace ATF
+{
+    // In-memory CC5Part for the PMI tests. The accessors fetching an object (GetEntityAt, GetFaceAt...)
+    // return a new handle over the node, to be freed with CC5ObjectDelete_ThreadSafe as with the reader;
+    // the handles the model gives are its canonical ones, like the objects GetParent returns.
+    class FakeCC5Model
+    {
+    public:
+        FakeCC5Model();
+        ~FakeCC5Model();
+
+        CC5Part* Part() const { return m_pPart.get(); }
+
+        CC5Group* AddGroup(int id, int type, bool bNeedTranslate);
+        CC5Solid* AddSolid(CC5Group* pGroup, int id);
+        CC5Body* AddBody(CC5Solid* pSolid, int id);
+        // pParent is a body, or a surface group
+        CC5Skin* AddSkin(CC5Entity* pParent, int id);
+        CC5Face* AddFace(CC5Skin* pSkin, int id);
+        CC5Loop* AddLoop(CC5Face* pFace, int id);
+        // pParent is a loop, or a composite curve
+        CC5CurveSegment* AddEdge(CC5Entity* pParent, int id, bool bCoEdge, const double start[3], const double end[3]);
+        CC5CompositeCurve* AddCompositeCurve(CC5Group* pGroup, int id);
+        CC5Entity* AddPoint(CC5Group* pGroup, int id, int type, const double coord[3]);
+
+        // Gives the face a persistent ID with these groups, possibly none
+        void SetPersistentID(CC5Face* pFace, const std::vector<std::vector<int>>& groups);
+
+        // Annotation of the given type and ID, associated to pEntity
+        CC5TPSShape* AddAnnotation(CC5_TPS_TYPE type, int id, CC5Entity* pEntity);
+
+        // The groups to translate, in part order
+        FINALBODYLIST TranslatableGroups() const;
+
+        // Handles fetched and not freed yet, and frees of a handle the reader's users do not own, over all the models
+        static long LiveObjects();
+        static long BadDeletes();
+
+    private:
+        FakeCC5Model(const FakeCC5Model&) = delete;
+        FakeCC5Model& operator=(const FakeCC5Model&) = delete;
+
+        FakeCC5Node* AddNode(CC5Entity* pParent, int id, int type);
+        FakeCC5Node* AddNode(FakeCC5Node* pParent, int id, int type);
+
+        std::vector<std::unique_ptr<FakeCC5Node>> m_nodes;
+        std::unique_ptr<FakeCC5Node> m_pPartNode;
+        std::unique_ptr<CC5Part> m_pPart;
+        std::vector<std::unique_ptr<CC5TPSShape>> m_annotations;
+    };
+
+    // Part made of strips of quad faces, each face sharing a co-edge with the next one.
+    //  - nBodies translatable solid groups (final bodies), one strip of nFaces faces each. Face f of body b
+    //    has ID kFinalFaceBase + b * nFaces + f and the persistent ID { { b * nFaces + f + 1 } }; its edges
+    //    have IDs from kFinalEdgeBase.
+    //  - One solid group not translated (the intermediate solid), having a twin of each final face with the
+    //    same persistent ID, and IDs offset to kIntermediateFaceBase and kIntermediateEdgeBase.
+    //  - The references the annotations of a feature are associated to, in groups not translated: per intermediate
+    //    face a skin holding it, and per intermediate co-edge a composite curve holding it.
+    struct FakeCC5StripPart
+    {
+        static const int kFinalFaceBase = 1000000;
+        static const int kFinalEdgeBase = 2000000;
+        static const int kIntermediateFaceBase = 3000000;
+        static const int kIntermediateEdgeBase = 4000000;
+
+        FakeCC5StripPart(FakeCC5Model& model, int nBodies, int nFaces);
+
+        // Final faces by body, and final co-edges by body, in strip order
+        std::vector<std::vector<CC5Face*>> finalFaces;
+        std::vector<std::vector<CC5CurveSegment*>> finalCoEdges;
+        // Twins of the final faces, in the same order
+        std::vector<std::vector<CC5Face*>> intermediateFaces;
+        // Skins of faceReferences[b][f] holds intermediateFaces[b][f]; composite curve edgeReferences[b][k]
+        // holds the intermediate twin of finalCoEdges[b][k]
+        std::vector<std::vector<CC5Entity*>> faceReferences;
+        std::vector<std::vector<CC5Entity*>> edgeReferences;
+    };
+}
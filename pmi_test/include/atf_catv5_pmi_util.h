@@ -0,0 +1,64 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+// Declarations of the PMI test build for the producer's PMI utilities; the definitions are in 1.cpp.
+
+#include <map>
+#include <vector>
+
+namespace ATF
+{
+    struct RoughnessUtilData
+    {
+        Point3d leftBottomPosition;
+        Point3d rightBottomPosition;
+        Point3d middleBottomPosition;
+        Point3d framePt2;
+    };
+
+    typedef std::vector<CC5Entity*> ENTITIESINFINALSOLID;
+    typedef std::vector<CC5Group*> FINALBODYLIST;
+    typedef std::multimap<int, CC5Face*> EDGE_FACE;
+
+    class CATV5PMIUtil
+    {
+    public:
+        static PMIStandardTypeEnum GetPMIStandardType(CC5TPSSet* pTPS);
+        static bool IsSameAsISORepresentation(PMIStandardTypeEnum standardType);
+        static ObjectId AnnotationObjectId(CC5TPSShape* pShape, const ObjectId& parentId);
+        static bool IsAnnotationVisible(CC5TPSShape* pShape);
+        static void GetNearestPoint(CC5TPSShape* pCC5Shape, const RoughnessUtilData& roughnessUtilData, bool bSymbolMode
+            , bool bVersionHigherThanV5R18, Point3d& nearestPt, int& nIndexOfNearestPt);
+    };
+
+    class GeometryReferenceBuilder
+    {
+    public:
+        GeometryReferenceBuilder(CC5Entity* cc5AssoEnt, CC5Part* cc5Part);
+        ~GeometryReferenceBuilder();
+
+        bool ReferencedGeometryIds(std::vector<int>& ids);
+
+    private:
+        void CheckFacesInFinalBody(CC5Face* pFace, CC5Part* pPart, int nType, ENTITIESINFINALSOLID& entities);
+        void CheckEdgesInFinalBody(CC5CurveSegment* pCurve, CC5Part* pPart, ENTITIESINFINALSOLID& entities);
+        void ProcessAssociatedGeomEntity(CC5Entity* Ent, CC5Part* Part, std::vector<int>& ids);
+        int CheckForEntityInFinalBody(CC5Entity* AsscEnt, int iType);
+        int GetResolvedFaces(CC5Entity* asscEnt, ENTITIESINFINALSOLID& entitiesinfinalsolid, CC5Part* Part);
+        int GetResolvedEdges(CC5Entity* asscEnt, ENTITIESINFINALSOLID& entitiesinfinalsolid, CC5Part* Part);
+        int FindAsscEntityInIntermediateSolid(CC5Entity* asscEnt, int iType, CC5Part* Part, CC5Entity*& pIntermdtEnt1, CC5Entity*& pIntermdtEnt2);
+        int FindEntityUsingGeomIDs(CC5Entity* pIntermdtEnt1, CC5Entity* pIntermdtEnt2, int iType, ENTITIESINFINALSOLID& entitiesinfinalsolid);
+        void CheckFaceInFaceGroups(CC5Face* pFace, CC5Face* asscFace, bool& bFaceMatched);
+
+        CC5Entity* m_cc5AssoEnt;
+        CC5Part* m_cc5Part;
+    };
+}
@@ -0,0 +1,35 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+// Producer of the PMI test build: the translatable groups and event manager are set by the tests
+
+namespace ATF
+{
+    class CATV5ProducerImpl
+    {
+    public:
+        static CATV5ProducerImpl* Get();
+
+        const std::vector<CC5Group*>& TranslatableGroups() const { return m_translatableGroups; }
+        const EventManager* GetEventManager() const { return m_pEventManager; }
+
+        void SetTranslatableGroups(const std::vector<CC5Group*>& translatableGroups) { m_translatableGroups = translatableGroups; }
+        void SetEventManager(const EventManager* pEventManager) { m_pEventManager = pEventManager; }
+
+    private:
+        CATV5ProducerImpl()
+            : m_pEventManager(nullptr)
+        {}
+
+        std::vector<CC5Group*> m_translatableGroups;
+        const EventManager* m_pEventManager;
+    };
+}
@@ -0,0 +1,27 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+// Declaration of the PMI test build for the producer's object ids
+
+namespace ATF
+{
+    struct CATV5Util
+    {
+        // parentId, then the ID of the object
+        template <class T>
+        static void CATV5ObjectId(T* pObject, const ObjectId& parentId, ObjectId& objectId)
+        {
+            objectId.Append(parentId.c_str());
+            objectId.Append("_");
+            objectId.Append(std::to_string(pObject->m_id).c_str());
+        }
+    };
+}
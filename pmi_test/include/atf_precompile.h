@@ -0,0 +1,307 @@
+//
+//  Copyright 2020 Autodesk, Inc.  All rights reserved.
+//
+//  This computer source code and related instructions and comments are the unpublished
+//  confidential and proprietary information of Autodesk, Inc. and are protected under
+//  applicable copyright and trade secret law. They may not be disclosed to, copied or
+//  used by any third party without the prior written consent of Autodesk, Inc.
+//
+
+#pragma once
+
+// Precompiled header of the PMI test build. Stands in for the CATIA V5 reader (CC5*) and the ATF types
+// the PMI association uses, declared the way the association calls them. The reader classes are thin
+// handles over the nodes of an in-memory model, implemented by atf_catv5_pmi_fake_reader.cpp;
+// see ATF::FakeCC5Model to build a part.
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#define ATF_WARNING_ASSERT(x) ((void)0)
+
+enum CC5_ERROR { CC5_QUERY_SUCCESS, CC5_QUERY_FAIL };
+enum { CC5_FALSE = 0, CC5_TRUE = 1 };
+enum
+{
+    CC5_SOLIDGROUP_TYPE = 1, CC5_SURFACEGROUP_TYPE, CC5_CURVEGROUP_TYPE, CC5_SKIN_TYPE, CC5_COMPOSITECURVE_TYPE,
+    CC5_SOLID_TYPE, CC5_BODY_TYPE, CC5_POINT_TYPE, CC5_POINTONCURVE_TYPE, CC5_POINTONSURFACE_TYPE, CC5_FACE_TYPE,
+    CC5_LOOP_TYPE, CC5_CURVESEGMENT_TYPE
+};
+enum CC5_TPS_TYPE
+{
+    CC5_TPS_UNKNOWN, CC5_TPS_TEXT, CC5_TPS_FLAG_NOTE, CC5_TPS_LINEAR_DIMENSION, CC5_TPS_COORDINATE_DIMENSION,
+    CC5_TPS_GEOMETRIC_TOLERANCE, CC5_TPS_SIMPLE_DATUM, CC5_TPS_DATUM_TARGET, CC5_TPS_ROUGHNESS, CC5_TPS_ANNOT_SET,
+    CC5_TPS_PROJECTED_VIEW, CC5_TPS_REFERENCE_FRAME, CC5_TPS_LEADER, CC5_TPS_WELD_SYMBOL, CC5_TPS_CAPTURE
+};
+
+struct FakeCC5Node;
+
+class CC5Object
+{
+public:
+    CC5Object();
+    virtual ~CC5Object();
+
+    // Handles kept by the model (GetParent, GetGroupAt, the objects given to the tests) are never deleted by the reader's users
+    bool m_bFakeCanonical;
+};
+
+class CC5Entity : public CC5Object
+{
+public:
+    explicit CC5Entity(FakeCC5Node* pNode) : m_pNode(pNode) {}
+
+    int GetID();
+    int GetType();
+    CC5Entity* GetParent();
+
+    FakeCC5Node* FakeNode() const { return m_pNode; }
+
+protected:
+    FakeCC5Node* m_pNode;
+};
+
+class CC5PersistentID
+{
+public:
+    explicit CC5PersistentID(FakeCC5Node* pNode) : m_pNode(pNode) {}
+
+    int GetGroupCount();
+    void GetGroupAt(int iGroup, int& iSize, int*& iIDList);
+
+private:
+    FakeCC5Node* m_pNode;
+};
+
+class CC5CurveSegment : public CC5Entity
+{
+public:
+    using CC5Entity::CC5Entity;
+    int CoEdgeExisted();
+    CC5_ERROR GetStartPoint(double point[3]);
+    CC5_ERROR GetEndPoint(double point[3]);
+};
+
+class CC5Loop : public CC5Entity
+{
+public:
+    using CC5Entity::CC5Entity;
+    int GetNumberOfEdges();
+    CC5CurveSegment* GetEdgeAt(int i);
+};
+
+class CC5Face : public CC5Entity
+{
+public:
+    using CC5Entity::CC5Entity;
+    int GetNumberOfLoops();
+    CC5Loop* GetLoopAt(int i);
+    void GetPersistentIdentifier(CC5PersistentID*& pPersistentID);
+};
+
+class CC5Skin : public CC5Entity
+{
+public:
+    using CC5Entity::CC5Entity;
+    int GetNumberOfFaces();
+    CC5Face* GetFaceAt(int i);
+};
+
+class CC5Body : public CC5Entity
+{
+public:
+    using CC5Entity::CC5Entity;
+    int GetNumberOfSkins();
+    CC5Skin* GetSkinAt(int i);
+};
+
+class CC5Solid : public CC5Entity
+{
+public:
+    using CC5Entity::CC5Entity;
+    int GetNumberOfBodies();
+    CC5Body* GetBodyAt(int i);
+};
+
+class CC5CompositeCurve : public CC5Entity
+{
+public:
+    using CC5Entity::CC5Entity;
+    int GetNumberOfCurveSegments();
+    CC5CurveSegment* GetCurveSegmentAt(int i);
+};
+
+class CC5Point : public CC5Entity
+{
+public:
+    using CC5Entity::CC5Entity;
+    CC5_ERROR GetCoordinates(double coord[3]);
+};
+
+class CC5PointOnCurve : public CC5Entity
+{
+public:
+    using CC5Entity::CC5Entity;
+    CC5_ERROR GetCoordinates(double coord[3]);
+};
+
+class CC5PointOnSurface : public CC5Entity
+{
+public:
+    using CC5Entity::CC5Entity;
+    CC5_ERROR GetCoordinates(double coord[3]);
+};
+
+class CC5Group : public CC5Entity
+{
+public:
+    using CC5Entity::CC5Entity;
+    int GetNumberOfEntities();
+    CC5Entity* GetEntityAt(int i);
+    int NeedTranslate();
+};
+
+class CC5Part : public CC5Object
+{
+public:
+    explicit CC5Part(FakeCC5Node* pNode) : m_pNode(pNode) {}
+
+    int GetNumberOfGroups();
+    CC5Group* GetGroupAt(int i);
+
+private:
+    FakeCC5Node* m_pNode;
+};
+
+class CC5TPSShape : public CC5Object
+{
+public:
+    CC5TPSShape() : m_type(CC5_TPS_UNKNOWN), m_id(0), m_bVisible(true), m_pAssociatedEntity(nullptr) {}
+
+    CC5_ERROR GetTPSType(CC5_TPS_TYPE& type);
+    CC5_ERROR IsVisible(int& bVisible);
+    CC5_ERROR GetAssociatedGeoEntity(CC5Entity*& pEntity);
+
+    CC5_TPS_TYPE m_type;
+    int m_id;
+    bool m_bVisible;
+    CC5Entity* m_pAssociatedEntity;
+};
+
+class CC5TPSText : public CC5TPSShape {};
+class CC5TPSFlagNote : public CC5TPSShape {};
+class CC5TPSLinearDimension : public CC5TPSShape {};
+class CC5TPSCoordDimension : public CC5TPSShape {};
+class CC5TPSGeometricTolerance : public CC5TPSShape {};
+class CC5TPSSimpleDatum : public CC5TPSShape {};
+class CC5TPSDatumTarget : public CC5TPSShape {};
+class CC5TPSRoughness : public CC5TPSShape {};
+
+class CC5TPSLeader : public CC5TPSShape
+{
+public:
+    CC5_ERROR GetTPSLeaderPosition(double* pPosition);
+    CC5_ERROR GetNumberOfBreakPoints(int& nBreakPoints);
+    CC5_ERROR GetBreakPointAt(double* pPoint, int i);
+
+    double m_position[3];
+    std::vector<double> m_breakPoints;
+};
+
+class CC5TPSSet : public CC5Object
+{
+public:
+    void GetTPSDrawStandard(char*& standardName);
+
+    std::string m_standardName;
+};
+
+void CC5ObjectDelete_ThreadSafe(CC5Object** ppObject);
+void CC5MemoryDelete_ThreadSafe(void** ppMemory);
+
+namespace ATF
+{
+    class ObjectId
+    {
+    public:
+        void Append(const char* text) { m_text += text; }
+        const char* c_str() const { return m_text.c_str(); }
+        bool IsEmpty() const { return m_text.empty(); }
+
+    private:
+        std::string m_text;
+    };
+
+    struct Point3d
+    {
+        Point3d() : x(0), y(0), z(0) {}
+        Point3d(double x_, double y_, double z_) : x(x_), y(y_), z(z_) {}
+        double x, y, z;
+    };
+
+    struct MathUtil
+    {
+        static bool IsLessThan(double a, double b) { return a < b; }
+    };
+
+    class GeneralException
+    {
+    public:
+        explicit GeneralException(const char* message) : m_message(message) {}
+        const std::string& Message() const { return m_message; }
+
+    private:
+        std::string m_message;
+    };
+
+    class Event
+    {
+    public:
+        virtual ~Event() {}
+    };
+
+    class ExceptionEvent : public Event
+    {
+    public:
+        enum { kEventType_NoExceptionThrow };
+        ExceptionEvent(int eventType, const GeneralException& exception) : m_exception(exception) {}
+        const GeneralException& Exception() const { return m_exception; }
+
+    private:
+        GeneralException m_exception;
+    };
+
+    template <class T>
+    class EventPtr
+    {
+    public:
+        explicit EventPtr(T* pEvent) : m_pEvent(pEvent) {}
+        T* get() const { return m_pEvent.get(); }
+
+    private:
+        std::unique_ptr<T> m_pEvent;
+    };
+
+    // Records the messages of the exception events fired
+    class EventManager
+    {
+    public:
+        void FireEvent(Event* pEvent) const;
+        const std::vector<std::string>& Messages() const { return m_messages; }
+
+    private:
+        mutable std::vector<std::string> m_messages;
+    };
+
+    enum PMIStandardTypeEnum
+    {
+        kPMIStandardTypeEnum_Unknown, kPMIStandardTypeEnum_ISO, kPMIStandardTypeEnum_ANSI,
+        kPMIStandardTypeEnum_ASME, kPMIStandardTypeEnum_JIS
+    };
+}